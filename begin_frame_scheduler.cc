@@ -0,0 +1,167 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "begin_frame_scheduler.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "include/wrapper/cef_helpers.h"
+
+namespace {
+
+// Weight of the newest sample in the paint cost moving average.
+const double kPaintCostWeight = 0.2;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+BeginFrameScheduler::BeginFrameScheduler()
+    : interval_us_(16667), begin_frames_sent_(0) {}
+
+void BeginFrameScheduler::SetPresentInterval(double interval_ms) {
+  if (interval_ms > 0)
+    interval_us_ = static_cast<int64_t>(interval_ms * 1000.0);
+}
+
+void BeginFrameScheduler::AddBrowser(CefRefPtr<CefBrowser> browser) {
+  CEF_REQUIRE_UI_THREAD();
+  BrowserState& state = browsers_[browser->GetIdentifier()];
+  state.host = browser->GetHost();
+  state.next_begin_frame_us = 0;
+}
+
+void BeginFrameScheduler::RemoveBrowser(int browser_id) {
+  CEF_REQUIRE_UI_THREAD();
+  browsers_.erase(browser_id);
+}
+
+void BeginFrameScheduler::SetHidden(int browser_id, bool hidden) {
+  CEF_REQUIRE_UI_THREAD();
+  BrowserMap::iterator it = browsers_.find(browser_id);
+  if (it == browsers_.end() || it->second.hidden == hidden)
+    return;
+  it->second.hidden = hidden;
+  if (!hidden)
+    Wake(browser_id);
+}
+
+void BeginFrameScheduler::SetMaxFrameRate(int browser_id, int frame_rate) {
+  CEF_REQUIRE_UI_THREAD();
+  BrowserMap::iterator it = browsers_.find(browser_id);
+  if (it == browsers_.end())
+    return;
+  it->second.min_interval_us = frame_rate > 0 ? 1000000 / frame_rate : 0;
+}
+
+void BeginFrameScheduler::OnPaint(int browser_id) {
+  CEF_REQUIRE_UI_THREAD();
+  BrowserMap::iterator it = browsers_.find(browser_id);
+  if (it == browsers_.end())
+    return;
+
+  BrowserState& state = it->second;
+  const bool was_idle = state.unanswered >= kIdleBeginFrames;
+  state.unanswered = 0;
+
+  if (state.begin_frame_sent_us == 0)
+    return;
+
+  const double cost_us =
+      static_cast<double>(NowUs() - state.begin_frame_sent_us);
+  state.begin_frame_sent_us = 0;
+  state.paint_cost_us = state.paint_cost_us == 0
+                            ? cost_us
+                            : state.paint_cost_us +
+                                  kPaintCostWeight *
+                                      (cost_us - state.paint_cost_us);
+
+  // Only ask for as many frames as the browser manages to paint.
+  const int divisor =
+      static_cast<int>(ceil(state.paint_cost_us / interval_us_));
+  state.rate_divisor = std::max(1, std::min(divisor, kMaxRateDivisor));
+
+  // Resume the full rate right away after an idle period.
+  if (was_idle)
+    state.next_begin_frame_us = 0;
+}
+
+void BeginFrameScheduler::Wake(int browser_id) {
+  BrowserMap::iterator it = browsers_.find(browser_id);
+  if (it == browsers_.end())
+    return;
+  it->second.unanswered = 0;
+  it->second.next_begin_frame_us = 0;
+}
+
+void BeginFrameScheduler::WakeAll() {
+  for (BrowserMap::iterator it = browsers_.begin(); it != browsers_.end();
+       ++it) {
+    it->second.unanswered = 0;
+    it->second.next_begin_frame_us = 0;
+  }
+}
+
+void BeginFrameScheduler::Tick(int64_t last_present_us) {
+  CEF_REQUIRE_UI_THREAD();
+  const int64_t now = NowUs();
+
+  for (BrowserMap::iterator it = browsers_.begin(); it != browsers_.end();
+       ++it) {
+    BrowserState& state = it->second;
+    if (state.hidden || now < state.next_begin_frame_us)
+      continue;
+
+    if (state.begin_frame_sent_us != 0)
+      state.unanswered++;
+
+    state.host->SendExternalBeginFrame();
+    state.begin_frame_sent_us = now;
+    begin_frames_sent_++;
+
+    if (state.unanswered >= kIdleBeginFrames) {
+      state.next_begin_frame_us = now + kIdleIntervalUs;
+    } else {
+      const int64_t interval =
+          std::max(interval_us_ * state.rate_divisor, state.min_interval_us);
+      state.next_begin_frame_us =
+          AlignToPresent(now + interval, last_present_us);
+    }
+  }
+}
+
+int64_t BeginFrameScheduler::TimeUntilNextBeginFrameUs() const {
+  const int64_t now = NowUs();
+  int64_t delay = -1;
+  for (BrowserMap::const_iterator it = browsers_.begin();
+       it != browsers_.end(); ++it) {
+    if (it->second.hidden)
+      continue;
+    const int64_t until =
+        std::max<int64_t>(0, it->second.next_begin_frame_us - now);
+    if (delay < 0 || until < delay)
+      delay = until;
+  }
+  return delay;
+}
+
+int64_t BeginFrameScheduler::AlignToPresent(int64_t time_us,
+                                            int64_t last_present_us) const {
+  if (last_present_us <= 0 || time_us <= last_present_us)
+    return time_us;
+
+  // BeginFrames should land just after a present so that the resulting paint
+  // is ready for the following one.
+  const int64_t phase = (time_us - last_present_us) % interval_us_;
+  if (phase < interval_us_ / 2)
+    return time_us - phase;
+  return time_us + (interval_us_ - phase);
+}
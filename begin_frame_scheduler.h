@@ -0,0 +1,103 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_BEGIN_FRAME_SCHEDULER_H_
+#define CEF_TESTS_CEFSIMPLE_BEGIN_FRAME_SCHEDULER_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+
+#include "include/base/cef_macros.h"
+#include "include/cef_browser.h"
+
+// Drives browsers created with CefWindowInfo::external_begin_frame_enabled by
+// calling CefBrowserHost::SendExternalBeginFrame. BeginFrames are aligned to
+// the present cadence and the rate of each browser is divided down when its
+// measured paint cost does not fit in a present interval, or to the limit set
+// with SetMaxFrameRate(). Hidden browsers get no BeginFrames. Browsers that
+// stop painting in response to BeginFrames fall back to a slow heartbeat
+// until they paint again or are woken by input.
+//
+// All methods must be called on the CEF UI thread.
+class BeginFrameScheduler {
+ public:
+  // Consecutive unanswered BeginFrames after which a browser is idle.
+  static const int kIdleBeginFrames = 30;
+  // BeginFrame interval of an idle browser.
+  static const int64_t kIdleIntervalUs = 250000;
+  // Largest divisor applied to the present rate.
+  static const int kMaxRateDivisor = 4;
+
+  BeginFrameScheduler();
+
+  // Interval between presents, e.g. 16.7 ms for a 60 Hz display.
+  void SetPresentInterval(double interval_ms);
+  double present_interval_ms() const { return interval_us_ / 1000.0; }
+
+  void AddBrowser(CefRefPtr<CefBrowser> browser);
+  void RemoveBrowser(int browser_id);
+
+  void SetHidden(int browser_id, bool hidden);
+
+  // Send |browser_id| at most |frame_rate| BeginFrames per second, or lift
+  // the limit if 0.
+  void SetMaxFrameRate(int browser_id, int frame_rate);
+
+  // A PET_VIEW paint arrived for |browser_id|.
+  void OnPaint(int browser_id);
+
+  // Issue a BeginFrame to |browser_id| (or every browser) on the next Tick(),
+  // e.g. after input, a resize or a navigation.
+  void Wake(int browser_id);
+  void WakeAll();
+
+  // Send the BeginFrames that are due. |last_present_us| is the steady clock
+  // time of the last present in microseconds, or 0 if unknown, and is used to
+  // keep BeginFrames in phase with presents.
+  void Tick(int64_t last_present_us);
+
+  // Microseconds until the next BeginFrame is due, or -1 if none is scheduled.
+  int64_t TimeUntilNextBeginFrameUs() const;
+
+  int64_t begin_frames_sent() const { return begin_frames_sent_; }
+
+ private:
+  struct BrowserState {
+    BrowserState()
+        : hidden(false),
+          next_begin_frame_us(0),
+          begin_frame_sent_us(0),
+          paint_cost_us(0),
+          unanswered(0),
+          rate_divisor(1),
+          min_interval_us(0) {}
+
+    CefRefPtr<CefBrowserHost> host;
+    bool hidden;
+    int64_t next_begin_frame_us;
+    // Time the outstanding BeginFrame was sent, or 0 if it was answered.
+    int64_t begin_frame_sent_us;
+    // Moving average of the time from BeginFrame to OnPaint.
+    double paint_cost_us;
+    int unanswered;
+    int rate_divisor;
+    // Set by SetMaxFrameRate().
+    int64_t min_interval_us;
+  };
+
+  typedef std::map<int, BrowserState> BrowserMap;
+
+  // Snap |time_us| to the nearest present phase.
+  int64_t AlignToPresent(int64_t time_us, int64_t last_present_us) const;
+
+  BrowserMap browsers_;
+  int64_t interval_us_;
+  int64_t begin_frames_sent_;
+
+  DISALLOW_COPY_AND_ASSIGN(BeginFrameScheduler);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_BEGIN_FRAME_SCHEDULER_H_
@@ -0,0 +1,169 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "browser_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+const char* SourceName(BrowserPool::Source source) {
+  return source == BrowserPool::SOURCE_POOL ? "pool" : "cold";
+}
+
+}  // namespace
+
+BrowserPool::BrowserPool() : capacity_(0), closed_(false) {}
+
+bool BrowserPool::NeedsBrowser() const {
+  return !closed_ && size() < static_cast<size_t>(capacity_);
+}
+
+void BrowserPool::Add(CefRefPtr<CefBrowser> browser) {
+  DCHECK(browser);
+  DCHECK(!Contains(browser->GetIdentifier()));
+  loading_.push_back(browser);
+}
+
+void BrowserPool::OnLoaded(int browser_id) {
+  for (BrowserList::iterator it = loading_.begin(); it != loading_.end();
+       ++it) {
+    if ((*it)->GetIdentifier() == browser_id) {
+      ready_.push_back(*it);
+      loading_.erase(it);
+      return;
+    }
+  }
+}
+
+CefRefPtr<CefBrowser> BrowserPool::Take() {
+  if (closed_ || ready_.empty())
+    return NULL;
+  CefRefPtr<CefBrowser> browser = ready_.front();
+  ready_.erase(ready_.begin());
+  return browser;
+}
+
+bool BrowserPool::Contains(int browser_id) const {
+  const BrowserList* lists[] = {&ready_, &loading_};
+  for (size_t i = 0; i < arraysize(lists); ++i) {
+    for (size_t j = 0; j < lists[i]->size(); ++j) {
+      if ((*lists[i])[j]->GetIdentifier() == browser_id)
+        return true;
+    }
+  }
+  return false;
+}
+
+bool BrowserPool::Remove(int browser_id) {
+  return Erase(&ready_, browser_id) || Erase(&loading_, browser_id);
+}
+
+BrowserPool::BrowserList BrowserPool::Close() {
+  BrowserList browsers;
+  if (closed_)
+    return browsers;
+  closed_ = true;
+  browsers.insert(browsers.end(), ready_.begin(), ready_.end());
+  browsers.insert(browsers.end(), loading_.begin(), loading_.end());
+  return browsers;
+}
+
+void BrowserPool::OnOpen(int browser_id, Source source) {
+  PendingOpen& open = pending_[browser_id];
+  open.source = source;
+  open.open_us = NowUs();
+  open.committed = false;
+}
+
+void BrowserPool::OnColdOpen() {
+  cold_opens_.push_back(NowUs());
+}
+
+void BrowserPool::OnColdCreated(int browser_id) {
+  if (cold_opens_.empty())
+    return;
+  PendingOpen& open = pending_[browser_id];
+  open.source = SOURCE_COLD;
+  open.open_us = cold_opens_.front();
+  open.committed = false;
+  cold_opens_.pop_front();
+}
+
+void BrowserPool::OnNavigationCommitted(int browser_id) {
+  std::map<int, PendingOpen>::iterator it = pending_.find(browser_id);
+  if (it != pending_.end())
+    it->second.committed = true;
+}
+
+void BrowserPool::OnViewPaint(int browser_id) {
+  if (pending_.empty())
+    return;
+  std::map<int, PendingOpen>::iterator it = pending_.find(browser_id);
+  // A pooled browser may still paint about:blank before the navigation
+  // commits.
+  if (it == pending_.end() || !it->second.committed)
+    return;
+
+  const int64_t elapsed_us = NowUs() - it->second.open_us;
+  FirstPaintStats& stats = stats_[it->second.source];
+  stats.count++;
+  stats.total_us += elapsed_us;
+  stats.max_us = std::max(stats.max_us, elapsed_us);
+  LOG(INFO) << "Browser " << browser_id << " first paint after "
+            << elapsed_us / 1000.0 << " ms ("
+            << SourceName(it->second.source) << ")";
+  pending_.erase(it);
+}
+
+void BrowserPool::OnBrowserClosed(int browser_id) {
+  pending_.erase(browser_id);
+}
+
+int64_t BrowserPool::first_paint_count(Source source) const {
+  return stats_[source].count;
+}
+
+double BrowserPool::mean_first_paint_ms(Source source) const {
+  const FirstPaintStats& stats = stats_[source];
+  return stats.count > 0 ? stats.total_us / 1000.0 / stats.count : 0.0;
+}
+
+double BrowserPool::max_first_paint_ms(Source source) const {
+  return stats_[source].max_us / 1000.0;
+}
+
+std::string BrowserPool::Summary() const {
+  std::ostringstream ss;
+  for (int i = 0; i < SOURCE_COUNT; ++i) {
+    const Source source = static_cast<Source>(i);
+    if (i > 0)
+      ss << ", ";
+    ss << SourceName(source) << " " << first_paint_count(source) << " "
+       << mean_first_paint_ms(source) << "/" << max_first_paint_ms(source);
+  }
+  return ss.str();
+}
+
+// static
+bool BrowserPool::Erase(BrowserList* browsers, int browser_id) {
+  for (BrowserList::iterator it = browsers->begin(); it != browsers->end();
+       ++it) {
+    if ((*it)->GetIdentifier() == browser_id) {
+      browsers->erase(it);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,126 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_BROWSER_POOL_H_
+#define CEF_TESTS_CEFSIMPLE_BROWSER_POOL_H_
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/cef_browser.h"
+
+// Hidden windowless browsers parked at about:blank. A browser is handed out
+// once about:blank has loaded, so its renderer process is running. That skips
+// browser creation, the renderer process launch and the first document, so
+// only the navigation is left before the new view paints. The handler
+// creates, shows and closes the browsers; the pool keeps track of them.
+//
+// The pool also times each opened view from the open request to its first
+// paint after the navigation commits, separately for browsers taken from the
+// pool and browsers created cold. All methods must be called on the CEF UI
+// thread.
+class BrowserPool {
+ public:
+  typedef std::vector<CefRefPtr<CefBrowser>> BrowserList;
+
+  enum Source {
+    SOURCE_POOL,
+    SOURCE_COLD,
+    SOURCE_COUNT,
+  };
+
+  BrowserPool();
+
+  // Number of browsers kept parked. 0 disables the pool.
+  void set_capacity(int capacity) { capacity_ = capacity; }
+  int capacity() const { return capacity_; }
+
+  // True if another browser should be created and parked.
+  bool NeedsBrowser() const;
+
+  // Park |browser|, which must already be hidden and loading about:blank.
+  void Add(CefRefPtr<CefBrowser> browser);
+
+  // Called when |browser_id| stops loading. A parked browser becomes ready
+  // to be handed out.
+  void OnLoaded(int browser_id);
+
+  // Returns the longest ready browser, or NULL if none is ready or the pool
+  // is closed.
+  CefRefPtr<CefBrowser> Take();
+
+  bool Contains(int browser_id) const;
+
+  // Forget |browser_id| once it is closed. Returns false if it was not
+  // parked.
+  bool Remove(int browser_id);
+
+  // Stop handing out and refilling. The parked browsers stay in the pool
+  // until removed. Returns them the first time so that they can be closed.
+  BrowserList Close();
+  bool closed() const { return closed_; }
+
+  // Parked browsers, ready or still loading.
+  size_t size() const { return ready_.size() + loading_.size(); }
+  bool empty() const { return size() == 0; }
+
+  // First paint timing. OnOpen() starts timing |browser_id|. A cold browser
+  // has no id until it is created, so OnColdOpen() queues the request and
+  // OnColdCreated() attaches it to the next created browser.
+  void OnOpen(int browser_id, Source source);
+  void OnColdOpen();
+  void OnColdCreated(int browser_id);
+  void OnNavigationCommitted(int browser_id);
+  void OnViewPaint(int browser_id);
+  void OnBrowserClosed(int browser_id);
+
+  // Opens timed to first paint from |source|, and their mean and maximum.
+  int64_t first_paint_count(Source source) const;
+  double mean_first_paint_ms(Source source) const;
+  double max_first_paint_ms(Source source) const;
+
+  // "pool N mean/max, cold N mean/max" in milliseconds.
+  std::string Summary() const;
+
+ private:
+  struct PendingOpen {
+    PendingOpen() : source(SOURCE_COLD), open_us(0), committed(false) {}
+
+    Source source;
+    int64_t open_us;
+    bool committed;
+  };
+
+  struct FirstPaintStats {
+    FirstPaintStats() : count(0), total_us(0), max_us(0) {}
+
+    int64_t count;
+    int64_t total_us;
+    int64_t max_us;
+  };
+
+  static bool Erase(BrowserList* browsers, int browser_id);
+
+  int capacity_;
+  bool closed_;
+  BrowserList ready_;
+  BrowserList loading_;
+
+  // Views waiting for their first paint, keyed by browser id.
+  std::map<int, PendingOpen> pending_;
+  // Open times of cold requests whose browser is not created yet.
+  std::deque<int64_t> cold_opens_;
+  FirstPaintStats stats_[SOURCE_COUNT];
+
+  DISALLOW_COPY_AND_ASSIGN(BrowserPool);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_BROWSER_POOL_H_
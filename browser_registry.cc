@@ -0,0 +1,54 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "browser_registry.h"
+
+#include <atomic>
+
+#include "include/base/cef_logging.h"
+
+BrowserRegistry::BrowserRegistry() : snapshot_(new EntryList()) {}
+
+void BrowserRegistry::Add(CefRefPtr<CefBrowser> browser, OsrView* view) {
+  DCHECK(browser);
+  Entry entry;
+  entry.id = browser->GetIdentifier();
+  entry.browser = browser;
+  entry.host = browser->GetHost();
+  entry.view = view;
+  DCHECK(index_.find(entry.id) == index_.end());
+
+  index_[entry.id] = entries_.size();
+  entries_.push_back(entry);
+  Publish();
+}
+
+bool BrowserRegistry::Remove(int id) {
+  std::unordered_map<int, size_t>::iterator it = index_.find(id);
+  if (it == index_.end())
+    return false;
+
+  // Keep the order of the remaining entries; the layout follows it.
+  const size_t position = it->second;
+  index_.erase(it);
+  entries_.erase(entries_.begin() + position);
+  for (size_t i = position; i < entries_.size(); ++i)
+    index_[entries_[i].id] = i;
+  Publish();
+  return true;
+}
+
+const BrowserRegistry::Entry* BrowserRegistry::Find(int id) const {
+  std::unordered_map<int, size_t>::const_iterator it = index_.find(id);
+  return it != index_.end() ? &entries_[it->second] : NULL;
+}
+
+BrowserRegistry::Snapshot BrowserRegistry::GetSnapshot() const {
+  return std::atomic_load(&snapshot_);
+}
+
+void BrowserRegistry::Publish() {
+  Snapshot snapshot(new EntryList(entries_));
+  std::atomic_store(&snapshot_, snapshot);
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_BROWSER_REGISTRY_H_
+#define CEF_TESTS_CEFSIMPLE_BROWSER_REGISTRY_H_
+#pragma once
+
+#include <stddef.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/cef_browser.h"
+
+struct OsrView;
+
+// Existing browsers keyed by CefBrowser::GetIdentifier(). Each entry caches
+// the browser host, so that input and resize handling never go through
+// GetHost(), and points at the render state of the browser.
+//
+// Add() and Remove() must be called on the CEF UI thread, as must Find().
+// Other threads iterate a Snapshot, an immutable reference counted list of
+// the entries in the order they were added. Taking a snapshot copies one
+// pointer without allocating, and the snapshot stays valid and unchanged
+// while browsers are added or removed; those build a new list and publish it.
+class BrowserRegistry {
+ public:
+  struct Entry {
+    Entry() : id(-1), view(NULL) {}
+
+    int id;
+    CefRefPtr<CefBrowser> browser;
+    CefRefPtr<CefBrowserHost> host;
+    // Owned by SimpleHandler, which only touches it on the UI thread or
+    // under its views lock.
+    OsrView* view;
+  };
+  typedef std::vector<Entry> EntryList;
+  typedef std::shared_ptr<const EntryList> Snapshot;
+
+  BrowserRegistry();
+
+  // |browser| must not be registered yet.
+  void Add(CefRefPtr<CefBrowser> browser, OsrView* view);
+
+  // Returns false if |id| is not registered.
+  bool Remove(int id);
+
+  // Returns the entry of |id|, or NULL. The pointer is invalidated by the
+  // next Add() or Remove().
+  const Entry* Find(int id) const;
+
+  // May be called on any thread.
+  Snapshot GetSnapshot() const;
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+ private:
+  void Publish();
+
+  // UI thread copy of the entries and the position of each id in it.
+  EntryList entries_;
+  std::unordered_map<int, size_t> index_;
+
+  // Latest published list. Only accessed with std::atomic_load() and
+  // std::atomic_store().
+  Snapshot snapshot_;
+
+  DISALLOW_COPY_AND_ASSIGN(BrowserRegistry);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_BROWSER_REGISTRY_H_
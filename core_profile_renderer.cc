@@ -0,0 +1,395 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "core_profile_renderer.h"
+
+#include <stddef.h>
+
+#include <algorithm>
+
+namespace {
+
+enum AttributeLocation {
+  kPositionLocation = 0,
+  kTexCoordLocation,
+  kColorLocation,
+};
+
+const char kVertexShader[] =
+    "#version 150\n"
+    "in vec2 a_position;\n"
+    "in vec2 a_texcoord;\n"
+    "in vec4 a_color;\n"
+    "out vec2 v_texcoord;\n"
+    "out vec4 v_color;\n"
+    "void main() {\n"
+    "  v_texcoord = a_texcoord;\n"
+    "  v_color = a_color;\n"
+    "  gl_Position = vec4(a_position, 0.0, 1.0);\n"
+    "}\n";
+
+const char kFragmentShader[] =
+    "#version 150\n"
+    "uniform sampler2D u_texture;\n"
+    "uniform bool u_use_texture;\n"
+    "in vec2 v_texcoord;\n"
+    "in vec4 v_color;\n"
+    "out vec4 frag_color;\n"
+    "void main() {\n"
+    "  frag_color = u_use_texture ? texture(u_texture, v_texcoord) : v_color;\n"
+    "}\n";
+
+GLuint CompileShader(GLenum type, const char* source) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, NULL);
+  glCompileShader(shader);
+
+  GLint status = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024] = {0};
+    glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+    LOG(ERROR) << "Shader compilation failed: " << log;
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+// Convert a window pixel coordinate to normalized device coordinates.
+float ToNdcX(float x, int window_width) {
+  return 2.0f * x / window_width - 1.0f;
+}
+
+float ToNdcY(float y, int window_height) {
+  return 1.0f - 2.0f * y / window_height;
+}
+
+}  // namespace
+
+CoreProfileRenderer::CoreProfileRenderer()
+    : program_(0),
+      use_texture_location_(-1),
+      vertex_array_(0),
+      vertex_buffer_(0),
+      stream_array_(0),
+      stream_buffer_(0),
+      view_count_(0) {}
+
+CoreProfileRenderer::~CoreProfileRenderer() {
+  DCHECK(!IsInitialized()) << "Cleanup() must be called with a current context";
+}
+
+bool CoreProfileRenderer::Initialize(bool transparent) {
+  DCHECK(!IsInitialized());
+
+  GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, kVertexShader);
+  GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, kFragmentShader);
+  if (!vertex_shader || !fragment_shader) {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return false;
+  }
+
+  program_ = glCreateProgram();
+  glAttachShader(program_, vertex_shader);
+  glAttachShader(program_, fragment_shader);
+  glBindAttribLocation(program_, kPositionLocation, "a_position");
+  glBindAttribLocation(program_, kTexCoordLocation, "a_texcoord");
+  glBindAttribLocation(program_, kColorLocation, "a_color");
+  glBindFragDataLocation(program_, 0, "frag_color");
+  glLinkProgram(program_);
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(program_, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    char log[1024] = {0};
+    glGetProgramInfoLog(program_, sizeof(log), NULL, log);
+    LOG(ERROR) << "Program link failed: " << log;
+    glDeleteProgram(program_);
+    program_ = 0;
+    return false;
+  }
+  VERIFY_NO_ERROR;
+
+  // The program stays bound for the lifetime of the renderer.
+  glUseProgram(program_);
+  VERIFY_NO_ERROR;
+  glUniform1i(glGetUniformLocation(program_, "u_texture"), 0);
+  VERIFY_NO_ERROR;
+  use_texture_location_ = glGetUniformLocation(program_, "u_use_texture");
+
+  glGenBuffers(1, &vertex_buffer_);
+  VERIFY_NO_ERROR;
+  glGenBuffers(1, &stream_buffer_);
+  VERIFY_NO_ERROR;
+  vertex_array_ = CreateVertexArray(vertex_buffer_);
+  stream_array_ = CreateVertexArray(stream_buffer_);
+
+  if (transparent) {
+    // Texture values have premultiplied alpha. The opaque background is
+    // unaffected by this blend function, so it can stay enabled.
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    VERIFY_NO_ERROR;
+    glEnable(GL_BLEND);
+    VERIFY_NO_ERROR;
+  }
+
+  // The background gradient occupies the first four vertices.
+  vertices_.clear();
+  const Vertex background[] = {
+      {-1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f},  // red
+      {1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f},   // red
+      {1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f},    // blue
+      {-1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f}};  // blue
+  vertices_.insert(vertices_.end(), background, background + 4);
+  UploadVertices(vertex_buffer_, vertices_, GL_STATIC_DRAW);
+  view_count_ = 0;
+
+  return true;
+}
+
+void CoreProfileRenderer::Cleanup() {
+  if (!IsInitialized())
+    return;
+
+  glUseProgram(0);
+  glDeleteProgram(program_);
+  program_ = 0;
+  glDeleteVertexArrays(1, &vertex_array_);
+  glDeleteVertexArrays(1, &stream_array_);
+  vertex_array_ = stream_array_ = 0;
+  glDeleteBuffers(1, &vertex_buffer_);
+  glDeleteBuffers(1, &stream_buffer_);
+  vertex_buffer_ = stream_buffer_ = 0;
+  VERIFY_NO_ERROR;
+  view_count_ = 0;
+}
+
+void CoreProfileRenderer::SetViewQuads(const std::vector<ViewQuad>& quads,
+                                       int window_width,
+                                       int window_height) {
+  DCHECK(IsInitialized());
+  if (window_width <= 0 || window_height <= 0)
+    return;
+
+  // Keep the background and replace the view quads. Texture row 0 is the
+  // top of the page.
+  vertices_.resize(4);
+  for (size_t i = 0; i < quads.size(); ++i) {
+    const CefRect& rect = quads[i].rect;
+    const float left = ToNdcX(rect.x, window_width);
+    const float right = ToNdcX(rect.x + rect.width, window_width);
+    const float top = ToNdcY(rect.y, window_height);
+    const float bottom = ToNdcY(rect.y + rect.height, window_height);
+    const float u = quads[i].max_u;
+    const float v = quads[i].max_v;
+    const Vertex quad[] = {{left, bottom, 0.0f, v, 1.0f, 1.0f, 1.0f, 1.0f},
+                           {right, bottom, u, v, 1.0f, 1.0f, 1.0f, 1.0f},
+                           {right, top, u, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+                           {left, top, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f}};
+    vertices_.insert(vertices_.end(), quad, quad + 4);
+  }
+  UploadVertices(vertex_buffer_, vertices_, GL_STATIC_DRAW);
+  view_count_ = static_cast<int>(quads.size());
+}
+
+void CoreProfileRenderer::Draw(const std::vector<GLuint>& textures) {
+  DCHECK(IsInitialized());
+
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  VERIFY_NO_ERROR;
+
+  glBindVertexArray(vertex_array_);
+  VERIFY_NO_ERROR;
+
+  // Draw the background gradient.
+  glUniform1i(use_texture_location_, 0);
+  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+  VERIFY_NO_ERROR;
+
+  // Draw the views. Only the texture binding changes between draws.
+  glUniform1i(use_texture_location_, 1);
+  const int count = std::min(view_count_, static_cast<int>(textures.size()));
+  for (int i = 0; i < count; ++i) {
+    if (textures[i] == 0)
+      continue;
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glDrawArrays(GL_TRIANGLE_FAN, 4 + i * 4, 4);
+  }
+  VERIFY_NO_ERROR;
+}
+
+void CoreProfileRenderer::DrawOverlays(const std::vector<CefRect>& rects,
+                                       const std::vector<CefRect>& clip_rects,
+                                       const std::vector<GLuint>& textures,
+                                       int window_width,
+                                       int window_height) {
+  DCHECK(IsInitialized());
+  DCHECK_EQ(rects.size(), clip_rects.size());
+  DCHECK_EQ(rects.size(), textures.size());
+  if (rects.empty() || window_width <= 0 || window_height <= 0)
+    return;
+
+  std::vector<Vertex> vertices;
+  vertices.reserve(rects.size() * 4);
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const CefRect& rect = rects[i];
+    const float left = ToNdcX(rect.x, window_width);
+    const float right = ToNdcX(rect.x + rect.width, window_width);
+    const float top = ToNdcY(rect.y, window_height);
+    const float bottom = ToNdcY(rect.y + rect.height, window_height);
+    const Vertex quad[] = {
+        {left, bottom, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+        {right, bottom, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+        {right, top, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+        {left, top, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f}};
+    vertices.insert(vertices.end(), quad, quad + 4);
+  }
+  UploadVertices(stream_buffer_, vertices, GL_STREAM_DRAW);
+
+  // The viewport may be larger than the window on high-DPI displays.
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  const float scale_x = static_cast<float>(viewport[2]) / window_width;
+  const float scale_y = static_cast<float>(viewport[3]) / window_height;
+
+  glBindVertexArray(stream_array_);
+  VERIFY_NO_ERROR;
+  glUniform1i(use_texture_location_, 1);
+  glEnable(GL_SCISSOR_TEST);
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const CefRect& clip = clip_rects[i];
+    glScissor(viewport[0] + static_cast<GLint>(clip.x * scale_x),
+              viewport[1] + static_cast<GLint>(
+                                (window_height - clip.y - clip.height) *
+                                scale_y),
+              static_cast<GLsizei>(clip.width * scale_x),
+              static_cast<GLsizei>(clip.height * scale_y));
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glDrawArrays(GL_TRIANGLE_FAN, static_cast<GLint>(i * 4), 4);
+  }
+  glDisable(GL_SCISSOR_TEST);
+  VERIFY_NO_ERROR;
+}
+
+void CoreProfileRenderer::DrawRects(const std::vector<CefRect>& rects,
+                                    const std::vector<cef_color_t>& colors,
+                                    int window_width,
+                                    int window_height) {
+  DCHECK(IsInitialized());
+  DCHECK_EQ(rects.size(), colors.size());
+  if (rects.empty() || window_width <= 0 || window_height <= 0)
+    return;
+
+  // Two triangles per rectangle so that everything is a single draw call.
+  std::vector<Vertex> vertices;
+  vertices.reserve(rects.size() * 6);
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const CefRect& rect = rects[i];
+    const float l = ToNdcX(rect.x, window_width);
+    const float r = ToNdcX(rect.x + rect.width, window_width);
+    const float t = ToNdcY(rect.y, window_height);
+    const float b = ToNdcY(rect.y + rect.height, window_height);
+    const float red = CefColorGetR(colors[i]) / 255.0f;
+    const float green = CefColorGetG(colors[i]) / 255.0f;
+    const float blue = CefColorGetB(colors[i]) / 255.0f;
+    const float alpha = CefColorGetA(colors[i]) / 255.0f;
+    const Vertex quad[] = {{l, b, 0.0f, 0.0f, red, green, blue, alpha},
+                           {r, b, 0.0f, 0.0f, red, green, blue, alpha},
+                           {r, t, 0.0f, 0.0f, red, green, blue, alpha},
+                           {l, b, 0.0f, 0.0f, red, green, blue, alpha},
+                           {r, t, 0.0f, 0.0f, red, green, blue, alpha},
+                           {l, t, 0.0f, 0.0f, red, green, blue, alpha}};
+    vertices.insert(vertices.end(), quad, quad + 6);
+  }
+  UploadVertices(stream_buffer_, vertices, GL_STREAM_DRAW);
+
+  glBindVertexArray(stream_array_);
+  VERIFY_NO_ERROR;
+  glUniform1i(use_texture_location_, 0);
+  glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+  VERIFY_NO_ERROR;
+}
+
+void CoreProfileRenderer::DrawOutlines(const std::vector<CefRect>& rects,
+                                       int window_width,
+                                       int window_height) {
+  DCHECK(IsInitialized());
+  if (rects.empty() || window_width <= 0 || window_height <= 0)
+    return;
+
+  std::vector<Vertex> vertices;
+  vertices.reserve(rects.size() * 4);
+  for (size_t i = 0; i < rects.size(); ++i) {
+    int left = rects[i].x;
+    int right = rects[i].x + rects[i].width;
+    int top = rects[i].y;
+    int bottom = rects[i].y + rects[i].height;
+
+#if defined(OS_LINUX)
+    // Shrink the box so that top & right sides are drawn.
+    top += 1;
+    right -= 1;
+#else
+    // Shrink the box so that left & bottom sides are drawn.
+    left += 1;
+    bottom -= 1;
+#endif
+
+    const float l = ToNdcX(left, window_width);
+    const float r = ToNdcX(right, window_width);
+    const float t = ToNdcY(top, window_height);
+    const float b = ToNdcY(bottom, window_height);
+    const Vertex outline[] = {{l, t, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+                              {r, t, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+                              {r, b, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f},
+                              {l, b, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f}};
+    vertices.insert(vertices.end(), outline, outline + 4);
+  }
+  UploadVertices(stream_buffer_, vertices, GL_STREAM_DRAW);
+
+  glBindVertexArray(stream_array_);
+  VERIFY_NO_ERROR;
+  glUniform1i(use_texture_location_, 0);
+  for (size_t i = 0; i < rects.size(); ++i)
+    glDrawArrays(GL_LINE_LOOP, static_cast<GLint>(i * 4), 4);
+  VERIFY_NO_ERROR;
+}
+
+// static
+GLuint CoreProfileRenderer::CreateVertexArray(GLuint buffer) {
+  GLuint vertex_array = 0;
+  glGenVertexArrays(1, &vertex_array);
+  glBindVertexArray(vertex_array);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glEnableVertexAttribArray(kPositionLocation);
+  glVertexAttribPointer(kPositionLocation, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex),
+                        reinterpret_cast<void*>(offsetof(Vertex, x)));
+  glEnableVertexAttribArray(kTexCoordLocation);
+  glVertexAttribPointer(kTexCoordLocation, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex),
+                        reinterpret_cast<void*>(offsetof(Vertex, u)));
+  glEnableVertexAttribArray(kColorLocation);
+  glVertexAttribPointer(kColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        reinterpret_cast<void*>(offsetof(Vertex, r)));
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  VERIFY_NO_ERROR;
+  return vertex_array;
+}
+
+// static
+void CoreProfileRenderer::UploadVertices(GLuint buffer,
+                                         const std::vector<Vertex>& vertices,
+                                         GLenum usage) {
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+               vertices.empty() ? NULL : &vertices[0], usage);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  VERIFY_NO_ERROR;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_CORE_PROFILE_RENDERER_H_
+#define CEF_TESTS_CEFSIMPLE_CORE_PROFILE_RENDERER_H_
+#pragma once
+
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/internal/cef_types_wrappers.h"
+#include "osr_gl.h"
+
+// Draws the background gradient and the view textures with a single shader
+// program and vertex array object. Requires an OpenGL 3.2 core profile
+// context. All state is set up once in Initialize(), so a frame costs one
+// draw call for the background and one per view.
+class CoreProfileRenderer {
+ public:
+  CoreProfileRenderer();
+  ~CoreProfileRenderer();
+
+  // Must be called with a current context. |transparent| enables blending of
+  // the premultiplied view textures over the background.
+  bool Initialize(bool transparent);
+  void Cleanup();
+
+  bool IsInitialized() const { return program_ != 0; }
+
+  struct ViewQuad {
+    // On-screen rectangle of the view.
+    CefRect rect;
+    // Texture coordinates of the bottom-right corner of the view contents.
+    float max_u;
+    float max_v;
+  };
+
+  // Set the view quads. Rectangles are in pixels of a |window_width| x
+  // |window_height| window with a top-left origin.
+  void SetViewQuads(const std::vector<ViewQuad>& quads,
+                    int window_width,
+                    int window_height);
+
+  // Draw the background followed by one quad per view rectangle. A zero
+  // entry in |textures| skips that view.
+  void Draw(const std::vector<GLuint>& textures);
+
+  // Draw |textures[i]| over |rects[i]|, clipped to |clip_rects[i]|. Used for
+  // popups, whose rectangles change too often for the static view buffer.
+  // Rectangles are given in the same coordinates as SetViewQuads().
+  void DrawOverlays(const std::vector<CefRect>& rects,
+                    const std::vector<CefRect>& clip_rects,
+                    const std::vector<GLuint>& textures,
+                    int window_width,
+                    int window_height);
+
+  // Fill |rects| with the matching |colors|, given in the same coordinates
+  // as SetViewQuads().
+  void DrawRects(const std::vector<CefRect>& rects,
+                 const std::vector<cef_color_t>& colors,
+                 int window_width,
+                 int window_height);
+
+  // Draw red outlines around |rects|, given in the same coordinates as
+  // SetViewQuads().
+  void DrawOutlines(const std::vector<CefRect>& rects,
+                    int window_width,
+                    int window_height);
+
+ private:
+  struct Vertex {
+    float x, y;
+    float u, v;
+    float r, g, b, a;
+  };
+
+  // Create a vertex array that sources Vertex attributes from |buffer|.
+  static GLuint CreateVertexArray(GLuint buffer);
+
+  static void UploadVertices(GLuint buffer,
+                             const std::vector<Vertex>& vertices,
+                             GLenum usage);
+
+  GLuint program_;
+  GLint use_texture_location_;
+  GLuint vertex_array_;
+  GLuint vertex_buffer_;
+  // Streamed vertices for outlines and overlays.
+  GLuint stream_array_;
+  GLuint stream_buffer_;
+  int view_count_;
+  std::vector<Vertex> vertices_;
+
+  DISALLOW_COPY_AND_ASSIGN(CoreProfileRenderer);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_CORE_PROFILE_RENDERER_H_
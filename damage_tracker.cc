@@ -0,0 +1,50 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "damage_tracker.h"
+
+#include <chrono>
+
+DamageTracker::DamageTracker()
+    : dirty_(true),
+      dirty_since_us_(0),
+      presented_frames_(0),
+      skipped_frames_(0),
+      last_present_us_(0) {}
+
+void DamageTracker::Invalidate() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!dirty_) {
+      dirty_since_us_ =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+              .count();
+    }
+    dirty_ = true;
+  }
+  condition_.notify_one();
+}
+
+bool DamageTracker::ConsumeDamage() {
+  return dirty_.exchange(false);
+}
+
+bool DamageTracker::WaitForDamage(int timeout_ms) {
+  if (ConsumeDamage())
+    return true;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                      [this] { return dirty_.load(); });
+  return dirty_.exchange(false);
+}
+
+void DamageTracker::OnFramePresented() {
+  presented_frames_++;
+  last_present_us_ =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+}
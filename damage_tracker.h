@@ -0,0 +1,67 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_DAMAGE_TRACKER_H_
+#define CEF_TESTS_CEFSIMPLE_DAMAGE_TRACKER_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "include/base/cef_macros.h"
+
+// Tracks whether the window contents changed since the last present so that
+// the render loop can skip clearing, drawing and swapping when nothing did.
+// The frame is marked dirty by OnPaint, popup show/hide and layout changes.
+class DamageTracker {
+ public:
+  DamageTracker();
+
+  // Mark the frame dirty. May be called from any thread.
+  void Invalidate();
+
+  // Returns true and clears the dirty flag if a frame needs to be drawn.
+  bool ConsumeDamage();
+
+  bool IsDirty() const { return dirty_; }
+
+  // Steady clock time in microseconds at which the frame was first marked
+  // dirty since it was last drawn, or 0 if it is not dirty or the time is
+  // unknown.
+  int64_t dirty_since_us() const {
+    return dirty_ ? dirty_since_us_.load() : 0;
+  }
+
+  // Like ConsumeDamage() but waits up to |timeout_ms| for the frame to be
+  // marked dirty.
+  bool WaitForDamage(int timeout_ms);
+
+  // Record the outcome of one render loop iteration. May be called from any
+  // thread.
+  void OnFramePresented();
+  void OnFrameSkipped() { skipped_frames_++; }
+
+  int64_t presented_frames() const { return presented_frames_; }
+  int64_t skipped_frames() const { return skipped_frames_; }
+
+  // Steady clock time of the last present in microseconds, or 0.
+  int64_t last_present_us() const { return last_present_us_; }
+
+ private:
+  std::atomic<bool> dirty_;
+  std::atomic<int64_t> dirty_since_us_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+
+  std::atomic<int64_t> presented_frames_;
+  std::atomic<int64_t> skipped_frames_;
+  std::atomic<int64_t> last_present_us_;
+
+  DISALLOW_COPY_AND_ASSIGN(DamageTracker);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_DAMAGE_TRACKER_H_
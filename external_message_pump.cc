@@ -0,0 +1,61 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "external_message_pump.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "include/base/cef_logging.h"
+#include "include/cef_app.h"
+
+namespace {
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+ExternalMessagePump::ExternalMessagePump(WakeFunction wake)
+    : wake_(wake), due_us_(NowUs()), work_requests_(0), work_runs_(0) {
+  DCHECK(wake_);
+}
+
+void ExternalMessagePump::ScheduleWork(int64_t delay_ms) {
+  work_requests_++;
+
+  const int64_t delay_us =
+      delay_ms <= 0 ? 0 : std::min(delay_ms * 1000, kMaxWorkDelayUs);
+  const int64_t due_us = NowUs() + delay_us;
+
+  // The main loop sized its wait for the previous due time; only wake it if
+  // the work must run earlier than that. A request made from inside
+  // DoWorkIfDue() wakes the next wait, so the work runs again right after.
+  const int64_t previous = due_us_.exchange(due_us);
+  if (due_us < previous)
+    wake_();
+}
+
+int64_t ExternalMessagePump::TimeUntilWorkUs() const {
+  const int64_t delay_us = due_us_.load() - NowUs();
+  return delay_us > 0 ? delay_us : 0;
+}
+
+bool ExternalMessagePump::DoWorkIfDue() {
+  const int64_t now_us = NowUs();
+  int64_t due_us = due_us_.load();
+  if (due_us > now_us)
+    return false;
+
+  // Fall back to the safety interval unless CEF asks for work while it runs.
+  // If a request raced in since the load it is already due, so keep it.
+  due_us_.compare_exchange_strong(due_us, now_us + kMaxWorkDelayUs);
+
+  work_runs_++;
+  CefDoMessageLoopWork();
+  return true;
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_EXTERNAL_MESSAGE_PUMP_H_
+#define CEF_TESTS_CEFSIMPLE_EXTERNAL_MESSAGE_PUMP_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "include/base/cef_macros.h"
+
+// Schedules CefDoMessageLoopWork() for a main loop that runs CEF with
+// CefSettings.external_message_pump enabled. CEF asks for work through
+// CefBrowserProcessHandler::OnScheduleMessagePumpWork() on any thread. The
+// main loop sleeps until TimeUntilWorkUs() has elapsed or it is woken, then
+// calls DoWorkIfDue(), so no CEF work runs while nothing is scheduled.
+class ExternalMessagePump {
+ public:
+  typedef void (*WakeFunction)();
+
+  // Longest the pump goes without running CEF work. CEF may not schedule
+  // every task through OnScheduleMessagePumpWork(), so work also runs at this
+  // interval, as in cefclient.
+  static const int64_t kMaxWorkDelayUs = 1000000 / 30;
+
+  // |wake| is called on the requesting thread when work becomes due sooner
+  // than the main loop expects and must interrupt its wait.
+  explicit ExternalMessagePump(WakeFunction wake);
+
+  // Run CEF work after |delay_ms|, replacing any pending request. May be
+  // called on any thread, including from inside DoWorkIfDue().
+  void ScheduleWork(int64_t delay_ms);
+
+  // Microseconds until work is due, or 0 if it is due now.
+  int64_t TimeUntilWorkUs() const;
+
+  // Runs CefDoMessageLoopWork() if work is due. Returns true if it ran. Must
+  // be called on the main thread.
+  bool DoWorkIfDue();
+
+  int64_t work_requests() const { return work_requests_; }
+  int64_t work_runs() const { return work_runs_; }
+
+ private:
+  WakeFunction wake_;
+
+  // Steady clock time in microseconds at which work is due.
+  std::atomic<int64_t> due_us_;
+
+  std::atomic<int64_t> work_requests_;
+  int64_t work_runs_;
+
+  DISALLOW_COPY_AND_ASSIGN(ExternalMessagePump);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_EXTERNAL_MESSAGE_PUMP_H_
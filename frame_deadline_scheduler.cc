@@ -0,0 +1,148 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "frame_deadline_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+// Weight of the newest sample in the cost moving averages.
+const double kCostWeight = 0.2;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+FrameDeadlineScheduler::FrameDeadlineScheduler()
+    : interval_us_(16667),
+      last_present_us_(0),
+      render_cost_us_(0),
+      slice_cost_us_(0),
+      swap_cost_us_(-1),
+      window_swap_us_(0),
+      window_frames_(0),
+      work_us_(0),
+      budget_used_percent_(0),
+      deferred_since_us_(0),
+      missed_deadlines_(0),
+      deferred_slices_(0) {}
+
+void FrameDeadlineScheduler::SetPresentInterval(double interval_ms) {
+  DCHECK_GT(interval_ms, 0);
+  interval_us_ =
+      std::max<int64_t>(1000, static_cast<int64_t>(interval_ms * 1000));
+}
+
+bool FrameDeadlineScheduler::OnFramePresented(int64_t present_us,
+                                              int64_t render_us,
+                                              int64_t swap_us,
+                                              int64_t damage_us) {
+  // The frame could have made the first deadline after it was invalidated
+  // that left room to render it.
+  bool missed = false;
+  if (damage_us != 0 && HasDeadline(damage_us)) {
+    const int64_t deadline = DeadlineAfter(damage_us + frame_cost_us());
+    missed = present_us > deadline + interval_us_ / 2;
+  }
+  if (missed)
+    missed_deadlines_++;
+
+  const int64_t budget_us =
+      std::max<int64_t>(1, interval_us_ - frame_cost_us());
+  budget_used_percent_ = 100.0 * work_us_ / budget_us;
+  work_us_ = 0;
+
+  if (last_present_us_ == 0)
+    render_cost_us_ = render_us;
+  else
+    render_cost_us_ += kCostWeight * (render_us - render_cost_us_);
+
+  window_swap_us_ =
+      window_frames_ ? std::min(window_swap_us_, swap_us) : swap_us;
+  if (++window_frames_ >= kSwapCostWindow) {
+    swap_cost_us_ = window_swap_us_;
+    window_frames_ = 0;
+  } else if (swap_cost_us_ < 0 || window_swap_us_ < swap_cost_us_) {
+    swap_cost_us_ = window_swap_us_;
+  }
+
+  last_present_us_ = present_us;
+  return missed;
+}
+
+bool FrameDeadlineScheduler::ShouldRunSlice() {
+  const int64_t budget_us = RemainingBudgetUs();
+  if (budget_us < 0 || budget_us >= slice_cost_us_) {
+    deferred_since_us_ = 0;
+    return true;
+  }
+
+  // A slice that never fits in a frame still runs once per interval.
+  const int64_t now = NowUs();
+  if (deferred_since_us_ != 0 && now - deferred_since_us_ >= interval_us_) {
+    deferred_since_us_ = 0;
+    return true;
+  }
+
+  if (deferred_since_us_ == 0)
+    deferred_since_us_ = now;
+  deferred_slices_++;
+  return false;
+}
+
+bool FrameDeadlineScheduler::OnSliceDone(int64_t slice_us) {
+  work_us_ += slice_us;
+  if (slice_us < kIdleSliceUs)
+    return false;
+  if (slice_cost_us_ == 0)
+    slice_cost_us_ = slice_us;
+  else
+    slice_cost_us_ += kCostWeight * (slice_us - slice_cost_us_);
+  return true;
+}
+
+int64_t FrameDeadlineScheduler::RemainingBudgetUs() const {
+  const int64_t now = NowUs();
+  if (!HasDeadline(now))
+    return -1;
+  // Aim at the first deadline that a frame invalidated now could still make.
+  const int64_t cost_us = frame_cost_us();
+  return DeadlineAfter(now + cost_us) - cost_us - now;
+}
+
+int64_t FrameDeadlineScheduler::TimeUntilDeferredWorkUs() const {
+  if (deferred_since_us_ == 0)
+    return -1;
+  const int64_t budget_us = RemainingBudgetUs();
+  if (budget_us < 0)
+    return 0;
+  const int64_t starved_us = deferred_since_us_ + interval_us_ - NowUs();
+  return std::max<int64_t>(0, std::min(budget_us, starved_us));
+}
+
+int64_t FrameDeadlineScheduler::frame_cost_us() const {
+  return static_cast<int64_t>(render_cost_us_) +
+         std::max<int64_t>(0, swap_cost_us_) + kSafetyMarginUs;
+}
+
+int64_t FrameDeadlineScheduler::DeadlineAfter(int64_t time_us) const {
+  if (time_us <= last_present_us_)
+    return last_present_us_ + interval_us_;
+  const int64_t intervals = (time_us - last_present_us_ + interval_us_ - 1) /
+                            interval_us_;
+  return last_present_us_ + intervals * interval_us_;
+}
+
+bool FrameDeadlineScheduler::HasDeadline(int64_t now_us) const {
+  return last_present_us_ != 0 &&
+         now_us - last_present_us_ < kIdleIntervals * interval_us_;
+}
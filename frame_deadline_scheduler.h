@@ -0,0 +1,107 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_FRAME_DEADLINE_SCHEDULER_H_
+#define CEF_TESTS_CEFSIMPLE_FRAME_DEADLINE_SCHEDULER_H_
+#pragma once
+
+#include <stdint.h>
+
+#include "include/base/cef_macros.h"
+
+// Keeps message loop work from delaying presents. Presents are aligned to the
+// display interval, so the next deadline is the last present plus a whole
+// number of intervals, and a frame must start rendering its measured Render()
+// and swap cost before it. CefDoMessageLoopWork() slices run only while the
+// next slice is expected to finish before then; the rest waits until the
+// render start has passed, which is after the present when a frame is drawn.
+//
+// Deadlines are only enforced while frames are being presented. All methods
+// must be called on the main thread.
+class FrameDeadlineScheduler {
+ public:
+  // Time kept back before the render start for wakeup and timer jitter.
+  static const int64_t kSafetyMarginUs = 1000;
+  // A slice shorter than this found no work to do.
+  static const int64_t kIdleSliceUs = 100;
+  // Intervals without a present after which deadlines are no longer enforced.
+  static const int kIdleIntervals = 2;
+  // Presents over which the shortest swap is taken as the swap cost. Longer
+  // swaps include the wait for vsync.
+  static const int kSwapCostWindow = 60;
+
+  FrameDeadlineScheduler();
+
+  void SetPresentInterval(double interval_ms);
+  double present_interval_ms() const { return interval_us_ / 1000.0; }
+
+  // A frame was presented at |present_us| after spending |render_us| in
+  // Render() and |swap_us| in the swap. |damage_us| is when the frame was
+  // first invalidated, or 0 if unknown. Returns true if the present missed
+  // the first deadline the frame could have made.
+  bool OnFramePresented(int64_t present_us,
+                        int64_t render_us,
+                        int64_t swap_us,
+                        int64_t damage_us);
+
+  // Returns true if the next message loop slice should run now. Returns false
+  // and counts a deferral if it would run into the render start of the next
+  // frame.
+  bool ShouldRunSlice();
+
+  // A slice started by ShouldRunSlice() took |slice_us|. Returns true if it
+  // did work.
+  bool OnSliceDone(int64_t slice_us);
+
+  // Microseconds of message loop work that fit before the next render start,
+  // or -1 if no deadline is enforced.
+  int64_t RemainingBudgetUs() const;
+
+  // Microseconds until the next render start has passed while work is
+  // deferred, or -1 if no work is deferred.
+  int64_t TimeUntilDeferredWorkUs() const;
+
+  // Message loop time between the last two presents as a percentage of the
+  // budget of a frame.
+  double budget_used_percent() const { return budget_used_percent_; }
+
+  int64_t missed_deadlines() const { return missed_deadlines_; }
+  int64_t deferred_slices() const { return deferred_slices_; }
+
+  // Estimated time from the render start to the end of the swap, including
+  // the safety margin.
+  int64_t frame_cost_us() const;
+
+ private:
+  // First deadline at or after |time_us|.
+  int64_t DeadlineAfter(int64_t time_us) const;
+  bool HasDeadline(int64_t now_us) const;
+
+  int64_t interval_us_;
+  int64_t last_present_us_;
+
+  // Moving averages of the Render() and slice costs.
+  double render_cost_us_;
+  double slice_cost_us_;
+
+  // Shortest swap in the previous window, lowered by shorter swaps in the
+  // current one. -1 until the first present.
+  int64_t swap_cost_us_;
+  int64_t window_swap_us_;
+  int window_frames_;
+
+  // Message loop time since the last present.
+  int64_t work_us_;
+  double budget_used_percent_;
+
+  // When the first slice was deferred, or 0 if none is.
+  int64_t deferred_since_us_;
+
+  int64_t missed_deadlines_;
+  int64_t deferred_slices_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameDeadlineScheduler);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_FRAME_DEADLINE_SCHEDULER_H_
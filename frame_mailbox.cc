@@ -0,0 +1,144 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "frame_mailbox.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+// Clip every rectangle in |rects| to a |width| x |height| frame and drop the
+// ones that end up empty.
+void ClipRects(std::vector<CefRect>* rects, int width, int height) {
+  size_t out = 0;
+  for (size_t i = 0; i < rects->size(); ++i) {
+    CefRect rect = (*rects)[i];
+    const int right = std::min(rect.x + rect.width, width);
+    const int bottom = std::min(rect.y + rect.height, height);
+    rect.x = std::max(rect.x, 0);
+    rect.y = std::max(rect.y, 0);
+    rect.width = right - rect.x;
+    rect.height = bottom - rect.y;
+    if (rect.width > 0 && rect.height > 0)
+      (*rects)[out++] = rect;
+  }
+  rects->resize(out);
+}
+
+}  // namespace
+
+FrameMailbox::FrameMailbox()
+    : middle_(1), back_(0), last_width_(0), last_height_(0), front_(2) {}
+
+void FrameMailbox::Publish(const RectList& dirtyRects,
+                           const void* buffer,
+                           int width,
+                           int height) {
+  DCHECK(buffer);
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+  const CefRect full(0, 0, width, height);
+  const bool resized = width != last_width_ || height != last_height_;
+
+  // Damage of this paint relative to the previously published frame.
+  scratch_.clear();
+  if (resized)
+    scratch_.push_back(full);
+  else
+    scratch_.assign(dirtyRects.begin(), dirtyRects.end());
+
+  Frame* frame = &frames_[back_];
+  if (frame->width != width || frame->height != height) {
+    frame->pixels.resize(static_cast<size_t>(width) * height * 4);
+    frame->width = width;
+    frame->height = height;
+    memcpy(&frame->pixels[0], src, frame->pixels.size());
+  } else {
+    // Bring the regions changed by frames published since this buffer was
+    // last written up to date, then apply the new damage.
+    CopyRects(stale_[back_], src, frame);
+    CopyRects(scratch_, src, frame);
+  }
+  stale_[back_].clear();
+
+  for (int i = 0; i < 3; ++i) {
+    if (i == back_)
+      continue;
+    if (resized) {
+      stale_[i].assign(1, full);
+    } else {
+      AddDamage(scratch_, &stale_[i]);
+    }
+  }
+
+  // Report everything the reader has not seen yet.
+  if (resized) {
+    frame->damage.assign(1, full);
+  } else {
+    frame->damage.assign(carry_.begin(), carry_.end());
+    AddDamage(scratch_, &frame->damage);
+    ClipRects(&frame->damage, width, height);
+  }
+
+  last_width_ = width;
+  last_height_ = height;
+
+  const int previous =
+      middle_.exchange(back_ | kFreshBit, std::memory_order_acq_rel);
+
+  // If the previously published frame was never acquired its damage is
+  // already part of this frame's and must be carried into the next one.
+  // Otherwise the reader is only missing this frame's damage.
+  if (previous & kFreshBit)
+    carry_.assign(frame->damage.begin(), frame->damage.end());
+  else
+    carry_.assign(scratch_.begin(), scratch_.end());
+
+  back_ = previous & kIndexMask;
+}
+
+const FrameMailbox::Frame* FrameMailbox::Acquire() {
+  if (!HasNewFrame())
+    return NULL;
+
+  const int previous = middle_.exchange(front_, std::memory_order_acq_rel);
+  front_ = previous & kIndexMask;
+  return &frames_[front_];
+}
+
+bool FrameMailbox::HasNewFrame() const {
+  return (middle_.load(std::memory_order_acquire) & kFreshBit) != 0;
+}
+
+void FrameMailbox::AddDamage(const RectList& rects, RectList* list) {
+  list->insert(list->end(), rects.begin(), rects.end());
+  if (list->size() > kMaxDamageRects) {
+    coalescer_.Coalesce(*list, &coalesced_);
+    list->swap(coalesced_);
+  }
+}
+
+// static
+void FrameMailbox::CopyRects(const RectList& rects,
+                             const uint8_t* src,
+                             Frame* frame) {
+  const size_t stride = static_cast<size_t>(frame->width) * 4;
+  uint8_t* dst = &frame->pixels[0];
+  for (RectList::const_iterator it = rects.begin(); it != rects.end(); ++it) {
+    const int left = std::max(it->x, 0);
+    const int top = std::max(it->y, 0);
+    const int right = std::min(it->x + it->width, frame->width);
+    const int bottom = std::min(it->y + it->height, frame->height);
+    if (right <= left || bottom <= top)
+      continue;
+
+    const size_t row_bytes = static_cast<size_t>(right - left) * 4;
+    size_t offset = top * stride + static_cast<size_t>(left) * 4;
+    for (int row = top; row < bottom; ++row, offset += stride)
+      memcpy(dst + offset, src + offset, row_bytes);
+  }
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_FRAME_MAILBOX_H_
+#define CEF_TESTS_CEFSIMPLE_FRAME_MAILBOX_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/internal/cef_types_wrappers.h"
+#include "rect_coalescer.h"
+
+// Lock-free triple buffer that hands OnPaint frames to the renderer. The
+// writer (OnPaint) copies the damaged regions into its private buffer and
+// publishes it with an atomic exchange. The reader (Render) exchanges its
+// buffer for the latest published one. Neither side ever waits for the other,
+// so paint and present can run at different rates, and the reader never sees
+// a partially updated frame.
+//
+// Publish() must always be called from the same thread, as must Acquire().
+class FrameMailbox {
+ public:
+  typedef std::vector<CefRect> RectList;
+
+  struct Frame {
+    Frame() : width(0), height(0) {}
+
+    // BGRA pixels with a stride of |width| * 4.
+    std::vector<uint8_t> pixels;
+    int width;
+    int height;
+
+    // Union of the damage of every frame published since the reader last
+    // acquired a frame. Covers the whole frame after a size change.
+    RectList damage;
+  };
+
+  FrameMailbox();
+
+  // Writer side. Copy |dirtyRects| of |buffer| into the back frame and
+  // publish it.
+  void Publish(const RectList& dirtyRects,
+               const void* buffer,
+               int width,
+               int height);
+
+  // Reader side. Returns the latest published frame, or NULL if nothing was
+  // published since the last call. The frame remains valid and unchanged
+  // until the next call.
+  const Frame* Acquire();
+
+  // Returns true if a frame was published and not yet acquired.
+  bool HasNewFrame() const;
+
+ private:
+  static const int kFreshBit = 0x4;
+  static const int kIndexMask = 0x3;
+
+  // Limit on tracked damage rectangles before they are coalesced.
+  static const size_t kMaxDamageRects = 16;
+
+  // Append |rects| to |list|, coalescing once it grows too long.
+  void AddDamage(const RectList& rects, RectList* list);
+
+  static void CopyRects(const RectList& rects,
+                        const uint8_t* src,
+                        Frame* frame);
+
+  Frame frames_[3];
+
+  // Index of the published frame, with kFreshBit set until it is acquired.
+  std::atomic<int> middle_;
+
+  // Writer-owned state.
+  int back_;
+  int last_width_;
+  int last_height_;
+  // Regions of each frame that are older than the latest published frame.
+  RectList stale_[3];
+  // Damage published but not yet known to be acquired.
+  RectList carry_;
+  RectList scratch_;
+  RectList coalesced_;
+  RectCoalescer coalescer_;
+
+  // Reader-owned state.
+  int front_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameMailbox);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_FRAME_MAILBOX_H_
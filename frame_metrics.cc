@@ -0,0 +1,240 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "frame_metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+const char* const kMetricNames[] = {
+    "frame_ms",           "paint_count",      "paint_arrival_ms",
+    "dirty_rects",        "dirty_area",       "damage_saved_bytes",
+    "damage_filter_ms",   "upload_bytes",     "upload_ms",
+    "render_ms",          "swap_ms",          "message_loop_ms",
+    "budget_used_pct",    "deadline_missed"};
+static_assert(sizeof(kMetricNames) / sizeof(kMetricNames[0]) ==
+                  FrameMetrics::METRIC_COUNT,
+              "kMetricNames must match FrameMetrics::Metric");
+
+bool EndsWith(const std::string& value, const std::string& suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) ==
+             0;
+}
+
+}  // namespace
+
+FrameMetrics::ScopedTimer::ScopedTimer(FrameMetrics* metrics, Metric metric)
+    : metrics_(metrics),
+      metric_(metric),
+      start_(std::chrono::steady_clock::now()) {}
+
+FrameMetrics::ScopedTimer::~ScopedTimer() {
+  metrics_->AddTime(metric_,
+                    std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start_)
+                        .count());
+}
+
+FrameMetrics::FrameMetrics()
+    : frame_count_(0), last_present_us_(0), idle_(false), frame_start_us_(0) {
+  memset(&pending_, 0, sizeof(pending_));
+  memset(&totals_, 0, sizeof(totals_));
+  scratch_.reserve(kCapacity);
+}
+
+void FrameMetrics::RecordPaint(int dirty_rects, int64_t dirty_area) {
+  const int64_t now = NowUs();
+  base::AutoLock lock_scope(lock_);
+  if (pending_.values[PAINT_COUNT] == 0) {
+    if (idle_)
+      frame_start_us_ = now;
+    else if (last_present_us_ != 0)
+      pending_.values[PAINT_ARRIVAL_MS] = (now - last_present_us_) / 1000.0;
+  }
+  pending_.values[PAINT_COUNT] += 1;
+  pending_.values[DIRTY_RECTS] += dirty_rects;
+  pending_.values[DIRTY_AREA] += static_cast<double>(dirty_area);
+}
+
+void FrameMetrics::RecordUpload(int64_t bytes, double upload_ms) {
+  base::AutoLock lock_scope(lock_);
+  pending_.values[UPLOAD_BYTES] += static_cast<double>(bytes);
+  pending_.values[UPLOAD_MS] += upload_ms;
+}
+
+void FrameMetrics::RecordDamageFilter(int64_t saved_bytes, double filter_ms) {
+  base::AutoLock lock_scope(lock_);
+  pending_.values[DAMAGE_SAVED_BYTES] += static_cast<double>(saved_bytes);
+  pending_.values[DAMAGE_FILTER_MS] += filter_ms;
+}
+
+void FrameMetrics::RecordDeadline(double budget_used_percent, bool missed) {
+  base::AutoLock lock_scope(lock_);
+  pending_.values[BUDGET_USED_PCT] = budget_used_percent;
+  pending_.values[DEADLINE_MISSED] = missed ? 1 : 0;
+}
+
+void FrameMetrics::AddTime(Metric metric, double ms) {
+  base::AutoLock lock_scope(lock_);
+  pending_.values[metric] += ms;
+}
+
+void FrameMetrics::EndFrame() {
+  const int64_t now = NowUs();
+  base::AutoLock lock_scope(lock_);
+  const int64_t start_us = idle_ ? frame_start_us_ : last_present_us_;
+  if (start_us != 0)
+    pending_.values[FRAME_MS] = (now - start_us) / 1000.0;
+  last_present_us_ = now;
+  idle_ = false;
+
+  frames_[frame_count_ % kCapacity] = pending_;
+  frame_count_++;
+  for (int i = 0; i < METRIC_COUNT; ++i)
+    totals_.values[i] += pending_.values[i];
+  memset(&pending_, 0, sizeof(pending_));
+}
+
+void FrameMetrics::OnFrameSkipped() {
+  const int64_t now = NowUs();
+  base::AutoLock lock_scope(lock_);
+  idle_ = true;
+  // Damage without a paint, e.g. a resize, is timed from the last skipped
+  // frame.
+  if (pending_.values[PAINT_COUNT] == 0)
+    frame_start_us_ = now;
+}
+
+double FrameMetrics::Percentile(Metric metric, double p) {
+  return Percentile(metric, p, 0);
+}
+
+double FrameMetrics::Percentile(Metric metric, double p, int64_t since_frame) {
+  base::AutoLock lock_scope(lock_);
+  const int64_t first =
+      std::max(since_frame, frame_count_ - static_cast<int64_t>(kCapacity));
+  if (first >= frame_count_)
+    return 0;
+  const size_t count = static_cast<size_t>(frame_count_ - first);
+
+  scratch_.resize(count);
+  for (size_t i = 0; i < count; ++i)
+    scratch_[i] = frames_[(first + i) % kCapacity].values[metric];
+
+  const size_t rank = std::min(
+      count - 1, static_cast<size_t>(p / 100.0 * (count - 1) + 0.5));
+  std::nth_element(scratch_.begin(), scratch_.begin() + rank, scratch_.end());
+  return scratch_[rank];
+}
+
+double FrameMetrics::Total(Metric metric) {
+  base::AutoLock lock_scope(lock_);
+  return totals_.values[metric];
+}
+
+int64_t FrameMetrics::frame_count() {
+  base::AutoLock lock_scope(lock_);
+  return frame_count_;
+}
+
+std::string FrameMetrics::Summary() {
+  static const Metric kSummaryMetrics[] = {FRAME_MS, UPLOAD_MS, RENDER_MS,
+                                           SWAP_MS, MESSAGE_LOOP_MS};
+  std::string summary;
+  char buffer[96];
+  for (size_t i = 0; i < arraysize(kSummaryMetrics); ++i) {
+    const Metric metric = kSummaryMetrics[i];
+    snprintf(buffer, sizeof(buffer), "%s%s %.1f/%.1f/%.1f", i ? "  " : "",
+             MetricName(metric), Percentile(metric, 50), Percentile(metric, 95),
+             Percentile(metric, 99));
+    summary += buffer;
+  }
+  return summary;
+}
+
+void FrameMetrics::GetRecentFrameTimes(size_t count, std::vector<float>* out) {
+  base::AutoLock lock_scope(lock_);
+  count = std::min(count,
+                   static_cast<size_t>(std::min<int64_t>(frame_count_,
+                                                         kCapacity)));
+  out->resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    const int64_t index = frame_count_ - count + i;
+    (*out)[i] = static_cast<float>(frames_[index % kCapacity].values[FRAME_MS]);
+  }
+}
+
+bool FrameMetrics::Dump(const std::string& path) {
+  const bool json = EndsWith(path, ".json");
+
+  std::ostringstream out;
+  {
+    base::AutoLock lock_scope(lock_);
+    const int64_t count = std::min<int64_t>(frame_count_, kCapacity);
+    const int64_t first = frame_count_ - count;
+
+    if (json) {
+      out << "{\"frames\":[";
+    } else {
+      out << "frame";
+      for (int m = 0; m < METRIC_COUNT; ++m)
+        out << "," << kMetricNames[m];
+      out << "\n";
+    }
+
+    for (int64_t i = first; i < frame_count_; ++i) {
+      const Frame& frame = frames_[i % kCapacity];
+      if (json) {
+        out << (i == first ? "" : ",") << "\n{\"frame\":" << i;
+        for (int m = 0; m < METRIC_COUNT; ++m)
+          out << ",\"" << kMetricNames[m] << "\":" << frame.values[m];
+        out << "}";
+      } else {
+        out << i;
+        for (int m = 0; m < METRIC_COUNT; ++m)
+          out << "," << frame.values[m];
+        out << "\n";
+      }
+    }
+  }
+
+  if (json) {
+    // Percentiles are computed outside the lock above since they take it.
+    out << "\n],\"percentiles\":{";
+    for (int m = 0; m < METRIC_COUNT; ++m) {
+      const Metric metric = static_cast<Metric>(m);
+      out << (m ? "," : "") << "\n\"" << kMetricNames[m]
+          << "\":{\"p50\":" << Percentile(metric, 50)
+          << ",\"p95\":" << Percentile(metric, 95)
+          << ",\"p99\":" << Percentile(metric, 99)
+          << ",\"max\":" << Percentile(metric, 100) << "}";
+    }
+    out << "\n}}\n";
+  }
+
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+  const std::string data = out.str();
+  const bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+  return fclose(file) == 0 && ok;
+}
+
+// static
+const char* FrameMetrics::MetricName(Metric metric) {
+  return kMetricNames[metric];
+}
+
+// static
+int64_t FrameMetrics::NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
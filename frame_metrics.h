@@ -0,0 +1,123 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_FRAME_METRICS_H_
+#define CEF_TESTS_CEFSIMPLE_FRAME_METRICS_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "include/base/cef_lock.h"
+#include "include/base/cef_macros.h"
+
+// Records per-frame timings into a fixed-size ring buffer. Paint, upload and
+// message loop work is accumulated into the pending frame, which is committed
+// by EndFrame() when it is presented. Methods may be called from any thread.
+class FrameMetrics {
+ public:
+  static const size_t kCapacity = 1024;
+
+  // Per-frame values, in the column order of the CSV dump.
+  enum Metric {
+    FRAME_MS,         // Time since the previous presented frame, or since
+                      // the first OnPaint if the loop was idle in between.
+    PAINT_COUNT,      // OnPaint calls.
+    PAINT_ARRIVAL_MS, // Time from the previous present to the first OnPaint,
+                      // 0 after an idle gap.
+    DIRTY_RECTS,      // Dirty rectangles over all OnPaint calls.
+    DIRTY_AREA,       // Sum of the dirty rectangle areas, in pixels.
+    DAMAGE_SAVED_BYTES,  // Damage dropped by the tile damage filter.
+    DAMAGE_FILTER_MS,
+    UPLOAD_BYTES,     // Bytes passed to the texture uploads.
+    UPLOAD_MS,
+    RENDER_MS,
+    SWAP_MS,
+    MESSAGE_LOOP_MS,  // CefDoMessageLoopWork.
+    BUDGET_USED_PCT,  // Message loop time as a percentage of the work budget.
+    DEADLINE_MISSED,  // 1 if the frame missed its present deadline.
+    METRIC_COUNT
+  };
+
+  // Adds the lifetime of the object to |metric| of the pending frame.
+  class ScopedTimer {
+   public:
+    ScopedTimer(FrameMetrics* metrics, Metric metric);
+    ~ScopedTimer();
+
+   private:
+    FrameMetrics* metrics_;
+    const Metric metric_;
+    const std::chrono::steady_clock::time_point start_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedTimer);
+  };
+
+  FrameMetrics();
+
+  void RecordPaint(int dirty_rects, int64_t dirty_area);
+  void RecordUpload(int64_t bytes, double upload_ms);
+  void RecordDamageFilter(int64_t saved_bytes, double filter_ms);
+  void RecordDeadline(double budget_used_percent, bool missed);
+  void AddTime(Metric metric, double ms);
+
+  // Commit the pending frame to the ring buffer.
+  void EndFrame();
+
+  // The render loop went idle instead of presenting. The next frame is timed
+  // from its first paint, so that idle time is not counted as frame time.
+  void OnFrameSkipped();
+
+  // Percentile |p| (0-100) of |metric| over the buffered frames.
+  double Percentile(Metric metric, double p);
+
+  // Same, over the buffered frames committed since frame_count() was
+  // |since_frame|.
+  double Percentile(Metric metric, double p, int64_t since_frame);
+
+  // Sum of |metric| over every frame committed since startup.
+  double Total(Metric metric);
+
+  int64_t frame_count();
+
+  // One-line p50/p95/p99 summary of the main timings.
+  std::string Summary();
+
+  // Copy the last |count| frame times in milliseconds into |out|, oldest
+  // first.
+  void GetRecentFrameTimes(size_t count, std::vector<float>* out);
+
+  // Write the buffered frames to |path| as JSON if it ends in ".json", and as
+  // CSV otherwise. Returns false on failure.
+  bool Dump(const std::string& path);
+
+  static const char* MetricName(Metric metric);
+
+ private:
+  struct Frame {
+    double values[METRIC_COUNT];
+  };
+
+  static int64_t NowUs();
+
+  base::Lock lock_;
+  Frame frames_[kCapacity];
+  // Number of frames committed since startup.
+  int64_t frame_count_;
+  Frame pending_;
+  Frame totals_;
+  int64_t last_present_us_;
+  // Set by OnFrameSkipped() until the next EndFrame().
+  bool idle_;
+  // Start of the pending frame after an idle gap.
+  int64_t frame_start_us_;
+  std::vector<double> scratch_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameMetrics);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_FRAME_METRICS_H_
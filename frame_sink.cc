@@ -0,0 +1,36 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "frame_sink.h"
+
+#include "include/base/cef_logging.h"
+
+WriterFrameSink::WriterFrameSink(const std::string& path,
+                                 FrameWriter::Format format,
+                                 int frame_rate)
+    : path_(path), format_(format), frame_rate_(frame_rate) {}
+
+void WriterFrameSink::ConsumeFrame(const Frame& frame) {
+  std::unique_ptr<FrameWriter>& writer = writers_[frame.browser_id];
+  if (!writer) {
+    std::string path = path_;
+    const size_t pos = path.find("%d");
+    if (pos != std::string::npos)
+      path.replace(pos, 2, std::to_string(frame.browser_id));
+
+    // A writer that failed to open stays closed and ignores its frames.
+    writer.reset(new FrameWriter());
+    writer->Open(path, format_, frame_rate_);
+  }
+
+  if (writer->IsOpen() &&
+      !writer->WriteFrame(&frame.pixels[0], frame.width, frame.height)) {
+    LOG(WARNING) << "Dropped frame of browser " << frame.browser_id;
+  }
+}
+
+void WriterFrameSink::Flush() {
+  for (WriterMap::iterator it = writers_.begin(); it != writers_.end(); ++it)
+    it->second->Close();
+}
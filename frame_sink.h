@@ -0,0 +1,74 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_FRAME_SINK_H_
+#define CEF_TESTS_CEFSIMPLE_FRAME_SINK_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/internal/cef_types_wrappers.h"
+#include "frame_writer.h"
+
+// A consumer of OnPaint output, such as an encoder or a recorder. Sinks are
+// registered with a FrameSinkPipeline and run on their own worker thread.
+class FrameSink {
+ public:
+  struct Frame {
+    Frame() : browser_id(0), width(0), height(0), paint_time_us(0) {}
+
+    int browser_id;
+    // BGRA pixels with a stride of |width| * 4.
+    std::vector<uint8_t> pixels;
+    int width;
+    int height;
+    // Damage reported by OnPaint for this frame.
+    std::vector<CefRect> damage;
+    // Steady clock time of the OnPaint call in microseconds.
+    int64_t paint_time_us;
+  };
+
+  virtual ~FrameSink() {}
+
+  virtual const char* GetName() const = 0;
+
+  // Called on the worker thread for every frame that was not dropped. The
+  // frame is only valid for the duration of the call.
+  virtual void ConsumeFrame(const Frame& frame) = 0;
+
+  // Called on the worker thread after the last frame.
+  virtual void Flush() {}
+};
+
+// Writes the frames of each browser with a FrameWriter. "%d" in the path is
+// replaced by the browser identifier.
+class WriterFrameSink : public FrameSink {
+ public:
+  WriterFrameSink(const std::string& path,
+                  FrameWriter::Format format,
+                  int frame_rate);
+
+  // FrameSink methods:
+  const char* GetName() const OVERRIDE { return "writer"; }
+  void ConsumeFrame(const Frame& frame) OVERRIDE;
+  void Flush() OVERRIDE;
+
+ private:
+  const std::string path_;
+  const FrameWriter::Format format_;
+  const int frame_rate_;
+
+  typedef std::map<int, std::unique_ptr<FrameWriter>> WriterMap;
+  WriterMap writers_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriterFrameSink);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_FRAME_SINK_H_
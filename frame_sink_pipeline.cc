@@ -0,0 +1,258 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "frame_sink_pipeline.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+// Damage rectangles reserved per buffer up front.
+const size_t kReservedDamageRects = 16;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+FrameSinkPipeline::FrameSinkPipeline() : running_(false) {}
+
+FrameSinkPipeline::~FrameSinkPipeline() {
+  Stop();
+}
+
+// static
+bool FrameSinkPipeline::ParsePolicy(const std::string& name, Policy* policy) {
+  if (name == "drop-oldest") {
+    *policy = POLICY_DROP_OLDEST;
+    return true;
+  }
+  if (name == "drop-newest") {
+    *policy = POLICY_DROP_NEWEST;
+    return true;
+  }
+  if (name == "block") {
+    *policy = POLICY_BLOCK;
+    return true;
+  }
+  return false;
+}
+
+void FrameSinkPipeline::AddSink(std::unique_ptr<FrameSink> sink,
+                                Policy policy,
+                                size_t queue_size) {
+  DCHECK(!running_);
+  std::unique_ptr<Stage> stage(new Stage());
+  stage->sink = std::move(sink);
+  stage->policy = policy;
+  stage->queue.resize(std::max<size_t>(queue_size, 1));
+  stage->head = 0;
+  stage->count = 0;
+  stage->stopping = false;
+  stage->submitted = 0;
+  stage->consumed = 0;
+  stage->dropped = 0;
+  stage->max_queue_depth = 0;
+  stage->total_latency_ms = 0;
+  stage->max_latency_ms = 0;
+  stages_.push_back(std::move(stage));
+}
+
+void FrameSinkPipeline::Start() {
+  if (running_ || stages_.empty())
+    return;
+
+  // Every sink can hold a full queue plus the frame it is consuming, all
+  // different, while Submit() fills one more.
+  size_t buffer_count = 1;
+  for (size_t i = 0; i < stages_.size(); ++i)
+    buffer_count += stages_[i]->queue.size() + 1;
+
+  buffers_.clear();
+  free_buffers_.clear();
+  for (size_t i = 0; i < buffer_count; ++i) {
+    buffers_.push_back(std::unique_ptr<Buffer>(new Buffer()));
+    buffers_.back()->frame.damage.reserve(kReservedDamageRects);
+    free_buffers_.push_back(buffers_.back().get());
+  }
+
+  running_ = true;
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    Stage* stage = stages_[i].get();
+    stage->stopping = false;
+    stage->thread = std::thread(&FrameSinkPipeline::Run, this, stage);
+  }
+}
+
+void FrameSinkPipeline::Stop() {
+  if (!running_)
+    return;
+
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    Stage* stage = stages_[i].get();
+    {
+      std::lock_guard<std::mutex> lock(stage->mutex);
+      stage->stopping = true;
+    }
+    stage->not_empty.notify_one();
+  }
+  for (size_t i = 0; i < stages_.size(); ++i)
+    stages_[i]->thread.join();
+
+  running_ = false;
+}
+
+void FrameSinkPipeline::Submit(int browser_id,
+                               const std::vector<CefRect>& dirtyRects,
+                               const void* buffer,
+                               int width,
+                               int height) {
+  if (!running_ || width <= 0 || height <= 0)
+    return;
+
+  Buffer* target = AcquireBuffer();
+  if (!target) {
+    // Only possible if a sink holds on to more buffers than it queued.
+    NOTREACHED();
+    return;
+  }
+
+  FrameSink::Frame& frame = target->frame;
+  frame.browser_id = browser_id;
+  frame.width = width;
+  frame.height = height;
+  frame.paint_time_us = NowUs();
+  // Same-size frames reuse the existing storage.
+  frame.pixels.resize(static_cast<size_t>(width) * height * 4);
+  memcpy(&frame.pixels[0], buffer, frame.pixels.size());
+  frame.damage.assign(dirtyRects.begin(), dirtyRects.end());
+
+  // Hold a reference while queueing so that the buffer can't be released
+  // by a fast sink before every stage has seen it.
+  target->refs = 1;
+  for (size_t i = 0; i < stages_.size(); ++i)
+    Enqueue(stages_[i].get(), target);
+  ReleaseBuffer(target);
+}
+
+void FrameSinkPipeline::Enqueue(Stage* stage, Buffer* buffer) {
+  Buffer* dropped = NULL;
+  {
+    std::unique_lock<std::mutex> lock(stage->mutex);
+    stage->submitted++;
+    const size_t capacity = stage->queue.size();
+
+    if (stage->count == capacity) {
+      switch (stage->policy) {
+        case POLICY_DROP_NEWEST:
+          stage->dropped++;
+          return;
+        case POLICY_DROP_OLDEST:
+          dropped = stage->queue[stage->head];
+          stage->head = (stage->head + 1) % capacity;
+          stage->count--;
+          stage->dropped++;
+          break;
+        case POLICY_BLOCK:
+          stage->not_full.wait(lock,
+                               [stage, capacity] {
+                                 return stage->count < capacity;
+                               });
+          break;
+      }
+    }
+
+    buffer->refs++;
+    stage->queue[(stage->head + stage->count) % capacity] = buffer;
+    stage->count++;
+    stage->max_queue_depth = std::max(stage->max_queue_depth, stage->count);
+  }
+  stage->not_empty.notify_one();
+
+  if (dropped)
+    ReleaseBuffer(dropped);
+}
+
+void FrameSinkPipeline::Run(Stage* stage) {
+  while (true) {
+    Buffer* buffer = NULL;
+    {
+      std::unique_lock<std::mutex> lock(stage->mutex);
+      stage->not_empty.wait(
+          lock, [stage] { return stage->count > 0 || stage->stopping; });
+      if (stage->count == 0)
+        break;
+      buffer = stage->queue[stage->head];
+      stage->head = (stage->head + 1) % stage->queue.size();
+      stage->count--;
+    }
+    stage->not_full.notify_one();
+
+    stage->sink->ConsumeFrame(buffer->frame);
+
+    const double latency_ms = (NowUs() - buffer->frame.paint_time_us) / 1000.0;
+    ReleaseBuffer(buffer);
+
+    std::lock_guard<std::mutex> lock(stage->mutex);
+    stage->consumed++;
+    stage->total_latency_ms += latency_ms;
+    stage->max_latency_ms = std::max(stage->max_latency_ms, latency_ms);
+  }
+
+  stage->sink->Flush();
+}
+
+FrameSinkPipeline::Buffer* FrameSinkPipeline::AcquireBuffer() {
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  if (free_buffers_.empty())
+    return NULL;
+  Buffer* buffer = free_buffers_.back();
+  free_buffers_.pop_back();
+  return buffer;
+}
+
+void FrameSinkPipeline::ReleaseBuffer(Buffer* buffer) {
+  if (--buffer->refs > 0)
+    return;
+  std::lock_guard<std::mutex> lock(pool_mutex_);
+  free_buffers_.push_back(buffer);
+}
+
+void FrameSinkPipeline::GetStats(std::vector<SinkStats>* stats) {
+  stats->resize(stages_.size());
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    Stage* stage = stages_[i].get();
+    SinkStats& out = (*stats)[i];
+    std::lock_guard<std::mutex> lock(stage->mutex);
+    out.name = stage->sink->GetName();
+    out.submitted = stage->submitted;
+    out.consumed = stage->consumed;
+    out.dropped = stage->dropped;
+    out.max_queue_depth = stage->max_queue_depth;
+    out.avg_latency_ms =
+        stage->consumed ? stage->total_latency_ms / stage->consumed : 0;
+    out.max_latency_ms = stage->max_latency_ms;
+  }
+}
+
+void FrameSinkPipeline::LogStats() {
+  std::vector<SinkStats> stats;
+  GetStats(&stats);
+  for (size_t i = 0; i < stats.size(); ++i) {
+    LOG(INFO) << "Frame sink " << stats[i].name << ": " << stats[i].submitted
+              << " submitted, " << stats[i].consumed << " consumed, "
+              << stats[i].dropped << " dropped, max queue depth "
+              << stats[i].max_queue_depth << ", latency avg "
+              << stats[i].avg_latency_ms << " ms, max "
+              << stats[i].max_latency_ms << " ms";
+  }
+}
@@ -0,0 +1,140 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_FRAME_SINK_PIPELINE_H_
+#define CEF_TESTS_CEFSIMPLE_FRAME_SINK_PIPELINE_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "frame_sink.h"
+
+// Hands OnPaint frames to FrameSinks running on worker threads. Submit()
+// copies the frame into a buffer from a preallocated pool and queues it to
+// every sink. Buffers are shared between sinks and return to the pool once
+// the last sink is done with them, so no memory is allocated once the pool
+// buffers have grown to the frame size. Each sink has a bounded queue with
+// its own policy for when the queue is full.
+//
+// AddSink() and Start() must be called before the first Submit(). Submit()
+// and Stop() must be called on the same thread.
+class FrameSinkPipeline {
+ public:
+  enum Policy {
+    // Discard the oldest queued frame to make room.
+    POLICY_DROP_OLDEST,
+    // Discard the submitted frame.
+    POLICY_DROP_NEWEST,
+    // Wait in Submit() until the sink has room.
+    POLICY_BLOCK,
+  };
+
+  struct SinkStats {
+    std::string name;
+    int64_t submitted;
+    int64_t consumed;
+    int64_t dropped;
+    size_t max_queue_depth;
+    double avg_latency_ms;
+    double max_latency_ms;
+  };
+
+  static const size_t kDefaultQueueSize = 4;
+
+  FrameSinkPipeline();
+  ~FrameSinkPipeline();
+
+  // Parse "drop-oldest", "drop-newest" or "block".
+  static bool ParsePolicy(const std::string& name, Policy* policy);
+
+  void AddSink(std::unique_ptr<FrameSink> sink,
+               Policy policy,
+               size_t queue_size);
+  bool HasSinks() const { return !stages_.empty(); }
+
+  // Allocate the buffer pool and start one worker thread per sink.
+  void Start();
+
+  // Let every sink consume its queued frames, call Flush() and join the
+  // workers.
+  void Stop();
+
+  bool IsRunning() const { return running_; }
+
+  void Submit(int browser_id,
+              const std::vector<CefRect>& dirtyRects,
+              const void* buffer,
+              int width,
+              int height);
+
+  void GetStats(std::vector<SinkStats>* stats);
+
+  // Log the counters of every sink.
+  void LogStats();
+
+ private:
+  struct Buffer {
+    Buffer() : refs(0) {}
+
+    FrameSink::Frame frame;
+    std::atomic<int> refs;
+  };
+
+  struct Stage {
+    Stage() {}
+
+    std::unique_ptr<FrameSink> sink;
+    Policy policy;
+    std::thread thread;
+
+    // Fixed-size ring of queued buffers. Guarded by |mutex|.
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::vector<Buffer*> queue;
+    size_t head;
+    size_t count;
+    bool stopping;
+
+    // Counters. Guarded by |mutex|.
+    int64_t submitted;
+    int64_t consumed;
+    int64_t dropped;
+    size_t max_queue_depth;
+    double total_latency_ms;
+    double max_latency_ms;
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(Stage);
+  };
+
+  void Run(Stage* stage);
+
+  // Queue |buffer| to |stage| according to its policy.
+  void Enqueue(Stage* stage, Buffer* buffer);
+
+  Buffer* AcquireBuffer();
+  void ReleaseBuffer(Buffer* buffer);
+
+  std::vector<std::unique_ptr<Stage>> stages_;
+  bool running_;
+
+  // Buffers not referenced by any sink. Guarded by |pool_mutex_|.
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  std::mutex pool_mutex_;
+  std::vector<Buffer*> free_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameSinkPipeline);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_FRAME_SINK_PIPELINE_H_
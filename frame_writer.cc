@@ -0,0 +1,116 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "frame_writer.h"
+
+#include "include/base/cef_logging.h"
+#include "pixel_convert.h"
+
+FrameWriter::FrameWriter()
+    : file_(NULL),
+      owns_file_(false),
+      format_(FORMAT_BGRA),
+      frame_rate_(30),
+      width_(0),
+      height_(0),
+      frames_written_(0),
+      frames_dropped_(0) {}
+
+FrameWriter::~FrameWriter() {
+  Close();
+}
+
+// static
+bool FrameWriter::ParseFormat(const std::string& name, Format* format) {
+  if (name == "bgra") {
+    *format = FORMAT_BGRA;
+    return true;
+  }
+  if (name == "y4m") {
+    *format = FORMAT_Y4M;
+    return true;
+  }
+  return false;
+}
+
+bool FrameWriter::Open(const std::string& path, Format format, int frame_rate) {
+  DCHECK(!file_);
+  if (path == "-") {
+    file_ = stdout;
+    owns_file_ = false;
+  } else {
+    file_ = fopen(path.c_str(), "wb");
+    owns_file_ = true;
+    if (!file_) {
+      LOG(ERROR) << "Failed to open " << path;
+      return false;
+    }
+  }
+
+  format_ = format;
+  frame_rate_ = frame_rate > 0 ? frame_rate : 30;
+  width_ = 0;
+  height_ = 0;
+  return true;
+}
+
+void FrameWriter::Close() {
+  if (!file_)
+    return;
+  if (owns_file_)
+    fclose(file_);
+  else
+    fflush(file_);
+  file_ = NULL;
+}
+
+bool FrameWriter::WriteFrame(const void* buffer, int width, int height) {
+  if (!file_ || width <= 0 || height <= 0)
+    return false;
+
+  const uint8_t* bgra = static_cast<const uint8_t*>(buffer);
+  bool ok;
+  if (format_ == FORMAT_Y4M) {
+    ok = WriteY4mFrame(bgra, width, height);
+  } else {
+    const size_t size = static_cast<size_t>(width) * height * 4;
+    ok = fwrite(bgra, 1, size, file_) == size;
+  }
+
+  if (!ok) {
+    frames_dropped_++;
+    return false;
+  }
+  frames_written_++;
+  return true;
+}
+
+bool FrameWriter::WriteY4mFrame(const uint8_t* bgra, int width, int height) {
+  if (width_ == 0) {
+    width_ = width;
+    height_ = height;
+    if (fprintf(file_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width,
+                height, frame_rate_) < 0) {
+      return false;
+    }
+  } else if (width != width_ || height != height_) {
+    return false;
+  }
+
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  const size_t y_size = static_cast<size_t>(width) * height;
+  const size_t chroma_size = static_cast<size_t>(chroma_width) * chroma_height;
+  yuv_.resize(y_size + 2 * chroma_size);
+  uint8_t* y_plane = &yuv_[0];
+  uint8_t* u_plane = y_plane + y_size;
+  uint8_t* v_plane = u_plane + chroma_size;
+
+  pixel_convert::BgraToI420(bgra, width * 4, y_plane, width, u_plane,
+                            chroma_width, v_plane, chroma_width, width, height,
+                            CefRect(0, 0, width, height));
+
+  return fputs("FRAME\n", file_) >= 0 &&
+         fwrite(&yuv_[0], 1, yuv_.size(), file_) == yuv_.size();
+}
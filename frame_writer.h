@@ -0,0 +1,65 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_FRAME_WRITER_H_
+#define CEF_TESTS_CEFSIMPLE_FRAME_WRITER_H_
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+
+// Writes OnPaint frames to a file or to stdout, either as raw BGRA with no
+// header or as a YUV4MPEG2 (Y4M) stream with 4:2:0 chroma. Y4M streams have a
+// fixed size, so frames that do not match the first frame are dropped.
+class FrameWriter {
+ public:
+  enum Format {
+    FORMAT_BGRA,
+    FORMAT_Y4M,
+  };
+
+  FrameWriter();
+  ~FrameWriter();
+
+  // Parse "bgra" or "y4m". Returns false for anything else.
+  static bool ParseFormat(const std::string& name, Format* format);
+
+  // Open |path| for writing, or stdout if |path| is "-". |frame_rate| is
+  // written to the Y4M header.
+  bool Open(const std::string& path, Format format, int frame_rate);
+  void Close();
+
+  bool IsOpen() const { return file_ != NULL; }
+
+  // Write a |width| x |height| BGRA |buffer| with a stride of |width| * 4.
+  // Returns false if the frame was dropped or the write failed.
+  bool WriteFrame(const void* buffer, int width, int height);
+
+  int64_t frames_written() const { return frames_written_; }
+  int64_t frames_dropped() const { return frames_dropped_; }
+
+ private:
+  bool WriteY4mFrame(const uint8_t* bgra, int width, int height);
+
+  FILE* file_;
+  bool owns_file_;
+  Format format_;
+  int frame_rate_;
+  int width_;
+  int height_;
+  int64_t frames_written_;
+  int64_t frames_dropped_;
+
+  // I420 planes of the frame being written.
+  std::vector<uint8_t> yuv_;
+
+  DISALLOW_COPY_AND_ASSIGN(FrameWriter);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_FRAME_WRITER_H_
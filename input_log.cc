@@ -0,0 +1,300 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "input_log.h"
+
+#include <string.h>
+
+#include <chrono>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+const char kMagic[4] = {'C', 'E', 'F', 'I'};
+const uint8_t kVersion = 1;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Sequential reader over a loaded log. Reads past the end fail.
+class LogReader {
+ public:
+  explicit LogReader(const std::vector<uint8_t>& data) : data_(data), pos_(0) {}
+
+  bool at_end() const { return pos_ >= data_.size(); }
+
+  bool GetByte(uint8_t* value) {
+    if (at_end())
+      return false;
+    *value = data_[pos_++];
+    return true;
+  }
+
+  bool GetVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!GetByte(&byte))
+        return false;
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool GetSigned(int* value) {
+    uint64_t raw;
+    if (!GetVarint(&raw))
+      return false;
+    *value = static_cast<int>((raw >> 1) ^ (~(raw & 1) + 1));
+    return true;
+  }
+
+  bool GetFloat(double* value) {
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i) {
+      uint8_t byte;
+      if (!GetByte(&byte))
+        return false;
+      bits |= static_cast<uint32_t>(byte) << (8 * i);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    *value = f;
+    return true;
+  }
+
+ private:
+  const std::vector<uint8_t>& data_;
+  size_t pos_;
+};
+
+}  // namespace
+
+InputRecorder::InputRecorder()
+    : file_(NULL), start_us_(0), last_us_(0), records_(0), bytes_(0) {}
+
+InputRecorder::~InputRecorder() {
+  Close();
+}
+
+bool InputRecorder::Open(const std::string& path, int width, int height) {
+  DCHECK(!file_);
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_)
+    return false;
+
+  fwrite(kMagic, 1, sizeof(kMagic), file_);
+  fwrite(&kVersion, 1, 1, file_);
+  bytes_ = sizeof(kMagic) + 1;
+
+  start_us_ = last_us_ = NowUs();
+  RecordFramebufferSize(width, height);
+  return true;
+}
+
+void InputRecorder::RecordKey(int key, int scancode, int action, int mods) {
+  BeginRecord(InputLogEvent::KEY);
+  PutSigned(key);
+  PutSigned(scancode);
+  PutSigned(action);
+  PutSigned(mods);
+  EndRecord();
+}
+
+void InputRecorder::RecordMouseButton(int button, int action, int mods) {
+  BeginRecord(InputLogEvent::MOUSE_BUTTON);
+  PutSigned(button);
+  PutSigned(action);
+  PutSigned(mods);
+  EndRecord();
+}
+
+void InputRecorder::RecordScroll(double x, double y) {
+  BeginRecord(InputLogEvent::SCROLL);
+  PutFloat(x);
+  PutFloat(y);
+  EndRecord();
+}
+
+void InputRecorder::RecordCursorPos(double x, double y) {
+  BeginRecord(InputLogEvent::CURSOR_POS);
+  PutFloat(x);
+  PutFloat(y);
+  EndRecord();
+}
+
+void InputRecorder::RecordFramebufferSize(int width, int height) {
+  BeginRecord(InputLogEvent::FRAMEBUFFER_SIZE);
+  PutSigned(width);
+  PutSigned(height);
+  EndRecord();
+}
+
+void InputRecorder::Close() {
+  if (!file_)
+    return;
+  BeginRecord(InputLogEvent::END);
+  EndRecord();
+  fclose(file_);
+  file_ = NULL;
+}
+
+void InputRecorder::BeginRecord(InputLogEvent::Type type) {
+  const int64_t now = NowUs();
+  record_.clear();
+  record_.push_back(static_cast<uint8_t>(type));
+  PutVarint(static_cast<uint64_t>(now - last_us_));
+  last_us_ = now;
+}
+
+void InputRecorder::PutVarint(uint64_t value) {
+  while (value >= 0x80) {
+    record_.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  record_.push_back(static_cast<uint8_t>(value));
+}
+
+void InputRecorder::PutSigned(int value) {
+  const int64_t wide = value;
+  PutVarint(static_cast<uint64_t>((wide << 1) ^ (wide >> 63)));
+}
+
+void InputRecorder::PutFloat(double value) {
+  const float f = static_cast<float>(value);
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  for (int i = 0; i < 4; ++i)
+    record_.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+}
+
+void InputRecorder::EndRecord() {
+  if (!file_)
+    return;
+  fwrite(&record_[0], 1, record_.size(), file_);
+  records_++;
+  bytes_ += record_.size();
+}
+
+InputReplayer::InputReplayer() : next_(0), start_us_(0), speed_(1.0) {}
+
+bool InputReplayer::Load(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    data.insert(data.end(), chunk, chunk + read);
+  fclose(file);
+
+  if (data.size() < sizeof(kMagic) + 1 ||
+      memcmp(&data[0], kMagic, sizeof(kMagic)) != 0 ||
+      data[sizeof(kMagic)] != kVersion) {
+    LOG(ERROR) << path << " is not an input log";
+    return false;
+  }
+
+  events_.clear();
+  next_ = 0;
+  LogReader reader(data);
+  uint8_t header;
+  for (size_t i = 0; i < sizeof(kMagic) + 1; ++i)
+    reader.GetByte(&header);
+
+  int64_t time_us = 0;
+  while (!reader.at_end()) {
+    InputLogEvent event;
+    uint8_t type;
+    uint64_t delta_us;
+    bool ok = reader.GetByte(&type) && reader.GetVarint(&delta_us);
+    if (ok) {
+      time_us += static_cast<int64_t>(delta_us);
+      event.time_us = time_us;
+      switch (type) {
+        case InputLogEvent::KEY:
+          ok = reader.GetSigned(&event.args[0]) &&
+               reader.GetSigned(&event.args[1]) &&
+               reader.GetSigned(&event.args[2]) &&
+               reader.GetSigned(&event.args[3]);
+          break;
+        case InputLogEvent::MOUSE_BUTTON:
+          ok = reader.GetSigned(&event.args[0]) &&
+               reader.GetSigned(&event.args[1]) &&
+               reader.GetSigned(&event.args[2]);
+          break;
+        case InputLogEvent::SCROLL:
+        case InputLogEvent::CURSOR_POS:
+          ok = reader.GetFloat(&event.x) && reader.GetFloat(&event.y);
+          break;
+        case InputLogEvent::FRAMEBUFFER_SIZE:
+          ok = reader.GetSigned(&event.args[0]) &&
+               reader.GetSigned(&event.args[1]);
+          break;
+        case InputLogEvent::END:
+          break;
+        default:
+          ok = false;
+          break;
+      }
+      event.type = static_cast<InputLogEvent::Type>(type);
+    }
+    if (!ok) {
+      // Keep what was read; the recording may have been cut short.
+      LOG(WARNING) << path << " is truncated or corrupt after "
+                   << events_.size() << " events";
+      break;
+    }
+    events_.push_back(event);
+    if (event.type == InputLogEvent::END)
+      break;
+  }
+
+  if (events_.empty())
+    return false;
+
+  // A session cut short by a crash has no END record; end it after its last
+  // event.
+  if (events_.back().type != InputLogEvent::END) {
+    InputLogEvent end;
+    end.time_us = events_.back().time_us;
+    events_.push_back(end);
+  }
+  return true;
+}
+
+void InputReplayer::Start(double speed) {
+  DCHECK_GT(speed, 0);
+  speed_ = speed;
+  start_us_ = NowUs();
+  next_ = 0;
+}
+
+void InputReplayer::TakeDueEvents(std::vector<InputLogEvent>* events) {
+  DCHECK(events);
+  events->clear();
+  if (start_us_ == 0)
+    return;
+  const int64_t now = NowUs();
+  while (next_ < events_.size() && ReplayTimeUs(events_[next_]) <= now)
+    events->push_back(events_[next_++]);
+}
+
+int64_t InputReplayer::TimeUntilNextEventUs() const {
+  if (start_us_ == 0 || finished())
+    return -1;
+  const int64_t delay_us = ReplayTimeUs(events_[next_]) - NowUs();
+  return delay_us > 0 ? delay_us : 0;
+}
+
+int64_t InputReplayer::ReplayTimeUs(const InputLogEvent& event) const {
+  return start_us_ + static_cast<int64_t>(event.time_us / speed_);
+}
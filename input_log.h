@@ -0,0 +1,126 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_INPUT_LOG_H_
+#define CEF_TESTS_CEFSIMPLE_INPUT_LOG_H_
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+
+// Timestamped log of the window input callbacks, used to replay the same
+// session against different builds.
+//
+// The file starts with the magic "CEFI" and a version byte. Each record is a
+// type byte, the microseconds since the previous record as a varint and the
+// callback arguments: varints (zigzag encoded where they may be negative) for
+// integers and little-endian floats for positions and wheel deltas. A session
+// starts with the framebuffer size and ends with an END record.
+struct InputLogEvent {
+  enum Type {
+    KEY = 1,               // args: key, scancode, action, mods
+    MOUSE_BUTTON = 2,      // args: button, action, mods
+    SCROLL = 3,            // x, y: wheel offsets
+    CURSOR_POS = 4,        // x, y: cursor position
+    FRAMEBUFFER_SIZE = 5,  // args: width, height
+    END = 6,
+  };
+
+  InputLogEvent() : type(END), time_us(0), x(0), y(0) {
+    for (int i = 0; i < 4; ++i)
+      args[i] = 0;
+  }
+
+  Type type;
+  // Microseconds since the start of the session.
+  int64_t time_us;
+  int args[4];
+  double x;
+  double y;
+};
+
+// Writes a session. All methods must be called on the same thread.
+class InputRecorder {
+ public:
+  InputRecorder();
+  ~InputRecorder();
+
+  // Start a session in |path| at the given framebuffer size. Returns false if
+  // the file cannot be created.
+  bool Open(const std::string& path, int width, int height);
+
+  void RecordKey(int key, int scancode, int action, int mods);
+  void RecordMouseButton(int button, int action, int mods);
+  void RecordScroll(double x, double y);
+  void RecordCursorPos(double x, double y);
+  void RecordFramebufferSize(int width, int height);
+
+  // Write the END record and close the file. Called by the destructor.
+  void Close();
+
+  int64_t records() const { return records_; }
+  int64_t bytes() const { return bytes_; }
+
+ private:
+  void BeginRecord(InputLogEvent::Type type);
+  void PutVarint(uint64_t value);
+  void PutSigned(int value);
+  void PutFloat(double value);
+  void EndRecord();
+
+  FILE* file_;
+  int64_t start_us_;
+  int64_t last_us_;
+  std::vector<uint8_t> record_;
+  int64_t records_;
+  int64_t bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(InputRecorder);
+};
+
+// Reads a session and hands its events out as they fall due, optionally at a
+// multiple of the recorded speed. All methods must be called on the same
+// thread.
+class InputReplayer {
+ public:
+  InputReplayer();
+
+  // Read and validate the session in |path|. Returns false on failure.
+  bool Load(const std::string& path);
+
+  // Start the clock. |speed| > 1 replays faster than recorded.
+  void Start(double speed);
+
+  // Move the events that are due into |events|. The END event is returned
+  // once the recorded session length has elapsed.
+  void TakeDueEvents(std::vector<InputLogEvent>* events);
+
+  // Microseconds until the next event is due, 0 if one is due now and -1
+  // when all events were taken or replay has not started.
+  int64_t TimeUntilNextEventUs() const;
+
+  bool finished() const { return next_ >= events_.size(); }
+  size_t event_count() const { return events_.size(); }
+  // Recorded session length.
+  int64_t duration_us() const {
+    return events_.empty() ? 0 : events_.back().time_us;
+  }
+
+ private:
+  int64_t ReplayTimeUs(const InputLogEvent& event) const;
+
+  std::vector<InputLogEvent> events_;
+  size_t next_;
+  int64_t start_us_;
+  double speed_;
+
+  DISALLOW_COPY_AND_ASSIGN(InputReplayer);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_INPUT_LOG_H_
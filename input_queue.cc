@@ -0,0 +1,117 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "input_queue.h"
+
+#include <chrono>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+InputQueue::InputQueue()
+    : move_index_(-1),
+      wheel_index_(-1),
+      received_events_(0),
+      sent_events_(0) {}
+
+void InputQueue::AddMouseMove(const CefMouseEvent& event, bool mouse_leave) {
+  received_events_++;
+  // Only the latest position matters, but latency counts from the oldest
+  // merged move. Keeping the merged move at the end keeps the order of its
+  // last occurrence relative to the wheel.
+  Event move;
+  move.time_us = NowUs();
+  if (move_index_ >= 0)
+    move.time_us = Remove(move_index_).time_us;
+
+  move.type = MOUSE_MOVE;
+  move.mouse = event;
+  move.mouse_leave = mouse_leave;
+  events_.push_back(move);
+  move_index_ = static_cast<int>(events_.size()) - 1;
+}
+
+void InputQueue::AddMouseWheel(const CefMouseEvent& event,
+                               double delta_x,
+                               double delta_y) {
+  received_events_++;
+  Event wheel;
+  wheel.time_us = NowUs();
+  if (wheel_index_ >= 0)
+    wheel = Remove(wheel_index_);
+
+  wheel.type = MOUSE_WHEEL;
+  wheel.mouse = event;
+  wheel.delta_x += delta_x;
+  wheel.delta_y += delta_y;
+  events_.push_back(wheel);
+  wheel_index_ = static_cast<int>(events_.size()) - 1;
+}
+
+void InputQueue::AddMouseClick(const CefMouseEvent& event,
+                               CefBrowserHost::MouseButtonType button,
+                               bool mouse_up,
+                               int click_count) {
+  received_events_++;
+  Event click;
+  click.type = MOUSE_CLICK;
+  click.time_us = NowUs();
+  click.mouse = event;
+  click.button = button;
+  click.mouse_up = mouse_up;
+  click.click_count = click_count;
+  events_.push_back(click);
+
+  // Later moves and wheel events must follow the transition.
+  move_index_ = -1;
+  wheel_index_ = -1;
+}
+
+void InputQueue::AddKey(const CefKeyEvent& event) {
+  received_events_++;
+  Event key;
+  key.type = KEY;
+  key.time_us = NowUs();
+  key.key = event;
+  events_.push_back(key);
+
+  move_index_ = -1;
+  wheel_index_ = -1;
+}
+
+void InputQueue::TakeEvents(EventList* events) {
+  DCHECK(events);
+  events->clear();
+  events->swap(events_);
+  sent_events_ += events->size();
+  move_index_ = -1;
+  wheel_index_ = -1;
+}
+
+InputQueue::Event InputQueue::Remove(int index) {
+  DCHECK(index == move_index_ || index == wheel_index_);
+  const Event event = events_[index];
+  events_.erase(events_.begin() + index);
+
+  // The merge candidates follow the last transition, so at most the other
+  // one moves down.
+  if (move_index_ == index)
+    move_index_ = -1;
+  else if (move_index_ > index)
+    move_index_--;
+  if (wheel_index_ == index)
+    wheel_index_ = -1;
+  else if (wheel_index_ > index)
+    wheel_index_--;
+  return event;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_INPUT_QUEUE_H_
+#define CEF_TESTS_CEFSIMPLE_INPUT_QUEUE_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/cef_browser.h"
+
+// Collects the input events received between two frames and merges them so
+// that they can be sent once per frame. Pointer moves collapse to the latest
+// one and wheel deltas are summed, but never across a button or key
+// transition, so transitions reach the browsers in order and at the pointer
+// position they happened at.
+//
+// Must be used on a single thread.
+class InputQueue {
+ public:
+  enum Type {
+    MOUSE_MOVE,
+    MOUSE_WHEEL,
+    MOUSE_CLICK,
+    KEY,
+  };
+
+  struct Event {
+    Event()
+        : type(MOUSE_MOVE),
+          mouse_leave(false),
+          delta_x(0),
+          delta_y(0),
+          button(MBT_LEFT),
+          mouse_up(false),
+          click_count(0),
+          time_us(0) {}
+
+    Type type;
+
+    // Pointer position of the MOUSE_* types.
+    CefMouseEvent mouse;
+
+    // MOUSE_MOVE.
+    bool mouse_leave;
+
+    // MOUSE_WHEEL. Sum of the merged deltas.
+    double delta_x;
+    double delta_y;
+
+    // MOUSE_CLICK.
+    CefBrowserHost::MouseButtonType button;
+    bool mouse_up;
+    int click_count;
+
+    // KEY.
+    CefKeyEvent key;
+
+    // Steady clock time in microseconds at which the oldest of the merged
+    // events was received.
+    int64_t time_us;
+  };
+  typedef std::vector<Event> EventList;
+
+  InputQueue();
+
+  void AddMouseMove(const CefMouseEvent& event, bool mouse_leave);
+  void AddMouseWheel(const CefMouseEvent& event,
+                     double delta_x,
+                     double delta_y);
+  void AddMouseClick(const CefMouseEvent& event,
+                     CefBrowserHost::MouseButtonType button,
+                     bool mouse_up,
+                     int click_count);
+  void AddKey(const CefKeyEvent& event);
+
+  // Move the merged events into |events|, oldest first, and clear the queue.
+  void TakeEvents(EventList* events);
+
+  bool empty() const { return events_.empty(); }
+
+  // Events added, and events handed out by TakeEvents().
+  int64_t received_events() const { return received_events_; }
+  int64_t sent_events() const { return sent_events_; }
+
+ private:
+  // Remove the event at |index|, which must be the merge candidate of its
+  // type, and return it.
+  Event Remove(int index);
+
+  EventList events_;
+
+  // Index of the move and wheel events that new ones merge into, or -1.
+  int move_index_;
+  int wheel_index_;
+
+  int64_t received_events_;
+  int64_t sent_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(InputQueue);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_INPUT_QUEUE_H_
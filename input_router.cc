@@ -0,0 +1,249 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "input_router.h"
+
+#include <algorithm>
+
+#include "include/wrapper/cef_helpers.h"
+
+InputRouter::InputRouter()
+    : cell_width_(1),
+      cell_height_(1),
+      hover_id_(-1),
+      focus_id_(-1),
+      capture_id_(-1),
+      buttons_down_(0),
+      window_focused_(true),
+      latency_tracer_(NULL),
+      routed_events_(0) {}
+
+void InputRouter::SetLayout(const TargetList& targets, int width, int height) {
+  CEF_REQUIRE_UI_THREAD();
+
+  const int captured = FindTarget(capture_id_);
+  const CefRect capture_rect =
+      captured >= 0 ? targets_[captured].rect : CefRect();
+
+  targets_ = targets;
+
+  cell_width_ = std::max(1, (width + kGridSize - 1) / kGridSize);
+  cell_height_ = std::max(1, (height + kGridSize - 1) / kGridSize);
+  cells_.assign(kGridSize * kGridSize, std::vector<int>());
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    const CefRect& rect = targets_[i].rect;
+    if (rect.IsEmpty())
+      continue;
+    const int left = std::max(0, rect.x / cell_width_);
+    const int top = std::max(0, rect.y / cell_height_);
+    const int right =
+        std::min(kGridSize - 1, (rect.x + rect.width - 1) / cell_width_);
+    const int bottom =
+        std::min(kGridSize - 1, (rect.y + rect.height - 1) / cell_height_);
+    for (int y = top; y <= bottom; ++y) {
+      for (int x = left; x <= right; ++x)
+        cells_[y * kGridSize + x].push_back(static_cast<int>(i));
+    }
+  }
+
+  // A drag cannot continue in a view that moved under the pointer.
+  if (capture_id_ >= 0) {
+    const int index = FindTarget(capture_id_);
+    if (index < 0) {
+      capture_id_ = -1;
+      buttons_down_ = 0;
+    } else if (targets_[index].rect != capture_rect) {
+      LoseCapture();
+    }
+  }
+
+  if (FindTarget(hover_id_) < 0)
+    hover_id_ = -1;
+  if (FindTarget(focus_id_) < 0)
+    focus_id_ = -1;
+  if (focus_id_ < 0 && !targets_.empty())
+    SetFocus(0);
+}
+
+void InputRouter::Dispatch(const InputQueue::Event& event) {
+  CEF_REQUIRE_UI_THREAD();
+
+  switch (event.type) {
+    case InputQueue::MOUSE_MOVE: {
+      const int index = SendMouseMove(event.mouse, event.mouse_leave);
+      if (index >= 0) {
+        const CefMouseEvent translated = Translate(event.mouse, index);
+        Trace(index, LatencyTracer::MOUSE_MOVE, event, translated.x,
+              translated.y);
+      }
+      break;
+    }
+    case InputQueue::MOUSE_WHEEL: {
+      const int index = capture_id_ >= 0
+                            ? FindTarget(capture_id_)
+                            : HitTest(event.mouse.x, event.mouse.y);
+      if (index < 0)
+        break;
+      targets_[index].host->SendMouseWheelEvent(
+          Translate(event.mouse, index), static_cast<int>(event.delta_x),
+          static_cast<int>(event.delta_y));
+      routed_events_++;
+      Trace(index, LatencyTracer::MOUSE_WHEEL, event, 0, 0);
+      break;
+    }
+    case InputQueue::MOUSE_CLICK:
+      SendMouseClick(event);
+      break;
+    case InputQueue::KEY: {
+      const int index = FindTarget(focus_id_);
+      if (index < 0)
+        break;
+      targets_[index].host->SendKeyEvent(event.key);
+      routed_events_++;
+      Trace(index, LatencyTracer::KEY, event, event.key.character, 0);
+      break;
+    }
+  }
+}
+
+void InputRouter::OnWindowFocusChanged(bool focused) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (focused == window_focused_)
+    return;
+  window_focused_ = focused;
+
+  if (!focused)
+    LoseCapture();
+
+  const int index = FindTarget(focus_id_);
+  if (index >= 0) {
+    targets_[index].host->SendFocusEvent(focused);
+    routed_events_++;
+  }
+}
+
+int InputRouter::HitTest(int x, int y) const {
+  if (x < 0 || y < 0 || cells_.empty())
+    return -1;
+  const int cell_x = x / cell_width_;
+  const int cell_y = y / cell_height_;
+  if (cell_x >= kGridSize || cell_y >= kGridSize)
+    return -1;
+
+  const std::vector<int>& cell = cells_[cell_y * kGridSize + cell_x];
+  for (size_t i = 0; i < cell.size(); ++i) {
+    if (targets_[cell[i]].rect.Contains(x, y))
+      return cell[i];
+  }
+  return -1;
+}
+
+int InputRouter::FindTarget(int browser_id) const {
+  if (browser_id < 0)
+    return -1;
+  for (size_t i = 0; i < targets_.size(); ++i) {
+    if (targets_[i].id == browser_id)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+CefMouseEvent InputRouter::Translate(const CefMouseEvent& event,
+                                     int index) const {
+  CefMouseEvent translated = event;
+  translated.x -= targets_[index].rect.x;
+  translated.y -= targets_[index].rect.y;
+  return translated;
+}
+
+int InputRouter::SendMouseMove(const CefMouseEvent& event, bool mouse_leave) {
+  const int index =
+      capture_id_ >= 0 ? FindTarget(capture_id_) : HitTest(event.x, event.y);
+  const int id = index >= 0 ? targets_[index].id : -1;
+
+  // Let the view the pointer left clear its hover state.
+  if (hover_id_ >= 0 && hover_id_ != id) {
+    const int previous = FindTarget(hover_id_);
+    if (previous >= 0) {
+      targets_[previous].host->SendMouseMoveEvent(
+          Translate(event, previous), true);
+      routed_events_++;
+    }
+  }
+  hover_id_ = mouse_leave ? -1 : id;
+
+  if (index >= 0) {
+    targets_[index].host->SendMouseMoveEvent(
+        Translate(event, index), mouse_leave);
+    routed_events_++;
+  }
+  return index;
+}
+
+void InputRouter::SendMouseClick(const InputQueue::Event& event) {
+  const int index = capture_id_ >= 0
+                        ? FindTarget(capture_id_)
+                        : HitTest(event.mouse.x, event.mouse.y);
+  if (index < 0)
+    return;
+
+  const int button = 1 << event.button;
+  if (event.mouse_up) {
+    buttons_down_ &= ~button;
+  } else {
+    if (capture_id_ < 0)
+      capture_id_ = targets_[index].id;
+    buttons_down_ |= button;
+    SetFocus(index);
+  }
+
+  targets_[index].host->SendMouseClickEvent(
+      Translate(event.mouse, index), event.button, event.mouse_up,
+      event.click_count);
+  routed_events_++;
+  Trace(index, LatencyTracer::MOUSE_CLICK, event, 0, 0);
+
+  if (buttons_down_ == 0)
+    capture_id_ = -1;
+}
+
+void InputRouter::SetFocus(int index) {
+  const int id = targets_[index].id;
+  if (id == focus_id_)
+    return;
+
+  const int previous = FindTarget(focus_id_);
+  focus_id_ = id;
+  if (!window_focused_)
+    return;
+
+  if (previous >= 0) {
+    targets_[previous].host->SendFocusEvent(false);
+    routed_events_++;
+  }
+  targets_[index].host->SendFocusEvent(true);
+  routed_events_++;
+}
+
+void InputRouter::Trace(int index,
+                        LatencyTracer::Type type,
+                        const InputQueue::Event& event,
+                        int a,
+                        int b) {
+  if (latency_tracer_) {
+    latency_tracer_->OnInputSent(targets_[index].id,
+                                 type, event.time_us, a, b);
+  }
+}
+
+void InputRouter::LoseCapture() {
+  const int index = FindTarget(capture_id_);
+  if (index >= 0) {
+    targets_[index].host->SendCaptureLostEvent();
+    routed_events_++;
+  }
+  capture_id_ = -1;
+  buttons_down_ = 0;
+}
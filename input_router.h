@@ -0,0 +1,105 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_INPUT_ROUTER_H_
+#define CEF_TESTS_CEFSIMPLE_INPUT_ROUTER_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/cef_browser.h"
+#include "input_queue.h"
+#include "latency_tracer.h"
+
+// Sends input to the browsers laid out in the window instead of to all of
+// them. Pointer events go to the browser under the pointer, translated to its
+// view coordinates. While a button is held they keep going to the browser it
+// was pressed in, which loses the capture if its view moves or the window
+// loses focus. Keys go to the focused browser, which is the one last clicked
+// and initially the first one laid out.
+//
+// Views are found through a uniform grid over the window that lists the
+// views overlapping each cell. All methods must be called on the CEF UI
+// thread.
+class InputRouter {
+ public:
+  // Cells per side of the grid.
+  static const int kGridSize = 8;
+
+  struct Target {
+    Target() : id(-1) {}
+
+    // Browser identifier and cached host of the view.
+    int id;
+    CefRefPtr<CefBrowserHost> host;
+    // Window rectangle of the view, with a top-left origin.
+    CefRect rect;
+  };
+  typedef std::vector<Target> TargetList;
+
+  InputRouter();
+
+  // Replace the layout. |width| and |height| are the window size.
+  void SetLayout(const TargetList& targets, int width, int height);
+
+  void Dispatch(const InputQueue::Event& event);
+
+  // Tag the input sent to the browsers in |tracer|, or stop if NULL.
+  void set_latency_tracer(LatencyTracer* tracer) { latency_tracer_ = tracer; }
+
+  void OnWindowFocusChanged(bool focused);
+
+  // Browser id of the focused view, or -1.
+  int focus_id() const { return focus_id_; }
+  bool window_focused() const { return window_focused_; }
+
+  // Browser calls made by Dispatch().
+  int64_t routed_events() const { return routed_events_; }
+
+ private:
+  // Index into |targets_| of the view containing |x|,|y|, or -1.
+  int HitTest(int x, int y) const;
+  int FindTarget(int browser_id) const;
+
+  // |event| translated to the view coordinates of |targets_[index]|.
+  CefMouseEvent Translate(const CefMouseEvent& event, int index) const;
+
+  // Returns the index of the target the move was sent to, or -1.
+  int SendMouseMove(const CefMouseEvent& event, bool mouse_leave);
+  void SendMouseClick(const InputQueue::Event& event);
+  void SetFocus(int index);
+  void Trace(int index,
+             LatencyTracer::Type type,
+             const InputQueue::Event& event,
+             int a,
+             int b);
+  // Tell the view holding the pointer capture that it lost it.
+  void LoseCapture();
+
+  TargetList targets_;
+
+  // Target indices overlapping each grid cell, row by row.
+  std::vector<std::vector<int>> cells_;
+  int cell_width_;
+  int cell_height_;
+
+  // Browser ids of the view under the pointer, the focused view and the
+  // view holding the pointer capture, or -1.
+  int hover_id_;
+  int focus_id_;
+  int capture_id_;
+  // MouseButtonType bits of the buttons held since the capture started.
+  int buttons_down_;
+
+  bool window_focused_;
+  LatencyTracer* latency_tracer_;
+  int64_t routed_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(InputRouter);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_INPUT_ROUTER_H_
@@ -0,0 +1,279 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "latency_tracer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+// Size of the echo blocks in CSS pixels and value of the marker block.
+const int kEchoBlockCss = 4;
+const int kEchoBlocks = 5;
+const int64_t kEchoMarker = 0xEC40E5;
+
+// Block of each input type on the echo page.
+const int kEchoBlock[LatencyTracer::TYPE_COUNT] = {1, 3, 4, 2};
+
+const char* const kTypeNames[LatencyTracer::TYPE_COUNT] = {"move", "click",
+                                                           "wheel", "key"};
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+const char LatencyTracer::kEchoPageUrl[] =
+    "data:text/html,<html><body style=\"margin:0\"><script>"
+    "var d=[];for(var i=0;i<5;i++){var e=document.createElement('div');"
+    "e.style.cssText='position:fixed;top:0;width:4px;height:4px;left:'+4*i+"
+    "'px';document.body.appendChild(e);d.push(e);}"
+    "function put(i,v){d[i].style.background="
+    "'rgb('+(v>>16&255)+','+(v>>8&255)+','+(v&255)+')';}"
+    "for(i=1;i<5;i++)put(i,0);put(0,15483109);var k=0,c=0,w=0;"
+    "onmousemove=function(e){put(1,(e.clientX&4095)<<12|e.clientY&4095);};"
+    "onkeypress=function(e){k=k+1&255;put(2,k<<16|e.charCode&65535);};"
+    "onmousedown=onmouseup=function(){c++;put(3,c&16777215);};"
+    "onwheel=function(){w++;put(4,w&16777215);};"
+    "</script></body></html>";
+
+void LatencyTracer::Histogram::Add(double ms) {
+  if (samples.size() < kCapacity)
+    samples.push_back(ms);
+  else
+    samples[count % kCapacity] = ms;
+  count++;
+}
+
+double LatencyTracer::Histogram::Percentile(
+    double p,
+    std::vector<double>* scratch) const {
+  if (samples.empty())
+    return 0;
+  scratch->assign(samples.begin(), samples.end());
+  const size_t rank = std::min(
+      scratch->size() - 1,
+      static_cast<size_t>(p / 100.0 * (scratch->size() - 1) + 0.5));
+  std::nth_element(scratch->begin(), scratch->begin() + rank, scratch->end());
+  return (*scratch)[rank];
+}
+
+void LatencyTracer::PaintedRing::Push(const Input& input) {
+  if (size == kCapacity) {
+    begin = (begin + 1) % kCapacity;
+    size--;
+  }
+  At(size++) = input;
+}
+
+LatencyTracer::LatencyTracer()
+    : render_start_us_(0), unmatched_(0), presented_since_report_(0) {}
+
+void LatencyTracer::OnInputSent(int browser_id,
+                                Type type,
+                                int64_t input_us,
+                                int a,
+                                int b) {
+  base::AutoLock lock_scope(lock_);
+  BrowserState& state = browsers_[browser_id];
+
+  Input input;
+  input.type = type;
+  input.index = ++state.sent[type];
+  input.a = a;
+  input.b = b;
+  input.input_us = input_us;
+  input.paint_us = 0;
+  state.pending.push_back(input);
+}
+
+void LatencyTracer::OnPaint(int browser_id,
+                            const void* buffer,
+                            int width,
+                            int height,
+                            float scale) {
+  const int64_t now = NowUs();
+  base::AutoLock lock_scope(lock_);
+  std::map<int, BrowserState>::iterator it = browsers_.find(browser_id);
+  if (it == browsers_.end())
+    return;
+  BrowserState& state = it->second;
+
+  while (!state.pending.empty() &&
+         now - state.pending.front().input_us > kMaxPendingUs) {
+    state.pending.pop_front();
+    unmatched_++;
+  }
+
+  int64_t echo[TYPE_COUNT];
+  state.echo = ReadEcho(buffer, width, height, scale, echo);
+  if (!state.echo) {
+    // Without the echo page any input sent so far may be reflected.
+    for (int type = 0; type < TYPE_COUNT; ++type) {
+      if (!state.pending.empty())
+        Resolve(&state, static_cast<Type>(type), state.pending.size() - 1,
+                now);
+    }
+    return;
+  }
+
+  for (int type = 0; type < TYPE_COUNT; ++type) {
+    if (echo[type] == state.echoed[type])
+      continue;
+    state.echoed[type] = echo[type];
+
+    // The newest input matching the echo. Older inputs of the same type were
+    // handled before it, or merged into it by the renderer.
+    size_t match = state.pending.size();
+    for (size_t i = 0; i < state.pending.size(); ++i) {
+      const Input& input = state.pending[i];
+      if (input.type != type)
+        continue;
+      bool matches;
+      switch (input.type) {
+        case MOUSE_MOVE:
+          matches = echo[type] == ((input.a & 4095) << 12 | (input.b & 4095));
+          break;
+        case KEY:
+          matches =
+              echo[type] == ((input.index & 255) << 16 | (input.a & 65535));
+          break;
+        default:
+          // Event counts.
+          matches = (input.index & 0xffffff) <= echo[type];
+          break;
+      }
+      if (matches)
+        match = i;
+    }
+    if (match < state.pending.size())
+      Resolve(&state, static_cast<Type>(type), match, now);
+  }
+}
+
+void LatencyTracer::OnBrowserClosed(int browser_id) {
+  base::AutoLock lock_scope(lock_);
+  browsers_.erase(browser_id);
+}
+
+void LatencyTracer::OnRenderStart() {
+  const int64_t now = NowUs();
+  base::AutoLock lock_scope(lock_);
+  render_start_us_ = now;
+}
+
+void LatencyTracer::OnFramePresented() {
+  const int64_t now = NowUs();
+  base::AutoLock lock_scope(lock_);
+
+  size_t kept = 0;
+  for (size_t i = 0; i < painted_.size; ++i) {
+    const Input& input = painted_.At(i);
+    if (input.paint_us > render_start_us_) {
+      painted_.At(kept++) = input;
+      continue;
+    }
+    present_[input.type].Add((now - input.input_us) / 1000.0);
+    presented_since_report_++;
+  }
+  painted_.size = kept;
+
+  if (presented_since_report_ < kReportInterval)
+    return;
+  presented_since_report_ = 0;
+  LOG(INFO) << "Input latency p50/p95/p99 (ms): " << SummaryLocked();
+}
+
+std::string LatencyTracer::Summary() {
+  base::AutoLock lock_scope(lock_);
+  return SummaryLocked();
+}
+
+// static
+const char* LatencyTracer::TypeName(Type type) {
+  return kTypeNames[type];
+}
+
+void LatencyTracer::Resolve(BrowserState* state,
+                            Type type,
+                            size_t last,
+                            int64_t now_us) {
+  std::deque<Input>& pending = state->pending;
+  size_t kept = 0;
+  for (size_t i = 0; i < pending.size(); ++i) {
+    Input& input = pending[i];
+    if (i > last || input.type != type) {
+      if (kept != i)
+        pending[kept] = input;
+      kept++;
+      continue;
+    }
+    input.paint_us = now_us;
+    paint_[type].Add((now_us - input.input_us) / 1000.0);
+    // Nothing presents in headless mode; the ring drops the oldest entries.
+    painted_.Push(input);
+  }
+  pending.resize(kept);
+}
+
+// static
+bool LatencyTracer::ReadEcho(const void* buffer,
+                             int width,
+                             int height,
+                             float scale,
+                             int64_t* values) {
+  const uint8_t* pixels = static_cast<const uint8_t*>(buffer);
+  int64_t blocks[kEchoBlocks];
+  const int y = static_cast<int>(kEchoBlockCss / 2 * scale);
+  for (int i = 0; i < kEchoBlocks; ++i) {
+    const int x =
+        static_cast<int>((i * kEchoBlockCss + kEchoBlockCss / 2) * scale);
+    if (x >= width || y >= height)
+      return false;
+    // BGRA.
+    const uint8_t* pixel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+    blocks[i] = pixel[2] << 16 | pixel[1] << 8 | pixel[0];
+  }
+  if (blocks[0] != kEchoMarker)
+    return false;
+
+  for (int type = 0; type < TYPE_COUNT; ++type)
+    values[type] = blocks[kEchoBlock[type]];
+  return true;
+}
+
+std::string LatencyTracer::SummaryLocked() {
+  std::string summary;
+  char buffer[160];
+  for (int type = 0; type < TYPE_COUNT; ++type) {
+    const Histogram& paint = paint_[type];
+    const Histogram& present = present_[type];
+    if (paint.count == 0)
+      continue;
+    snprintf(buffer, sizeof(buffer),
+             "%s%s paint %.1f/%.1f/%.1f present %.1f/%.1f/%.1f (%lld)",
+             summary.empty() ? "" : "  ", kTypeNames[type],
+             paint.Percentile(50, &scratch_), paint.Percentile(95, &scratch_),
+             paint.Percentile(99, &scratch_),
+             present.Percentile(50, &scratch_),
+             present.Percentile(95, &scratch_),
+             present.Percentile(99, &scratch_),
+             static_cast<long long>(paint.count));
+    summary += buffer;
+  }
+  if (unmatched_ > 0) {
+    snprintf(buffer, sizeof(buffer), "  %lld unmatched",
+             static_cast<long long>(unmatched_));
+    summary += buffer;
+  }
+  return summary.empty() ? "no samples" : summary;
+}
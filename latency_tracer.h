@@ -0,0 +1,153 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_LATENCY_TRACER_H_
+#define CEF_TESTS_CEFSIMPLE_LATENCY_TRACER_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "include/base/cef_lock.h"
+#include "include/base/cef_macros.h"
+
+// Measures the time from an input event to the first paint that reflects it
+// and to the present that shows that paint, per event type.
+//
+// Every input sent to a browser is tagged with a per-browser sequence number
+// and its arrival time. If the browser shows kEchoPageUrl, which paints the
+// last input of each type it received into the top-left corner, a paint
+// resolves exactly the inputs it echoes. Any other page resolves every input
+// sent before the paint. A resolved input is presented by the first frame
+// that starts rendering after its paint.
+//
+// Methods may be called from any thread.
+class LatencyTracer {
+ public:
+  enum Type {
+    MOUSE_MOVE,
+    MOUSE_CLICK,
+    MOUSE_WHEEL,
+    KEY,
+    TYPE_COUNT
+  };
+
+  // Samples kept per histogram.
+  static const size_t kCapacity = 1024;
+  // Inputs not painted within this time are dropped as unmatched.
+  static const int64_t kMaxPendingUs = 1000000;
+  // Presented inputs between log reports.
+  static const int kReportInterval = 120;
+
+  // Page that echoes input into 4x4 CSS pixel blocks along the top edge: a
+  // marker, the last mouse position, the last character with a keypress
+  // count, and the mouse button and wheel event counts.
+  static const char kEchoPageUrl[];
+
+  LatencyTracer();
+
+  // |a| and |b| identify the input to the echo page: the view coordinates of
+  // a move, and the character of a key in |a|.
+  void OnInputSent(int browser_id,
+                   Type type,
+                   int64_t input_us,
+                   int a,
+                   int b);
+
+  // A view paint of |browser_id|. |scale| is the device scale factor the
+  // page was painted at.
+  void OnPaint(int browser_id,
+               const void* buffer,
+               int width,
+               int height,
+               float scale);
+
+  void OnBrowserClosed(int browser_id);
+
+  // Called when a frame starts rendering and once it was presented.
+  void OnRenderStart();
+  void OnFramePresented();
+
+  // Input to paint and input to present p50/p95/p99 per event type.
+  std::string Summary();
+
+  static const char* TypeName(Type type);
+
+ private:
+  struct Input {
+    Type type;
+    // Per-browser count of inputs of |type| sent, including this one.
+    int64_t index;
+    int a;
+    int b;
+    int64_t input_us;
+    int64_t paint_us;
+  };
+
+  // Ring buffer of latencies in milliseconds.
+  struct Histogram {
+    Histogram() : count(0) {}
+    void Add(double ms);
+    double Percentile(double p, std::vector<double>* scratch) const;
+
+    std::vector<double> samples;
+    int64_t count;
+  };
+
+  // Ring buffer of painted inputs waiting for a present. When full, the
+  // oldest input is dropped.
+  struct PaintedRing {
+    PaintedRing() : inputs(kCapacity), begin(0), size(0) {}
+    Input& At(size_t i) { return inputs[(begin + i) % kCapacity]; }
+    void Push(const Input& input);
+
+    std::vector<Input> inputs;
+    size_t begin;
+    size_t size;
+  };
+
+  struct BrowserState {
+    BrowserState() : echo(false) {
+      for (int i = 0; i < TYPE_COUNT; ++i) {
+        sent[i] = 0;
+        echoed[i] = -1;
+      }
+    }
+
+    std::deque<Input> pending;
+    int64_t sent[TYPE_COUNT];
+    // Last decoded echo block of each type, or -1.
+    int64_t echoed[TYPE_COUNT];
+    bool echo;
+  };
+
+  // Move inputs of |type| up to and including |last| out of |pending|.
+  void Resolve(BrowserState* state, Type type, size_t last, int64_t now_us);
+  // Decode the echo blocks of |buffer|. Returns false if there are none.
+  static bool ReadEcho(const void* buffer,
+                       int width,
+                       int height,
+                       float scale,
+                       int64_t* values);
+  std::string SummaryLocked();
+
+  base::Lock lock_;
+  std::map<int, BrowserState> browsers_;
+  PaintedRing painted_;
+  int64_t render_start_us_;
+
+  Histogram paint_[TYPE_COUNT];
+  Histogram present_[TYPE_COUNT];
+  int64_t unmatched_;
+  int presented_since_report_;
+  std::vector<double> scratch_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyTracer);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_LATENCY_TRACER_H_
@@ -1,31 +1,117 @@
 #include <GLFW/glfw3.h>
-#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
 
 #include <thread>
 #include <time.h>
+#include <include/cef_command_line.h>
 #include <include/wrapper/cef_library_loader.h>
 #include <include/internal/cef_mac.h>
+#include "external_message_pump.h"
+#include "frame_deadline_scheduler.h"
+#include "input_log.h"
+#include "input_queue.h"
+#include "render_thread.h"
 #include "simple_app.h"
 #include "simple_handler.h"
 
-typedef std::function<void(CefBrowserHost*)> Handle;
-
 static int mouse_x_ = 0;
 static int mouse_y_ = 0;
 
-static void foreachBrowser(const Handle &handle) {
-    auto browsers = SimpleHandler::GetInstance()->getBrowserList();
-    for (const auto &browser : browsers) {
-        handle(browser->GetHost());
-    }
-}
+// Input received since the last frame, sent by dispatchInput().
+static InputQueue input_queue_;
+
+// Records the input callbacks with --record-input=<file>.
+static InputRecorder* input_recorder_ = nullptr;
+
+// Replays a recorded session with --replay-input=<file> instead of live input.
+static InputReplayer* input_replayer_ = nullptr;
+
+// Frame metric totals and time when the replay started, for the report.
+static double replay_totals_[FrameMetrics::METRIC_COUNT];
+static int64_t replay_frames_ = 0;
+static double replay_start_time_ = 0;
+
+// Owns the GL context when rendering on a dedicated thread.
+static RenderThread* render_thread_ = nullptr;
+
+// Schedules CEF work when running with --external-message-pump.
+static ExternalMessagePump* message_pump_ = nullptr;
+
+// Keeps CEF work from delaying presents when rendering on the main thread.
+static FrameDeadlineScheduler deadline_scheduler_;
+
+// Longest the main thread waits for events before running CEF work when it
+// has nothing to draw. With --external-message-pump it waits until CEF work
+// is scheduled instead.
+static const double kEventWaitTimeout = 0.004;
+static const double kMinEventWaitTimeout = 0.0001;
+
+static const char kWindowTitle[] = "Hello World";
+
+// Seconds between window title updates while the HUD is shown.
+static const double kHudTitleInterval = 0.5;
 
 static void error_callback(int error, const char* description) {
     fputs(description, stderr);
 }
 
+// Path the frame metrics are written to on F3 and on exit.
+static std::string metricsDumpPath() {
+    std::string path = CefCommandLine::GetGlobalCommandLine()->GetSwitchValue("frame-metrics-file");
+    return path.empty() ? "frame_metrics.csv" : path;
+}
+
+static void dumpFrameMetrics() {
+    const std::string path = metricsDumpPath();
+    if (SimpleHandler::GetInstance()->frame_metrics().Dump(path))
+        LOG(INFO) << "Frame metrics written to " << path;
+    else
+        LOG(ERROR) << "Failed to write frame metrics to " << path;
+}
+
+// Lowers the render scale by a quarter, wrapping back to full resolution.
+static void cycleRenderScale() {
+    SimpleHandler* handler = SimpleHandler::GetInstance();
+    double scale = handler->render_scale() - 0.25;
+    if (scale < 0.5)
+        scale = 1.0;
+    handler->SetRenderScale(scale);
+    LOG(INFO) << "Render scale " << scale;
+}
+
+// F2 toggles the frame time HUD, F3 dumps the frame metrics, F4 cycles
+// the render scale and F5 opens another view of the startup URL, from the
+// browser pool when it has one ready. Returns true if |key| was handled and
+// must not reach the browsers.
+static bool handleHotkey(int key) {
+    switch (key) {
+        case GLFW_KEY_F2:
+            SimpleHandler::GetInstance()->ToggleHud();
+            return true;
+        case GLFW_KEY_F3:
+            dumpFrameMetrics();
+            return true;
+        case GLFW_KEY_F4:
+            cycleRenderScale();
+            return true;
+        case GLFW_KEY_F5:
+            SimpleHandler::GetInstance()->OpenBrowser(SimpleApp::GetStartupUrl());
+            return true;
+        default:
+            return false;
+    }
+}
+
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (input_recorder_)
+        input_recorder_->RecordKey(key, scancode, action, mods);
+
     bool pressed = (action == GLFW_PRESS);
+    if (pressed && handleHotkey(key))
+        return;
 
     CefKeyEvent evt;
     evt.native_key_code = key;
@@ -34,12 +120,14 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
     evt.native_key_code = key;
     evt.type = KEYEVENT_CHAR;
 
-    foreachBrowser([&](CefBrowserHost* browser){
-        browser->SendKeyEvent(evt);
-    });
+    SimpleHandler::GetInstance()->OnInputEvent();
+    input_queue_.AddKey(evt);
 }
 
 static void mouse_callback(GLFWwindow* window, int btn, int state, int mods) {
+    if (input_recorder_)
+        input_recorder_->RecordMouseButton(btn, state, mods);
+
     int mouse_up = (GLFW_RELEASE == state);
 
     std::map<int, CefBrowserHost::MouseButtonType> btn_type_map;
@@ -55,22 +143,26 @@ static void mouse_callback(GLFWwindow* window, int btn, int state, int mods) {
     //TODO
     int click_count = 1;
 
-    foreachBrowser([&](CefBrowserHost* browser){
-        browser->SendMouseClickEvent(evt, btn_type, mouse_up, click_count);
-    });
+    SimpleHandler::GetInstance()->OnInputEvent();
+    input_queue_.AddMouseClick(evt, btn_type, mouse_up, click_count);
 }
 
 static void scroll_callback(GLFWwindow* window, double xAxis, double yAxis) {
+    if (input_recorder_)
+        input_recorder_->RecordScroll(xAxis, yAxis);
+
     CefMouseEvent evt;
     evt.x = mouse_x_;
     evt.y = mouse_y_;
 
-    foreachBrowser([&](CefBrowserHost* browser){
-        browser->SendMouseWheelEvent(evt, static_cast<int>(xAxis), static_cast<int>(yAxis));
-    });
+    SimpleHandler::GetInstance()->OnInputEvent();
+    input_queue_.AddMouseWheel(evt, xAxis, yAxis);
 }
 
 static void motion_callback(GLFWwindow* window, double x, double y) {
+    if (input_recorder_)
+        input_recorder_->RecordCursorPos(x, y);
+
     mouse_x_ = x;
     mouse_y_ = y;
 
@@ -81,29 +173,318 @@ static void motion_callback(GLFWwindow* window, double x, double y) {
     //TODO
     bool mouse_leave = false;
 
-    foreachBrowser([&](CefBrowserHost* browser){
-        browser->SendMouseMoveEvent(evt, mouse_leave);
-    });
+    SimpleHandler::GetInstance()->OnInputEvent();
+    input_queue_.AddMouseMove(evt, mouse_leave);
+}
+
+// Sends the input merged since the last frame to the browsers, once per
+// message loop iteration.
+static void dispatchInput(SimpleHandler* handler) {
+    static InputQueue::EventList events;
+    if (input_queue_.empty())
+        return;
+    input_queue_.TakeEvents(&events);
+
+    InputRouter& router = handler->input_router();
+    for (const auto &event : events)
+        router.Dispatch(event);
+}
+
+static void focus_callback(GLFWwindow* window, int focused) {
+    if (SimpleHandler::GetInstance())
+        SimpleHandler::GetInstance()->input_router().OnWindowFocusChanged(focused == GLFW_TRUE);
+}
+
+static void iconify_callback(GLFWwindow* window, int iconified) {
+    if (SimpleHandler::GetInstance())
+        SimpleHandler::GetInstance()->SetWindowOccluded(iconified == GLFW_TRUE);
 }
 
 static void reshape_callback(GLFWwindow* window, int w, int h) {
-    glViewport(0, 0, (GLsizei)w, (GLsizei)h);
+    if (input_recorder_)
+        input_recorder_->RecordFramebufferSize(w, h);
+
+    if (render_thread_)
+        render_thread_->Resize(w, h);
+    else
+        glViewport(0, 0, (GLsizei)w, (GLsizei)h);
 
+    // Lays the views out again and notifies the browsers that changed size.
     SimpleHandler::GetInstance()->resize(w, h);
-    foreachBrowser([&](CefBrowserHost* browser){
-        browser->WasResized();
-    });
 }
 
-static GLFWwindow* initGLFW(int w, int h) {
+// Loads --replay-input and replaces live input with it. Returns false if the
+// session cannot be read.
+static bool initInputReplay(GLFWwindow* window) {
+    const std::string path = CefCommandLine::GetGlobalCommandLine()->GetSwitchValue("replay-input");
+    if (path.empty())
+        return true;
+
+    input_replayer_ = new InputReplayer;
+    if (!input_replayer_->Load(path)) {
+        LOG(ERROR) << "Failed to load input log " << path;
+        return false;
+    }
+    LOG(INFO) << "Replaying " << input_replayer_->event_count() << " input events from " << path;
+
+    glfwSetKeyCallback(window, nullptr);
+    glfwSetCursorPosCallback(window, nullptr);
+    glfwSetMouseButtonCallback(window, nullptr);
+    glfwSetScrollCallback(window, nullptr);
+    // Replayed resizes go through the window, so the real framebuffer size
+    // callback stays installed.
+    return true;
+}
+
+// Starts recording or replaying input once the first browser exists, so that
+// both begin at the same point of the session.
+static void startInputLog(GLFWwindow* window, SimpleHandler* handler) {
+    CefRefPtr<CefCommandLine> command_line = CefCommandLine::GetGlobalCommandLine();
+    if (input_replayer_) {
+        double speed = 1.0;
+        if (command_line->HasSwitch("replay-speed"))
+            speed = atof(command_line->GetSwitchValue("replay-speed").ToString().c_str());
+        if (speed <= 0)
+            speed = 1.0;
+
+        FrameMetrics& metrics = handler->frame_metrics();
+        for (int i = 0; i < FrameMetrics::METRIC_COUNT; ++i)
+            replay_totals_[i] = metrics.Total(static_cast<FrameMetrics::Metric>(i));
+        replay_frames_ = metrics.frame_count();
+        replay_start_time_ = glfwGetTime();
+        input_replayer_->Start(speed);
+        return;
+    }
+
+    const std::string path = command_line->GetSwitchValue("record-input");
+    if (path.empty())
+        return;
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    input_recorder_ = new InputRecorder;
+    if (!input_recorder_->Open(path, width, height)) {
+        LOG(ERROR) << "Failed to create input log " << path;
+        delete input_recorder_;
+        input_recorder_ = nullptr;
+        return;
+    }
+    LOG(INFO) << "Recording input to " << path;
+}
+
+// Logs what the replayed session cost and writes it to --replay-report as
+// JSON. The frame time percentiles cover the frames since the replay started,
+// or the last FrameMetrics::kCapacity of them in a long session.
+static void reportReplay(SimpleHandler* handler) {
+    FrameMetrics& metrics = handler->frame_metrics();
+    const double duration = glfwGetTime() - replay_start_time_;
+    const int64_t frames = metrics.frame_count() - replay_frames_;
+    const double paints = metrics.Total(FrameMetrics::PAINT_COUNT) - replay_totals_[FrameMetrics::PAINT_COUNT];
+    const double upload_bytes = metrics.Total(FrameMetrics::UPLOAD_BYTES) - replay_totals_[FrameMetrics::UPLOAD_BYTES];
+    const double upload_ms = metrics.Total(FrameMetrics::UPLOAD_MS) - replay_totals_[FrameMetrics::UPLOAD_MS];
+    const double missed = metrics.Total(FrameMetrics::DEADLINE_MISSED) - replay_totals_[FrameMetrics::DEADLINE_MISSED];
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "{\"render_thread\": %s, \"events\": %d, \"duration_s\": %.3f, \"frames\": %lld, "
+             "\"frame_ms_p50\": %.2f, \"frame_ms_p95\": %.2f, \"frame_ms_p99\": %.2f, "
+             "\"paints\": %.0f, \"upload_bytes\": %.0f, \"upload_ms\": %.2f, "
+             "\"missed_deadlines\": %.0f",
+             render_thread_ ? "true" : "false",
+             static_cast<int>(input_replayer_->event_count()), duration,
+             static_cast<long long>(frames),
+             metrics.Percentile(FrameMetrics::FRAME_MS, 50, replay_frames_),
+             metrics.Percentile(FrameMetrics::FRAME_MS, 95, replay_frames_),
+             metrics.Percentile(FrameMetrics::FRAME_MS, 99, replay_frames_),
+             paints, upload_bytes, upload_ms, missed);
+    std::string report = buffer;
+    // Input to paint and input to present p50/p95/p99 per event type, as
+    // logged by the latency tracer.
+    if (handler->settings().log_input_latency)
+        report += ", \"input_latency_ms\": \"" + handler->latency_tracer().Summary() + "\"";
+    report += "}";
+    LOG(INFO) << "Replay report: " << report;
+
+    const std::string path = CefCommandLine::GetGlobalCommandLine()->GetSwitchValue("replay-report");
+    if (path.empty())
+        return;
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        LOG(ERROR) << "Failed to write replay report to " << path;
+        return;
+    }
+    fprintf(file, "%s\n", report.c_str());
+    fclose(file);
+}
+
+// Resizes the window so that its framebuffer becomes |width| x |height|
+// pixels. reshape_callback() then lays the views out for the size the window
+// actually got, which the window system may have limited.
+static void replayFramebufferSize(GLFWwindow* window, int width, int height) {
+    int window_width = 0, window_height = 0;
+    int framebuffer_width = 0, framebuffer_height = 0;
+    glfwGetWindowSize(window, &window_width, &window_height);
+    glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+    if (framebuffer_width <= 0 || framebuffer_height <= 0)
+        return;
+
+    // Window sizes are in screen coordinates, which differ from pixels on
+    // high-DPI displays.
+    const double scale_x = static_cast<double>(window_width) / framebuffer_width;
+    const double scale_y = static_cast<double>(window_height) / framebuffer_height;
+    glfwSetWindowSize(window,
+                      std::max(1, static_cast<int>(width * scale_x + 0.5)),
+                      std::max(1, static_cast<int>(height * scale_y + 0.5)));
+}
+
+// Injects the recorded events that are due through the input callbacks and
+// closes the window when the session is over.
+static void replayInput(GLFWwindow* window, SimpleHandler* handler) {
+    static std::vector<InputLogEvent> events;
+    input_replayer_->TakeDueEvents(&events);
+    for (const auto &event : events) {
+        switch (event.type) {
+            case InputLogEvent::KEY:
+                key_callback(window, event.args[0], event.args[1], event.args[2], event.args[3]);
+                break;
+            case InputLogEvent::MOUSE_BUTTON:
+                mouse_callback(window, event.args[0], event.args[1], event.args[2]);
+                break;
+            case InputLogEvent::SCROLL:
+                scroll_callback(window, event.x, event.y);
+                break;
+            case InputLogEvent::CURSOR_POS:
+                motion_callback(window, event.x, event.y);
+                break;
+            case InputLogEvent::FRAMEBUFFER_SIZE:
+                replayFramebufferSize(window, event.args[0], event.args[1]);
+                break;
+            case InputLogEvent::END:
+                reportReplay(handler);
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+                break;
+        }
+    }
+}
+
+// While the HUD is shown the window title carries the frame time percentiles.
+static void updateHudTitle(GLFWwindow* window, SimpleHandler* handler) {
+    static double last_update = 0;
+    static bool title_set = false;
+    if (!handler->hud_visible()) {
+        if (title_set) {
+            glfwSetWindowTitle(window, kWindowTitle);
+            title_set = false;
+        }
+        return;
+    }
+
+    const double now = glfwGetTime();
+    if (title_set && now - last_update < kHudTitleInterval)
+        return;
+    last_update = now;
+    title_set = true;
+    glfwSetWindowTitle(window, handler->frame_metrics().Summary().c_str());
+}
+
+// Refresh rate of the primary monitor, or 0 if unknown.
+static int getRefreshRate() {
+    GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+    const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+    return mode ? mode->refreshRate : 0;
+}
+
+// Waits no longer than the next external BeginFrame, deferred resize or
+// scheduled CEF work is due.
+static double eventWaitTimeout(SimpleHandler* handler) {
+    double timeout = message_pump_ ? message_pump_->TimeUntilWorkUs() / 1000000.0
+                                   : kEventWaitTimeout;
+    // CEF work held back for the next frame can wait until its render start.
+    const int64_t deferred_us = deadline_scheduler_.TimeUntilDeferredWorkUs();
+    if (deferred_us >= 0)
+        timeout = std::max(timeout, deferred_us / 1000000.0);
+    if (handler) {
+        const int64_t begin_frame_us = handler->begin_frame_scheduler().TimeUntilNextBeginFrameUs();
+        if (begin_frame_us >= 0)
+            timeout = std::min(timeout, begin_frame_us / 1000000.0);
+        const int64_t resize_us = handler->TimeUntilResizeFlushUs();
+        if (resize_us >= 0)
+            timeout = std::min(timeout, resize_us / 1000000.0);
+    }
+    if (input_replayer_) {
+        const int64_t replay_us = input_replayer_->TimeUntilNextEventUs();
+        if (replay_us >= 0)
+            timeout = std::min(timeout, replay_us / 1000000.0);
+    }
+    // glfwWaitEventsTimeout rejects a zero timeout.
+    return std::max(kMinEventWaitTimeout, timeout);
+}
+
+// Interrupts glfwWaitEventsTimeout when CEF schedules work. Called on any thread.
+static void wakeMainLoop() {
+    glfwPostEmptyEvent();
+}
+
+// Runs CEF work, or with --external-message-pump only the work that is due.
+static void doMessageLoopWork(SimpleHandler* handler) {
+    if (message_pump_ && message_pump_->TimeUntilWorkUs() > 0)
+        return;
+
+    std::unique_ptr<FrameMetrics::ScopedTimer> timer;
+    if (handler)
+        timer.reset(new FrameMetrics::ScopedTimer(&handler->frame_metrics(), FrameMetrics::MESSAGE_LOOP_MS));
+    if (message_pump_)
+        message_pump_->DoWorkIfDue();
+    else
+        CefDoMessageLoopWork();
+}
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs CEF work in slices while they fit before the next frame has to be
+// rendered. The rest runs after the present.
+static void runMessageLoopSlices(SimpleHandler* handler) {
+    DamageTracker& damage = handler->damage_tracker();
+    while (deadline_scheduler_.ShouldRunSlice()) {
+        const int64_t start_us = nowUs();
+        doMessageLoopWork(handler);
+        if (!deadline_scheduler_.OnSliceDone(nowUs() - start_us))
+            break;
+        /* Draw new content before doing more work */
+        if (damage.IsDirty())
+            break;
+    }
+}
+
+// Checks argv for "--<name>" before CEF has parsed the command line.
+static bool hasSwitch(int argc, char* argv[], const char* name) {
+    const std::string flag = std::string("--") + name;
+    for (int i = 1; i < argc; ++i) {
+        if (flag == argv[i])
+            return true;
+    }
+    return false;
+}
+
+static GLFWwindow* initGLFW(int w, int h, bool core_profile) {
     glfwSetErrorCallback(error_callback);
 
     /* Initialize the library */
     if (!glfwInit())
         return nullptr;
 
+    if (core_profile) {
+        /* The core profile renderer needs OpenGL 3.2 */
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    }
+
     /* Create a windowed mode window and its OpenGL context */
-    GLFWwindow* window = glfwCreateWindow(w, h, "Hello World", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(w, h, kWindowTitle, NULL, NULL);
     if (!window)
     {
         glfwTerminate();
@@ -117,6 +498,8 @@ static GLFWwindow* initGLFW(int w, int h) {
     glfwSetMouseButtonCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetFramebufferSizeCallback(window, reshape_callback);
+    glfwSetWindowFocusCallback(window, focus_callback);
+    glfwSetWindowIconifyCallback(window, iconify_callback);
 
     /* Make the window's context current */
     glfwMakeContextCurrent(window);
@@ -138,6 +521,11 @@ static int initCEF3(int argc, char* argv[]) {
     CefSettings settings;
     settings.windowless_rendering_enabled = true;
 
+    // CEF asks for work through SimpleApp::OnScheduleMessagePumpWork instead
+    // of being polled.
+    if (message_pump_)
+        settings.external_message_pump = true;
+
     // When generating projects with CMake the CEF_USE_SANDBOX value will be defined
     // automatically. Pass -DUSE_SANDBOX=OFF to the CMake command-line to disable
     // use of the sandbox.
@@ -148,7 +536,7 @@ static int initCEF3(int argc, char* argv[]) {
     // SimpleApp implements application-level callbacks for the browser process.
     // It will create the first browser instance in OnContextInitialized() after
     // CEF has initialized.
-    CefRefPtr<SimpleApp> app(new SimpleApp);
+    CefRefPtr<SimpleApp> app(new SimpleApp(message_pump_));
 
     // Initialize CEF for the browser process.
     CefInitialize(main_args, settings, app.get(), NULL);
@@ -159,32 +547,191 @@ static int initCEF3(int argc, char* argv[]) {
     return 0;
 }
 
+// Runs without GLFW or GL. Frames are written to --output by the handler and
+// the CEF message loop runs until every browser has closed.
+static int runHeadless(int argc, char* argv[]) {
+    auto ret = initCEF3(argc, argv);
+    if (ret != 0) return -2;
+
+    CefRunMessageLoop();
+
+    if (SimpleHandler::GetInstance()) {
+        LOG(INFO) << "Frame metrics p50/p95/p99 (ms): "
+                  << SimpleHandler::GetInstance()->frame_metrics().Summary();
+        if (CefCommandLine::GetGlobalCommandLine()->HasSwitch("frame-metrics-file"))
+            dumpFrameMetrics();
+    }
+
+    CefShutdown();
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
+    if (hasSwitch(argc, argv, "headless"))
+        return runHeadless(argc, argv);
+
     // init GLFW
-    GLFWwindow* window = initGLFW(1024, 768);
+    GLFWwindow* window = initGLFW(1024, 768, hasSwitch(argc, argv, "core-profile"));
     if (!window) return -1;
 
+    // Needs GLFW to wake the main loop.
+    if (hasSwitch(argc, argv, "external-message-pump"))
+        message_pump_ = new ExternalMessagePump(wakeMainLoop);
+
     // init CEF3
     auto ret = initCEF3(argc, argv);
     if (ret != 0) return -2;
 
+    if (!initInputReplay(window)) {
+        CefShutdown();
+        return -3;
+    }
+
+    const bool use_render_thread =
+            CefCommandLine::GetGlobalCommandLine()->HasSwitch("render-thread");
+    bool handler_ready = false;
+
     /* Loop until the user closes the window */
     while (!glfwWindowShouldClose(window)) {
-        SimpleHandler::GetInstance()->Render();
+        SimpleHandler* handler = SimpleHandler::GetInstance();
+        if (handler && !handler_ready) {
+            handler_ready = true;
+            const int refresh_rate = getRefreshRate();
+            handler->SetDisplayRefreshRate(refresh_rate);
+            if (refresh_rate > 0)
+                deadline_scheduler_.SetPresentInterval(1000.0 / refresh_rate);
+
+            // Hand the GL context to the render thread once the handler exists.
+            if (use_render_thread) {
+                render_thread_ = new RenderThread(window, handler);
+                render_thread_->Start();
+            }
+
+            startInputLog(window, handler);
+        }
+
+        if (!handler || use_render_thread) {
+            /* Only pump events and CEF; presenting happens on the render thread */
+            glfwWaitEventsTimeout(eventWaitTimeout(handler));
+
+            if (handler) {
+                updateHudTitle(window, handler);
+                if (input_replayer_)
+                    replayInput(window, handler);
+                handler->FlushResizes();
+                handler->SendBeginFrames();
+                dispatchInput(handler);
+            }
+            doMessageLoopWork(handler);
+            continue;
+        }
+
+        FrameMetrics& metrics = handler->frame_metrics();
+        DamageTracker& damage = handler->damage_tracker();
+        const int64_t damage_us = damage.dirty_since_us();
+        if (damage.ConsumeDamage()) {
+            const int64_t render_start_us = nowUs();
+            {
+                FrameMetrics::ScopedTimer timer(&metrics, FrameMetrics::RENDER_MS);
+                handler->Render();
+            }
+
+            /* Swap front and back buffers */
+            const int64_t swap_start_us = nowUs();
+            {
+                FrameMetrics::ScopedTimer timer(&metrics, FrameMetrics::SWAP_MS);
+                glfwSwapBuffers(window);
+            }
+            damage.OnFramePresented();
+            if (handler->settings().log_input_latency)
+                handler->latency_tracer().OnFramePresented();
+            const int64_t present_us = damage.last_present_us();
+            const bool missed = deadline_scheduler_.OnFramePresented(
+                    present_us, swap_start_us - render_start_us, present_us - swap_start_us, damage_us);
+            metrics.RecordDeadline(deadline_scheduler_.budget_used_percent(), missed);
+            metrics.EndFrame();
+
+            /* Poll for and process events */
+            glfwPollEvents();
+        } else {
+            /* Nothing changed; wait briefly for input instead of redrawing */
+            damage.OnFrameSkipped();
+            metrics.OnFrameSkipped();
+            glfwWaitEventsTimeout(eventWaitTimeout(handler));
+        }
+
+        updateHudTitle(window, handler);
+
+        /* Resizes and BeginFrames follow the present so the next paint lands before the next swap */
+        if (input_replayer_)
+            replayInput(window, handler);
+        handler->FlushResizes();
+        handler->SendBeginFrames();
+        dispatchInput(handler);
+        runMessageLoopSlices(handler);
+    }
 
-        /* Swap front and back buffers */
-        glfwSwapBuffers(window);
+    if (input_recorder_) {
+        input_recorder_->Close();
+        LOG(INFO) << "Recorded " << input_recorder_->records() << " input events in "
+                  << input_recorder_->bytes() << " bytes";
+        delete input_recorder_;
+        input_recorder_ = nullptr;
+    }
+    delete input_replayer_;
+    input_replayer_ = nullptr;
 
-        /* Poll for and process events */
-        glfwPollEvents();
+    if (render_thread_) {
+        render_thread_->Stop();
+        delete render_thread_;
+        render_thread_ = nullptr;
+    }
 
-        CefDoMessageLoopWork();
+    // Release GL resources while the context is still current.
+    if (SimpleHandler::GetInstance()) {
+        DamageTracker& damage = SimpleHandler::GetInstance()->damage_tracker();
+        LOG(INFO) << "Presented " << damage.presented_frames()
+                  << " frames, skipped " << damage.skipped_frames();
+        SimpleHandler::GetInstance()->LogResizeStats();
+        LOG(INFO) << "Input: " << input_queue_.received_events() << " events received, "
+                  << input_queue_.sent_events() << " events sent, "
+                  << SimpleHandler::GetInstance()->input_router().routed_events()
+                  << " browser calls";
+        if (SimpleHandler::GetInstance()->settings().log_input_latency) {
+            LOG(INFO) << "Input latency p50/p95/p99 (ms): "
+                      << SimpleHandler::GetInstance()->latency_tracer().Summary();
+        }
+        LOG(INFO) << "Time to first paint count mean/max (ms): "
+                  << SimpleHandler::GetInstance()->browser_pool().Summary();
+        if (SimpleHandler::GetInstance()->settings().paint_budget_ms > 0) {
+            LOG(INFO) << "Paint governor: "
+                      << SimpleHandler::GetInstance()->paint_governor().Summary();
+        }
+        if (!use_render_thread) {
+            LOG(INFO) << "Frame deadlines: " << deadline_scheduler_.missed_deadlines()
+                      << " missed, " << deadline_scheduler_.deferred_slices()
+                      << " deferred message loop slices";
+        }
+        LOG(INFO) << "Frame metrics p50/p95/p99 (ms): "
+                  << SimpleHandler::GetInstance()->frame_metrics().Summary();
+        if (CefCommandLine::GetGlobalCommandLine()->HasSwitch("frame-metrics-file"))
+            dumpFrameMetrics();
+
+        SimpleHandler::GetInstance()->Cleanup();
+    }
+
+    if (message_pump_) {
+        LOG(INFO) << "Message pump: " << message_pump_->work_requests()
+                  << " work requests, " << message_pump_->work_runs() << " work runs";
     }
 
     // Shut down CEF.
     CefShutdown();
 
+    delete message_pump_;
+    message_pump_ = nullptr;
+
     glfwDestroyWindow(window);
     glfwTerminate();
 
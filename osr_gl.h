@@ -0,0 +1,39 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_OSR_GL_H_
+#define CEF_TESTS_CEFSIMPLE_OSR_GL_H_
+#pragma once
+
+// Buffer and sync object entry points are declared in glext.h.
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#ifndef GLFW_INCLUDE_GLEXT
+#define GLFW_INCLUDE_GLEXT
+#endif
+#include <GLFW/glfw3.h>
+
+#include "include/base/cef_build.h"
+#include "include/base/cef_logging.h"
+
+#if defined(OS_MACOSX)
+// Core profile entry points (vertex arrays, shaders, sync objects) are only
+// declared in gl3.h on macOS.
+#define GL_DO_NOT_WARN_IF_MULTI_GL_VERSION_HEADERS_INCLUDED
+#include <OpenGL/gl3.h>
+#endif
+
+// DCHECK on gl errors.
+#if DCHECK_IS_ON()
+#define VERIFY_NO_ERROR                                                      \
+  {                                                                          \
+    int _gl_error = glGetError();                                            \
+    DCHECK(_gl_error == GL_NO_ERROR) << "glGetError returned " << _gl_error; \
+  }
+#else
+#define VERIFY_NO_ERROR
+#endif
+
+#endif  // CEF_TESTS_CEFSIMPLE_OSR_GL_H_
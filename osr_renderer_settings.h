@@ -16,7 +16,23 @@ struct OsrRendererSettings {
         background_color(CefColorSetARGB(255, 255, 255, 255)),
         shared_texture_enabled(false),
         external_begin_frame_enabled(false),
-        begin_frame_rate(0) {}
+        begin_frame_rate(0),
+        pbo_upload_enabled(false),
+        pbo_count(3),
+        log_upload_time(false),
+        coalesce_dirty_rects(false),
+        upload_call_cost_pixels(64 * 64),
+        tile_damage_enabled(false),
+        damage_tile_size(64),
+        frame_mailbox_enabled(false),
+        render_thread_enabled(false),
+        log_input_latency(false),
+        core_profile_enabled(false),
+        headless_enabled(false),
+        windowless_frame_rate(0),
+        render_scale(1.0),
+        browser_pool_size(0),
+        paint_budget_ms(0) {}
 
   // If true draw a border around update rectangles.
   bool show_update_rect;
@@ -28,9 +44,69 @@ struct OsrRendererSettings {
   bool shared_texture_enabled;
 
   // Client implements a BeginFrame timer by calling
-  // CefBrowserHost::SendExternalBeginFrame at the specified frame rate.
+  // CefBrowserHost::SendExternalBeginFrame at the specified frame rate. A
+  // |begin_frame_rate| of 0 follows the display refresh rate.
   bool external_begin_frame_enabled;
   int begin_frame_rate;
+
+  // Upload OnPaint pixels through a ring of pixel-unpack buffers so that the
+  // texture update completes asynchronously instead of blocking OnPaint.
+  bool pbo_upload_enabled;
+
+  // Number of pixel-unpack buffers in the ring (2 or 3).
+  int pbo_count;
+
+  // If true periodically log the time spent uploading OnPaint pixels.
+  bool log_upload_time;
+
+  // Merge the OnPaint dirty rectangles before uploading them. Two rectangles
+  // are merged when the extra pixels cost less than |upload_call_cost_pixels|,
+  // the fixed per-call overhead expressed in pixels.
+  bool coalesce_dirty_rects;
+  int upload_call_cost_pixels;
+
+  // Hash the tiles touched by the OnPaint damage and drop the ones whose
+  // pixels did not change. |damage_tile_size| is the tile edge in pixels.
+  bool tile_damage_enabled;
+  int damage_tile_size;
+
+  // Copy OnPaint frames into a lock-free triple buffer and upload the latest
+  // complete frame from Render() instead of calling GL from OnPaint.
+  bool frame_mailbox_enabled;
+
+  // Render and swap on a dedicated thread that owns the GL context. Implies
+  // |frame_mailbox_enabled|.
+  bool render_thread_enabled;
+
+  // If true measure the time from each input event to the paint and the
+  // present that reflect it, and periodically log p50/p95/p99 per event type.
+  bool log_input_latency;
+
+  // Render with a VAO and shader program in an OpenGL 3.2 core profile
+  // context instead of the fixed-function pipeline.
+  bool core_profile_enabled;
+
+  // Run without a window or GL context and write OnPaint frames to a file or
+  // pipe instead of drawing them.
+  bool headless_enabled;
+
+  // Frame rate passed to CefBrowserHost::SetWindowlessFrameRate when
+  // |external_begin_frame_enabled| is false. 0 keeps the CEF default.
+  int windowless_frame_rate;
+
+  // Fraction of the view resolution that is painted and uploaded, reported
+  // to CEF as the device scale factor. The texture is upscaled with linear
+  // filtering when drawn. Can be changed at runtime.
+  double render_scale;
+
+  // Number of hidden browsers kept loaded at about:blank so that opening a
+  // view skips browser creation. 0 disables the pool.
+  int browser_pool_size;
+
+  // OnPaint work in milliseconds per second that the paint governor keeps
+  // the browsers within by throttling the ones without focus. 0 disables
+  // the governor.
+  int paint_budget_ms;
 };
 
 }  // namespace client
@@ -0,0 +1,104 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_OSR_VIEW_H_
+#define CEF_TESTS_CEFSIMPLE_OSR_VIEW_H_
+#pragma once
+
+#include "include/base/cef_macros.h"
+#include "include/internal/cef_types_wrappers.h"
+#include "frame_mailbox.h"
+#include "tile_damage_filter.h"
+
+// Render state of one windowless browser.
+struct OsrView {
+  OsrView()
+      : texture_id(0),
+        view_width(0),
+        view_height(0),
+        texture_width(0),
+        texture_height(0),
+        texture_coords_changed(false),
+        texture_filter(0),
+        popup_texture_id(0),
+        popup_width(0),
+        popup_height(0),
+        popup_texture_filter(0) {}
+
+  // True if the popup is shown and its texture holds a paint of the current
+  // popup size.
+  bool HasPopup() const {
+    return !popup_rect.IsEmpty() && popup_width > 0 &&
+           popup_paint_size.width == popup_rect.width &&
+           popup_paint_size.height == popup_rect.height;
+  }
+
+  // Texture holding the view contents. Created on the GL thread on first use.
+  unsigned int texture_id;
+
+  // Size of the texture contents. Zero until the first paint is uploaded.
+  int view_width;
+  int view_height;
+
+  // Allocated texture size. Grows in size classes and never shrinks, so the
+  // contents usually cover only the top-left part of the texture.
+  int texture_width;
+  int texture_height;
+
+  // Texture coordinates of the bottom-right corner of the contents.
+  float max_u() const { return MaxTexCoord(view_width, texture_width); }
+  float max_v() const { return MaxTexCoord(view_height, texture_height); }
+
+  // True if max_u() or max_v() changed since the quads were last built.
+  bool texture_coords_changed;
+
+  // Filter the texture was last sampled with. Linear when the texture is
+  // smaller than |layout_rect| because of the render scale.
+  int texture_filter;
+
+  // Where the view is drawn, in window pixels with a top-left origin.
+  CefRect layout_rect;
+
+  CefRect update_rect;
+
+  // Popup widget, such as an open <select>, drawn over the view from its own
+  // texture so that showing, moving and hiding it never touches the view
+  // texture. |popup_rect| is in view pixels and empty while the popup is
+  // hidden. |original_popup_rect| is the rectangle requested by the browser.
+  // |popup_width| and |popup_height| are in texture pixels, which differ from
+  // view pixels when a render scale is set. |popup_paint_size| is the size
+  // of |popup_rect| when the popup was last painted.
+  unsigned int popup_texture_id;
+  int popup_width;
+  int popup_height;
+  int popup_texture_filter;
+  CefRect popup_rect;
+  CefRect original_popup_rect;
+  CefSize popup_paint_size;
+
+  // Used when settings.frame_mailbox_enabled is true. Written by OnPaint and
+  // consumed by Render().
+  FrameMailbox frame_mailbox;
+  FrameMailbox popup_mailbox;
+
+  // Used when settings.tile_damage_enabled is true. Only accessed by OnPaint.
+  TileDamageFilter damage_filter;
+
+  // Last OnPaint size, used to count resize paints.
+  CefSize paint_size;
+
+ private:
+  // Stop half a texel short of the unused part of the texture so that
+  // linear filtering never blends it in. Nearest sampling still hits the
+  // same texels as with the full extent.
+  static float MaxTexCoord(int content, int storage) {
+    if (content <= 0 || content >= storage)
+      return 1.0f;
+    return (content - 0.5f) / storage;
+  }
+
+  DISALLOW_COPY_AND_ASSIGN(OsrView);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_OSR_VIEW_H_
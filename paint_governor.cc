@@ -0,0 +1,180 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "paint_governor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+// Weight of the newest sample in the paint cost average.
+const double kCostWeight = 0.3;
+
+// Bounds of the budget headroom, and the step it grows by per evaluation
+// while the measured work stays under budget.
+const double kMinHeadroom = 0.25;
+const double kMaxHeadroom = 2.0;
+const double kHeadroomGrowth = 1.1;
+
+// CEF clamps windowless frame rates to 1-60.
+const int kMaxWindowlessFrameRate = 60;
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+PaintGovernor::ScopedPaint::ScopedPaint(PaintGovernor* governor,
+                                        int browser_id)
+    : governor_(governor), browser_id_(browser_id), start_us_(NowUs()) {}
+
+PaintGovernor::ScopedPaint::~ScopedPaint() {
+  governor_->OnPaint(browser_id_, NowUs() - start_us_);
+}
+
+PaintGovernor::PaintGovernor()
+    : budget_ms_(0),
+      max_frame_rate_(kMaxWindowlessFrameRate),
+      headroom_(1.0),
+      window_start_us_(0),
+      measured_ms_(0),
+      over_budget_evaluations_(0),
+      evaluations_(0) {}
+
+void PaintGovernor::set_max_frame_rate(int frame_rate) {
+  max_frame_rate_ =
+      std::max(kMinFrameRate, std::min(frame_rate, kMaxWindowlessFrameRate));
+}
+
+void PaintGovernor::AddBrowser(int browser_id) {
+  browsers_[browser_id] = BrowserState();
+}
+
+void PaintGovernor::RemoveBrowser(int browser_id) {
+  browsers_.erase(browser_id);
+}
+
+void PaintGovernor::SetPriority(int browser_id, Priority priority) {
+  BrowserMap::iterator it = browsers_.find(browser_id);
+  if (it != browsers_.end())
+    it->second.priority = priority;
+}
+
+void PaintGovernor::OnPaint(int browser_id, int64_t cost_us) {
+  BrowserMap::iterator it = browsers_.find(browser_id);
+  if (it == browsers_.end())
+    return;
+  it->second.paint_us += cost_us;
+  it->second.paints++;
+}
+
+void PaintGovernor::Evaluate(int64_t now_us, DecisionList* changes) {
+  DCHECK(changes);
+
+  // The first call only starts the measurement window.
+  const int64_t window_us = now_us - window_start_us_;
+  const bool measured = window_start_us_ > 0 && window_us > 0;
+  window_start_us_ = now_us;
+
+  int64_t total_paint_us = 0;
+  for (BrowserMap::iterator it = browsers_.begin(); it != browsers_.end();
+       ++it) {
+    BrowserState& state = it->second;
+    total_paint_us += state.paint_us;
+    if (state.paints > 0) {
+      const double cost_ms = state.paint_us / 1000.0 / state.paints;
+      state.cost_ms =
+          state.cost_ms == 0
+              ? cost_ms
+              : state.cost_ms + kCostWeight * (cost_ms - state.cost_ms);
+    }
+    state.paint_us = 0;
+    state.paints = 0;
+  }
+
+  if (measured) {
+    evaluations_++;
+    measured_ms_ = total_paint_us / 1000.0 * 1000000.0 / window_us;
+    if (measured_ms_ > budget_ms_) {
+      over_budget_evaluations_++;
+      headroom_ *= budget_ms_ / measured_ms_;
+    } else {
+      headroom_ *= kHeadroomGrowth;
+    }
+    headroom_ = std::max(kMinHeadroom, std::min(headroom_, kMaxHeadroom));
+  }
+
+  // Count the browsers of each priority so that each level can split what
+  // the levels above it left over.
+  int counts[PRIORITY_COUNT] = {0};
+  for (BrowserMap::const_iterator it = browsers_.begin();
+       it != browsers_.end(); ++it) {
+    counts[it->second.priority]++;
+  }
+
+  double remaining_ms = budget_ms_ * headroom_;
+  for (int priority = PRIORITY_FOCUSED; priority < PRIORITY_COUNT;
+       ++priority) {
+    if (counts[priority] == 0)
+      continue;
+    const int max_rate =
+        priority == PRIORITY_BACKGROUND
+            ? std::min(max_frame_rate_, kBackgroundMaxFrameRate)
+            : max_frame_rate_;
+    const double share_ms = std::max(0.0, remaining_ms) / counts[priority];
+
+    for (BrowserMap::iterator it = browsers_.begin(); it != browsers_.end();
+         ++it) {
+      BrowserState& state = it->second;
+      if (state.priority != priority)
+        continue;
+
+      int frame_rate = max_rate;
+      const bool hidden = priority == PRIORITY_OCCLUDED;
+      if (hidden) {
+        frame_rate = kMinFrameRate;
+      } else if (priority != PRIORITY_FOCUSED && state.cost_ms > 0) {
+        frame_rate = std::max(
+            kMinFrameRate,
+            std::min(max_rate, static_cast<int>(share_ms / state.cost_ms)));
+      }
+      if (!hidden)
+        remaining_ms -= frame_rate * state.cost_ms;
+
+      if (frame_rate == state.frame_rate && hidden == state.hidden)
+        continue;
+      Decision decision;
+      decision.browser_id = it->first;
+      decision.frame_rate = frame_rate;
+      decision.hidden = hidden;
+      decision.hidden_changed = hidden != state.hidden;
+      changes->push_back(decision);
+      state.frame_rate = frame_rate;
+      state.hidden = hidden;
+    }
+  }
+}
+
+std::string PaintGovernor::Summary() const {
+  int throttled = 0;
+  for (BrowserMap::const_iterator it = browsers_.begin();
+       it != browsers_.end(); ++it) {
+    if (it->second.hidden || it->second.frame_rate < max_frame_rate_)
+      throttled++;
+  }
+
+  std::ostringstream ss;
+  ss << "budget " << budget_ms_ << " ms/s, measured " << measured_ms_
+     << " ms/s, over budget " << over_budget_evaluations_ << " of "
+     << evaluations_ << " evaluations, throttled " << throttled << " of "
+     << browsers_.size() << " browsers";
+  return ss.str();
+}
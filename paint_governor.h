@@ -0,0 +1,139 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_PAINT_GOVERNOR_H_
+#define CEF_TESTS_CEFSIMPLE_PAINT_GOVERNOR_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+
+// Keeps the OnPaint work of all browsers within a global budget of
+// milliseconds per second. Each browser has a priority. The focused browser
+// always runs at the full frame rate. Visible and then background browsers
+// share what is left of the budget, in proportion to the measured cost of
+// their paints, and occluded browsers are hidden.
+//
+// The cost estimate is fed back from the measured OnPaint time. When the
+// measured total exceeds the budget the budget handed out shrinks by the
+// overshoot. While browsers paint less than their allotted rate it grows
+// again, so that idle browsers don't hold on to unused budget.
+//
+// The governor only decides; the caller applies the frame rates with
+// SetWindowlessFrameRate or the BeginFrame scheduler and the visibility with
+// WasHidden. All methods must be called on the CEF UI thread.
+class PaintGovernor {
+ public:
+  enum Priority {
+    PRIORITY_FOCUSED,
+    PRIORITY_VISIBLE,
+    PRIORITY_BACKGROUND,
+    PRIORITY_OCCLUDED,
+    PRIORITY_COUNT,
+  };
+
+  // Interval at which Evaluate() is expected to be called.
+  static const int64_t kEvaluateIntervalUs = 500000;
+  // Lowest frame rate given to a browser that is not hidden.
+  static const int kMinFrameRate = 1;
+  // Highest frame rate of a background browser.
+  static const int kBackgroundMaxFrameRate = 10;
+
+  // Adds the lifetime of the object to the paint cost of |browser_id|.
+  class ScopedPaint {
+   public:
+    ScopedPaint(PaintGovernor* governor, int browser_id);
+    ~ScopedPaint();
+
+   private:
+    PaintGovernor* governor_;
+    const int browser_id_;
+    const int64_t start_us_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedPaint);
+  };
+
+  // A browser whose frame rate or visibility changed.
+  struct Decision {
+    int browser_id;
+    int frame_rate;
+    bool hidden;
+    bool hidden_changed;
+  };
+  typedef std::vector<Decision> DecisionList;
+
+  PaintGovernor();
+
+  // Paint budget in milliseconds per second of wall time.
+  void set_budget_ms(double budget_ms) { budget_ms_ = budget_ms; }
+  double budget_ms() const { return budget_ms_; }
+
+  // Frame rate of an unthrottled browser.
+  void set_max_frame_rate(int frame_rate);
+
+  void AddBrowser(int browser_id);
+  void RemoveBrowser(int browser_id);
+  void SetPriority(int browser_id, Priority priority);
+
+  // One OnPaint of |browser_id| took |cost_us|.
+  void OnPaint(int browser_id, int64_t cost_us);
+
+  // Measure the paint work since the last call, reassign the frame rates and
+  // append the browsers whose frame rate or visibility changed to
+  // |changes|.
+  void Evaluate(int64_t now_us, DecisionList* changes);
+
+  // Paint work measured over the last evaluation interval.
+  double measured_ms() const { return measured_ms_; }
+  // Evaluations whose measured paint work exceeded the budget.
+  int64_t over_budget_evaluations() const { return over_budget_evaluations_; }
+  int64_t evaluations() const { return evaluations_; }
+
+  // "budget B ms/s, measured M ms/s, over budget O of E evaluations,
+  // throttled T of N browsers".
+  std::string Summary() const;
+
+ private:
+  struct BrowserState {
+    BrowserState()
+        : priority(PRIORITY_VISIBLE),
+          paint_us(0),
+          paints(0),
+          cost_ms(0),
+          frame_rate(0),
+          hidden(false) {}
+
+    Priority priority;
+    // Paint work since the last evaluation.
+    int64_t paint_us;
+    int64_t paints;
+    // Moving average of the cost of one paint.
+    double cost_ms;
+    // Last decision, 0 before the first one.
+    int frame_rate;
+    bool hidden;
+  };
+
+  typedef std::map<int, BrowserState> BrowserMap;
+
+  BrowserMap browsers_;
+  double budget_ms_;
+  int max_frame_rate_;
+  // Factor applied to the budget handed out, adjusted from the measured
+  // paint work.
+  double headroom_;
+  int64_t window_start_us_;
+  double measured_ms_;
+  int64_t over_budget_evaluations_;
+  int64_t evaluations_;
+
+  DISALLOW_COPY_AND_ASSIGN(PaintGovernor);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_PAINT_GOVERNOR_H_
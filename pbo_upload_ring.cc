@@ -0,0 +1,130 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "pbo_upload_ring.h"
+
+namespace {
+
+// Sync objects are core in OpenGL 3.2 and an extension before that.
+bool HasSyncObjects() {
+  GLFWwindow* window = glfwGetCurrentContext();
+  DCHECK(window);
+  const int major = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MAJOR);
+  const int minor = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MINOR);
+  return major > 3 || (major == 3 && minor >= 2) ||
+         glfwExtensionSupported("GL_ARB_sync");
+}
+
+}  // namespace
+
+PboUploadRing::PboUploadRing()
+    : count_(0), index_(0), has_sync_(false), orphan_count_(0) {
+  for (int i = 0; i < kMaxBuffers; ++i) {
+    buffer_ids_[i] = 0;
+    fences_[i] = NULL;
+    sizes_[i] = 0;
+  }
+}
+
+PboUploadRing::~PboUploadRing() {
+  DCHECK_EQ(count_, 0) << "Cleanup() must be called with a current context";
+}
+
+void PboUploadRing::Initialize(int count) {
+  DCHECK_EQ(count_, 0);
+  DCHECK_GE(count, 1);
+  if (count > kMaxBuffers)
+    count = kMaxBuffers;
+
+  has_sync_ = HasSyncObjects();
+  if (!has_sync_) {
+    LOG(WARNING) << "No sync objects in this OpenGL context, PBO uploads "
+                    "orphan the buffer storage every frame";
+  }
+
+  glGenBuffers(count, buffer_ids_);
+  VERIFY_NO_ERROR;
+  count_ = count;
+  index_ = 0;
+}
+
+void PboUploadRing::Cleanup() {
+  if (count_ == 0)
+    return;
+
+  for (int i = 0; i < count_; ++i) {
+    if (fences_[i]) {
+      glDeleteSync(fences_[i]);
+      fences_[i] = NULL;
+    }
+    sizes_[i] = 0;
+  }
+  glDeleteBuffers(count_, buffer_ids_);
+  VERIFY_NO_ERROR;
+  count_ = 0;
+}
+
+void* PboUploadRing::Map(size_t size) {
+  DCHECK_GT(count_, 0);
+
+  index_ = (index_ + 1) % count_;
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer_ids_[index_]);
+  VERIFY_NO_ERROR;
+
+  // Only write into the existing storage if the GPU has finished reading it.
+  // Otherwise orphan the storage so the driver hands out a fresh allocation
+  // instead of stalling until the pending transfer completes. Without sync
+  // objects there is no telling, so the storage is always orphaned.
+  bool reuse = has_sync_ && sizes_[index_] == size;
+  if (reuse && fences_[index_]) {
+    GLenum result = glClientWaitSync(fences_[index_], 0, 0);
+    reuse = (result == GL_ALREADY_SIGNALED ||
+             result == GL_CONDITION_SATISFIED);
+  }
+  if (fences_[index_]) {
+    glDeleteSync(fences_[index_]);
+    fences_[index_] = NULL;
+  }
+
+  if (!reuse) {
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    VERIFY_NO_ERROR;
+    sizes_[index_] = size;
+    orphan_count_++;
+  }
+
+  void* ptr = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+  VERIFY_NO_ERROR;
+  if (!ptr) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    VERIFY_NO_ERROR;
+  }
+  return ptr;
+}
+
+bool PboUploadRing::Unmap() {
+  DCHECK_GT(count_, 0);
+  GLboolean result = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  VERIFY_NO_ERROR;
+  if (result != GL_TRUE) {
+    // The data store was corrupted while mapped (e.g. screen mode change).
+    sizes_[index_] = 0;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    VERIFY_NO_ERROR;
+    return false;
+  }
+  return true;
+}
+
+void PboUploadRing::Fence() {
+  DCHECK_GT(count_, 0);
+  DCHECK(!fences_[index_]);
+  if (has_sync_) {
+    fences_[index_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    VERIFY_NO_ERROR;
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  VERIFY_NO_ERROR;
+}
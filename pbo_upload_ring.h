@@ -0,0 +1,68 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_PBO_UPLOAD_RING_H_
+#define CEF_TESTS_CEFSIMPLE_PBO_UPLOAD_RING_H_
+#pragma once
+
+#include <stddef.h>
+
+#include "include/base/cef_macros.h"
+#include "osr_gl.h"
+
+// Ring of pixel-unpack buffers used to upload OnPaint pixels asynchronously.
+// The caller copies pixels into the mapped buffer and then issues
+// glTexImage2D/glTexSubImage2D with offsets into the bound buffer. The driver
+// performs the transfer to the texture without blocking the caller. A fence is
+// inserted after each upload so that a buffer is only re-mapped in place once
+// the GPU is done reading it; otherwise its storage is orphaned. Contexts
+// without sync objects (OpenGL < 3.2 without GL_ARB_sync, e.g. the legacy
+// macOS context) get no fences and orphan the storage on every upload.
+class PboUploadRing {
+ public:
+  static const int kMaxBuffers = 3;
+
+  PboUploadRing();
+  ~PboUploadRing();
+
+  // Create |count| buffers. Must be called with a current GL context.
+  void Initialize(int count);
+  void Cleanup();
+
+  bool IsInitialized() const { return count_ > 0; }
+
+  // Whether uploads are fenced, i.e. the context has sync objects.
+  bool has_sync() const { return has_sync_; }
+
+  // Bind the next buffer in the ring to GL_PIXEL_UNPACK_BUFFER and map at
+  // least |size| bytes of it for writing. Returns NULL on failure, in which
+  // case nothing is left bound.
+  void* Map(size_t size);
+
+  // Unmap the buffer returned by Map(). The buffer stays bound so that the
+  // following texture uploads source from it. Returns false if the buffer
+  // contents were lost and the upload must be skipped.
+  bool Unmap();
+
+  // Insert a fence after the uploads sourced from the current buffer, if the
+  // context has sync objects, and unbind it.
+  void Fence();
+
+  // Number of times a buffer was orphaned because the GPU was still reading
+  // it or its size changed.
+  int orphan_count() const { return orphan_count_; }
+
+ private:
+  int count_;
+  int index_;
+  bool has_sync_;
+  GLuint buffer_ids_[kMaxBuffers];
+  GLsync fences_[kMaxBuffers];
+  size_t sizes_[kMaxBuffers];
+  int orphan_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(PboUploadRing);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_PBO_UPLOAD_RING_H_
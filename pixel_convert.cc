@@ -0,0 +1,330 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "pixel_convert.h"
+
+#include <math.h>
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "include/base/cef_logging.h"
+#include "pixel_convert_internal.h"
+
+namespace pixel_convert {
+namespace internal {
+
+void SwapRedBlueRow_C(const uint8_t* src, uint8_t* dst, int pixels) {
+  for (int i = 0; i < pixels; ++i, src += 4, dst += 4) {
+    const uint8_t b = src[0];
+    const uint8_t r = src[2];
+    dst[0] = r;
+    dst[1] = src[1];
+    dst[2] = b;
+    dst[3] = src[3];
+  }
+}
+
+void PremultiplyRow_C(const uint8_t* src, uint8_t* dst, int pixels) {
+  for (int i = 0; i < pixels; ++i, src += 4, dst += 4) {
+    const int a = src[3];
+    for (int c = 0; c < 3; ++c) {
+      // Exact round(src * a / 255).
+      const int t = src[c] * a + 128;
+      dst[c] = static_cast<uint8_t>((t + (t >> 8)) >> 8);
+    }
+    dst[3] = static_cast<uint8_t>(a);
+  }
+}
+
+void UnpremultiplyRow_C(const uint8_t* src, uint8_t* dst, int pixels) {
+  for (int i = 0; i < pixels; ++i, src += 4, dst += 4) {
+    const int a = src[3];
+    if (a == 0) {
+      dst[0] = dst[1] = dst[2] = dst[3] = 0;
+      continue;
+    }
+    // Single precision with round-to-nearest so that the SIMD versions can
+    // match it exactly.
+    const float scale = 255.0f / static_cast<float>(a);
+    for (int c = 0; c < 3; ++c) {
+      const long value = lrintf(static_cast<float>(src[c]) * scale);
+      dst[c] = static_cast<uint8_t>(std::min(value, 255L));
+    }
+    dst[3] = static_cast<uint8_t>(a);
+  }
+}
+
+void BgraToYRow_C(const uint8_t* src, uint8_t* y, int pixels) {
+  for (int i = 0; i < pixels; ++i, src += 4) {
+    y[i] = static_cast<uint8_t>(
+        (kYB * src[0] + kYG * src[1] + kYR * src[2] + kYBias) >> 8);
+  }
+}
+
+void BgraToUVRow_C(const uint8_t* src0,
+                   const uint8_t* src1,
+                   uint8_t* u,
+                   uint8_t* v,
+                   int pixels) {
+  for (int x = 0; x < pixels; x += 2) {
+    // Repeat the last column of an odd row.
+    const int x0 = x * 4;
+    const int x1 = std::min(x + 1, pixels - 1) * 4;
+    const int b = (src0[x0] + src0[x1] + src1[x0] + src1[x1] + 2) >> 2;
+    const int g =
+        (src0[x0 + 1] + src0[x1 + 1] + src1[x0 + 1] + src1[x1 + 1] + 2) >> 2;
+    const int r =
+        (src0[x0 + 2] + src0[x1 + 2] + src1[x0 + 2] + src1[x1 + 2] + 2) >> 2;
+    u[x / 2] =
+        static_cast<uint8_t>((kUB * b + kUG * g + kUR * r + kUVBias) >> 8);
+    v[x / 2] =
+        static_cast<uint8_t>((kVB * b + kVG * g + kVR * r + kUVBias) >> 8);
+  }
+}
+
+void HashRow_C(const uint8_t* src, int pixels, HashState* state) {
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8, src += 32) {
+    uint64_t data[4];
+    memcpy(data, src, sizeof(data));
+    for (int i = 0; i < 4; ++i) {
+      // The product mixes the keyed lane; adding the neighbouring lane keeps
+      // every input bit in the sum.
+      const uint64_t keyed = data[i] ^ state->key[i];
+      state->acc[i] += data[i ^ 1] + (keyed & 0xffffffff) * (keyed >> 32);
+      state->key[i] += kHashKeyStep;
+    }
+  }
+  for (; x < pixels; ++x, src += 4) {
+    uint32_t pixel;
+    memcpy(&pixel, src, sizeof(pixel));
+    uint64_t& acc = state->acc[x & 3];
+    acc = (acc ^ pixel) * kHashPrime;
+  }
+}
+
+}  // namespace internal
+
+namespace {
+
+using internal::Kernels;
+
+const Kernels kScalarKernels = {
+    internal::SwapRedBlueRow_C, internal::PremultiplyRow_C,
+    internal::UnpremultiplyRow_C, internal::BgraToYRow_C,
+    internal::BgraToUVRow_C, internal::HashRow_C};
+
+const Kernels* KernelsForIsa(Isa isa) {
+  switch (isa) {
+    case ISA_SCALAR:
+      return &kScalarKernels;
+#if defined(PIXEL_CONVERT_X86)
+    case ISA_SSE2:
+      return &internal::kSse2Kernels;
+    case ISA_AVX2:
+      return internal::CpuHasAvx2() ? &internal::kAvx2Kernels : NULL;
+#endif
+#if defined(PIXEL_CONVERT_NEON)
+    case ISA_NEON:
+      return &internal::kNeonKernels;
+#endif
+    default:
+      return NULL;
+  }
+}
+
+struct Selection {
+  Selection() : isa(GetBestIsa()), kernels(KernelsForIsa(isa)) {}
+
+  std::atomic<Isa> isa;
+  std::atomic<const Kernels*> kernels;
+};
+
+Selection& GetSelection() {
+  static Selection selection;
+  return selection;
+}
+
+inline const Kernels& GetKernels() {
+  return *GetSelection().kernels.load(std::memory_order_relaxed);
+}
+
+// Clip |rect| to a |width| x |height| image. Returns false if nothing is
+// left.
+bool ClipRect(const CefRect& rect, int width, int height, CefRect* clipped) {
+  const int left = std::max(rect.x, 0);
+  const int top = std::max(rect.y, 0);
+  const int right = std::min(rect.x + rect.width, width);
+  const int bottom = std::min(rect.y + rect.height, height);
+  if (right <= left || bottom <= top)
+    return false;
+  clipped->Set(left, top, right - left, bottom - top);
+  return true;
+}
+
+void ConvertRows(internal::PixelRowFunc row_func,
+                 const uint8_t* src,
+                 int src_stride,
+                 uint8_t* dst,
+                 int dst_stride,
+                 const CefRect& rect) {
+  if (rect.width <= 0 || rect.height <= 0)
+    return;
+  const size_t offset = static_cast<size_t>(rect.x) * 4;
+  src += static_cast<ptrdiff_t>(rect.y) * src_stride + offset;
+  dst += static_cast<ptrdiff_t>(rect.y) * dst_stride + offset;
+  for (int row = 0; row < rect.height;
+       ++row, src += src_stride, dst += dst_stride) {
+    row_func(src, dst, rect.width);
+  }
+}
+
+// Finalizer of MurmurHash3.
+inline uint64_t Mix64(uint64_t value) {
+  value ^= value >> 33;
+  value *= internal::kHashPrime;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ULL;
+  value ^= value >> 33;
+  return value;
+}
+
+}  // namespace
+
+Isa GetBestIsa() {
+#if defined(PIXEL_CONVERT_X86)
+  return internal::CpuHasAvx2() ? ISA_AVX2 : ISA_SSE2;
+#elif defined(PIXEL_CONVERT_NEON)
+  return ISA_NEON;
+#else
+  return ISA_SCALAR;
+#endif
+}
+
+Isa GetIsa() {
+  return GetSelection().isa;
+}
+
+const char* GetIsaName(Isa isa) {
+  switch (isa) {
+    case ISA_SCALAR:
+      return "scalar";
+    case ISA_SSE2:
+      return "sse2";
+    case ISA_AVX2:
+      return "avx2";
+    case ISA_NEON:
+      return "neon";
+  }
+  return "unknown";
+}
+
+bool SetIsa(Isa isa) {
+  const Kernels* kernels = KernelsForIsa(isa);
+  if (!kernels)
+    return false;
+  Selection& selection = GetSelection();
+  selection.kernels = kernels;
+  selection.isa = isa;
+  return true;
+}
+
+void SwapRedBlue(const uint8_t* src,
+                 int src_stride,
+                 uint8_t* dst,
+                 int dst_stride,
+                 const CefRect& rect) {
+  ConvertRows(GetKernels().swap_red_blue, src, src_stride, dst, dst_stride,
+              rect);
+}
+
+void Premultiply(const uint8_t* src,
+                 int src_stride,
+                 uint8_t* dst,
+                 int dst_stride,
+                 const CefRect& rect) {
+  ConvertRows(GetKernels().premultiply, src, src_stride, dst, dst_stride,
+              rect);
+}
+
+void Unpremultiply(const uint8_t* src,
+                   int src_stride,
+                   uint8_t* dst,
+                   int dst_stride,
+                   const CefRect& rect) {
+  ConvertRows(GetKernels().unpremultiply, src, src_stride, dst, dst_stride,
+              rect);
+}
+
+void BgraToI420(const uint8_t* src,
+                int src_stride,
+                uint8_t* y_plane,
+                int y_stride,
+                uint8_t* u_plane,
+                int u_stride,
+                uint8_t* v_plane,
+                int v_stride,
+                int width,
+                int height,
+                const CefRect& rect) {
+  // Grow the rectangle to whole chroma samples.
+  const int left = rect.x & ~1;
+  const int top = rect.y & ~1;
+  CefRect even(left, top, ((rect.x + rect.width + 1) & ~1) - left,
+               ((rect.y + rect.height + 1) & ~1) - top);
+  if (!ClipRect(even, width, height, &even))
+    return;
+
+  const Kernels& kernels = GetKernels();
+  const size_t src_offset = static_cast<size_t>(even.x) * 4;
+  const int bottom = even.y + even.height;
+  for (int row = even.y; row < bottom; row += 2) {
+    const uint8_t* src0 =
+        src + static_cast<ptrdiff_t>(row) * src_stride + src_offset;
+    // Repeat the last row of an odd image.
+    const uint8_t* src1 = row + 1 < bottom ? src0 + src_stride : src0;
+
+    kernels.bgra_to_y(src0, y_plane + static_cast<ptrdiff_t>(row) * y_stride +
+                                even.x,
+                      even.width);
+    if (src1 != src0) {
+      kernels.bgra_to_y(
+          src1, y_plane + static_cast<ptrdiff_t>(row + 1) * y_stride + even.x,
+          even.width);
+    }
+    kernels.bgra_to_uv(
+        src0, src1,
+        u_plane + static_cast<ptrdiff_t>(row / 2) * u_stride + even.x / 2,
+        v_plane + static_cast<ptrdiff_t>(row / 2) * v_stride + even.x / 2,
+        even.width);
+  }
+}
+
+uint64_t HashRect(const uint8_t* src, int stride, const CefRect& rect) {
+  internal::HashState state = {
+      {1, 2, 3, 4},
+      {0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL, 0xa4093822299f31d0ULL,
+       0x082efa98ec4e6c89ULL}};
+  if (rect.width > 0 && rect.height > 0) {
+    const internal::HashRowFunc hash_row = GetKernels().hash;
+    src += static_cast<ptrdiff_t>(rect.y) * stride +
+           static_cast<size_t>(rect.x) * 4;
+    for (int row = 0; row < rect.height; ++row, src += stride) {
+      hash_row(src, rect.width, &state);
+      // Make the hash depend on the row order.
+      for (int i = 0; i < 4; ++i)
+        state.acc[i] = Mix64(state.acc[i]);
+    }
+  }
+  uint64_t hash =
+      Mix64(static_cast<uint64_t>(rect.width) << 32 | rect.height);
+  for (int i = 0; i < 4; ++i)
+    hash = Mix64(hash + state.acc[i]);
+  return hash;
+}
+
+}  // namespace pixel_convert
@@ -0,0 +1,85 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_PIXEL_CONVERT_H_
+#define CEF_TESTS_CEFSIMPLE_PIXEL_CONVERT_H_
+#pragma once
+
+#include <stdint.h>
+
+#include "include/internal/cef_types_wrappers.h"
+
+// Conversions of the premultiplied BGRA frames produced by OnPaint. Every
+// function processes |rect| of an image whose rows are |stride| bytes apart,
+// so that only dirty regions need converting. The SSE2, AVX2 or NEON
+// implementation is picked at runtime and produces exactly the same output
+// as the scalar one.
+namespace pixel_convert {
+
+enum Isa {
+  ISA_SCALAR,
+  ISA_SSE2,
+  ISA_AVX2,
+  ISA_NEON,
+};
+
+// Best implementation supported by this CPU.
+Isa GetBestIsa();
+
+// Implementation currently in use.
+Isa GetIsa();
+const char* GetIsaName(Isa isa);
+
+// Use |isa| for subsequent calls, e.g. to compare against the scalar
+// version. Returns false if the CPU or the build does not support it.
+bool SetIsa(Isa isa);
+
+// BGRA to RGBA, or RGBA to BGRA. |src| and |dst| may be the same image.
+void SwapRedBlue(const uint8_t* src,
+                 int src_stride,
+                 uint8_t* dst,
+                 int dst_stride,
+                 const CefRect& rect);
+
+// Multiply the color channels by alpha. |src| and |dst| may be the same
+// image.
+void Premultiply(const uint8_t* src,
+                 int src_stride,
+                 uint8_t* dst,
+                 int dst_stride,
+                 const CefRect& rect);
+
+// Divide the color channels by alpha, e.g. for PNG output. Fully
+// transparent pixels become transparent black. |src| and |dst| may be the
+// same image.
+void Unpremultiply(const uint8_t* src,
+                   int src_stride,
+                   uint8_t* dst,
+                   int dst_stride,
+                   const CefRect& rect);
+
+// Convert |rect| of a |width| x |height| BGRA image to full-range BT.601
+// I420. |rect| is grown to even coordinates so that it covers whole chroma
+// samples. The planes are sized for the whole image; the chroma planes are
+// (width + 1) / 2 x (height + 1) / 2. Alpha is ignored.
+void BgraToI420(const uint8_t* src,
+                int src_stride,
+                uint8_t* y_plane,
+                int y_stride,
+                uint8_t* u_plane,
+                int u_stride,
+                uint8_t* v_plane,
+                int v_stride,
+                int width,
+                int height,
+                const CefRect& rect);
+
+// 64-bit hash of the pixels in |rect|, for detecting changed regions. Not
+// cryptographic: a collision is possible, if unlikely. Every implementation
+// returns the same value.
+uint64_t HashRect(const uint8_t* src, int stride, const CefRect& rect);
+
+}  // namespace pixel_convert
+
+#endif  // CEF_TESTS_CEFSIMPLE_PIXEL_CONVERT_H_
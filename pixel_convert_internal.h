@@ -0,0 +1,93 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_PIXEL_CONVERT_INTERNAL_H_
+#define CEF_TESTS_CEFSIMPLE_PIXEL_CONVERT_INTERNAL_H_
+#pragma once
+
+#include <stdint.h>
+
+// Row kernels behind pixel_convert.h. |pixels| is the number of source
+// pixels. The SIMD kernels handle the bulk of a row and finish it with the
+// scalar kernel.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PIXEL_CONVERT_X86 1
+#endif
+
+// The NEON kernels are only built with CEFSIMPLE_ENABLE_NEON until they are
+// covered by an ARM build of the tests.
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+    !defined(PIXEL_CONVERT_DISABLE_NEON)
+#define PIXEL_CONVERT_NEON 1
+#endif
+
+namespace pixel_convert {
+namespace internal {
+
+typedef void (*PixelRowFunc)(const uint8_t* src, uint8_t* dst, int pixels);
+typedef void (*YRowFunc)(const uint8_t* src, uint8_t* y, int pixels);
+// Produces (pixels + 1) / 2 chroma samples from two rows of |pixels|.
+typedef void (*UVRowFunc)(const uint8_t* src0,
+                          const uint8_t* src1,
+                          uint8_t* u,
+                          uint8_t* v,
+                          int pixels);
+
+// Running state of HashRect(). Each 32-byte block is keyed with |key|,
+// which advances per block so that moving content changes the hash.
+struct HashState {
+  uint64_t acc[4];
+  uint64_t key[4];
+};
+typedef void (*HashRowFunc)(const uint8_t* src, int pixels, HashState* state);
+
+struct Kernels {
+  PixelRowFunc swap_red_blue;
+  PixelRowFunc premultiply;
+  PixelRowFunc unpremultiply;
+  YRowFunc bgra_to_y;
+  UVRowFunc bgra_to_uv;
+  HashRowFunc hash;
+};
+
+// Full-range BT.601 coefficients in 8.8 fixed point. The 128 weights are
+// 127 so that the results stay within 0..255 without clamping.
+enum {
+  kYB = 29, kYG = 150, kYR = 77,
+  kUB = 127, kUG = -84, kUR = -43,
+  kVB = -21, kVG = -106, kVR = 127,
+  kYBias = 128,
+  kUVBias = 128 * 256 + 128,
+};
+
+const uint64_t kHashKeyStep = 0x9e3779b97f4a7c15ULL;
+const uint64_t kHashPrime = 0xff51afd7ed558ccdULL;
+
+void SwapRedBlueRow_C(const uint8_t* src, uint8_t* dst, int pixels);
+void PremultiplyRow_C(const uint8_t* src, uint8_t* dst, int pixels);
+void UnpremultiplyRow_C(const uint8_t* src, uint8_t* dst, int pixels);
+void BgraToYRow_C(const uint8_t* src, uint8_t* y, int pixels);
+void BgraToUVRow_C(const uint8_t* src0,
+                   const uint8_t* src1,
+                   uint8_t* u,
+                   uint8_t* v,
+                   int pixels);
+void HashRow_C(const uint8_t* src, int pixels, HashState* state);
+
+#if defined(PIXEL_CONVERT_X86)
+bool CpuHasAvx2();
+extern const Kernels kSse2Kernels;
+extern const Kernels kAvx2Kernels;
+#endif
+
+#if defined(PIXEL_CONVERT_NEON)
+extern const Kernels kNeonKernels;
+#endif
+
+}  // namespace internal
+}  // namespace pixel_convert
+
+#endif  // CEF_TESTS_CEFSIMPLE_PIXEL_CONVERT_INTERNAL_H_
@@ -0,0 +1,203 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// NEON kernels. The de-interleaving loads split 16 pixels into one register
+// per channel, which suits every conversion here.
+
+#include "pixel_convert_internal.h"
+
+#if defined(PIXEL_CONVERT_NEON)
+
+#include <arm_neon.h>
+
+namespace pixel_convert {
+namespace internal {
+
+namespace {
+
+void SwapRedBlueRow_NEON(const uint8_t* src, uint8_t* dst, int pixels) {
+  int x = 0;
+  for (; x + 16 <= pixels; x += 16) {
+    uint8x16x4_t p = vld4q_u8(src + x * 4);
+    const uint8x16_t b = p.val[0];
+    p.val[0] = p.val[2];
+    p.val[2] = b;
+    vst4q_u8(dst + x * 4, p);
+  }
+  SwapRedBlueRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+// Exact round(c * a / 255) for eight pixels, like PremultiplyRow_C.
+inline uint8x8_t Premultiply8(uint8x8_t c, uint8x8_t a) {
+  const uint16x8_t t = vaddq_u16(vmull_u8(c, a), vdupq_n_u16(128));
+  return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+void PremultiplyRow_NEON(const uint8_t* src, uint8_t* dst, int pixels) {
+  int x = 0;
+  for (; x + 16 <= pixels; x += 16) {
+    uint8x16x4_t p = vld4q_u8(src + x * 4);
+    const uint8x8_t a_lo = vget_low_u8(p.val[3]);
+    const uint8x8_t a_hi = vget_high_u8(p.val[3]);
+    for (int c = 0; c < 3; ++c) {
+      p.val[c] = vcombine_u8(Premultiply8(vget_low_u8(p.val[c]), a_lo),
+                             Premultiply8(vget_high_u8(p.val[c]), a_hi));
+    }
+    vst4q_u8(dst + x * 4, p);
+  }
+  PremultiplyRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+// Scale four channel values by 255 / alpha with round-to-nearest, saturating
+// to 0xffff.
+inline uint16x4_t Unpremultiply4(uint16x4_t c, float32x4_t scale) {
+  const float32x4_t value = vmulq_f32(vcvtq_f32_u32(vmovl_u16(c)), scale);
+  return vqmovn_u32(vcvtnq_u32_f32(value));
+}
+
+inline uint8x8_t Unpremultiply8(uint8x8_t c,
+                                float32x4_t scale_lo,
+                                float32x4_t scale_hi) {
+  const uint16x8_t wide = vmovl_u8(c);
+  return vqmovn_u16(
+      vcombine_u16(Unpremultiply4(vget_low_u16(wide), scale_lo),
+                   Unpremultiply4(vget_high_u16(wide), scale_hi)));
+}
+
+void UnpremultiplyRow_NEON(const uint8_t* src, uint8_t* dst, int pixels) {
+  const float32x4_t max = vdupq_n_f32(255.0f);
+  int x = 0;
+  for (; x + 16 <= pixels; x += 16) {
+    uint8x16x4_t p = vld4q_u8(src + x * 4);
+    const uint16x8_t a_lo = vmovl_u8(vget_low_u8(p.val[3]));
+    const uint16x8_t a_hi = vmovl_u8(vget_high_u8(p.val[3]));
+    // Zero alpha yields an infinite or NaN scale; those pixels are cleared
+    // below.
+    float32x4_t scale[4];
+    scale[0] = vdivq_f32(max, vcvtq_f32_u32(vmovl_u16(vget_low_u16(a_lo))));
+    scale[1] = vdivq_f32(max, vcvtq_f32_u32(vmovl_u16(vget_high_u16(a_lo))));
+    scale[2] = vdivq_f32(max, vcvtq_f32_u32(vmovl_u16(vget_low_u16(a_hi))));
+    scale[3] = vdivq_f32(max, vcvtq_f32_u32(vmovl_u16(vget_high_u16(a_hi))));
+
+    const uint8x16_t transparent = vceqq_u8(p.val[3], vdupq_n_u8(0));
+    for (int c = 0; c < 3; ++c) {
+      const uint8x16_t value = vcombine_u8(
+          Unpremultiply8(vget_low_u8(p.val[c]), scale[0], scale[1]),
+          Unpremultiply8(vget_high_u8(p.val[c]), scale[2], scale[3]));
+      p.val[c] = vbicq_u8(value, transparent);
+    }
+    vst4q_u8(dst + x * 4, p);
+  }
+  UnpremultiplyRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+#endif  // defined(__aarch64__) || defined(_M_ARM64)
+
+// The luma weights add up to 256, so the sum fits in 16 bits.
+inline uint8x8_t Luma8(uint8x8_t b, uint8x8_t g, uint8x8_t r) {
+  uint16x8_t sum = vmull_u8(b, vdup_n_u8(kYB));
+  sum = vmlal_u8(sum, g, vdup_n_u8(kYG));
+  sum = vmlal_u8(sum, r, vdup_n_u8(kYR));
+  return vshrn_n_u16(vaddq_u16(sum, vdupq_n_u16(kYBias)), 8);
+}
+
+void BgraToYRow_NEON(const uint8_t* src, uint8_t* y, int pixels) {
+  int x = 0;
+  for (; x + 16 <= pixels; x += 16) {
+    const uint8x16x4_t p = vld4q_u8(src + x * 4);
+    vst1q_u8(y + x, vcombine_u8(Luma8(vget_low_u8(p.val[0]),
+                                      vget_low_u8(p.val[1]),
+                                      vget_low_u8(p.val[2])),
+                                Luma8(vget_high_u8(p.val[0]),
+                                      vget_high_u8(p.val[1]),
+                                      vget_high_u8(p.val[2]))));
+  }
+  BgraToYRow_C(src + x * 4, y + x, pixels - x);
+}
+
+// The biased chroma sum always lies within 0..65535, so it can be computed
+// with wrapping 16-bit arithmetic and negative weights taken modulo 2^16.
+inline uint8x8_t Chroma8(uint16x8_t b,
+                         uint16x8_t g,
+                         uint16x8_t r,
+                         int kb,
+                         int kg,
+                         int kr) {
+  uint16x8_t sum = vdupq_n_u16(static_cast<uint16_t>(kUVBias));
+  sum = vmlaq_n_u16(sum, b, static_cast<uint16_t>(kb));
+  sum = vmlaq_n_u16(sum, g, static_cast<uint16_t>(kg));
+  sum = vmlaq_n_u16(sum, r, static_cast<uint16_t>(kr));
+  return vshrn_n_u16(sum, 8);
+}
+
+void BgraToUVRow_NEON(const uint8_t* src0,
+                      const uint8_t* src1,
+                      uint8_t* u,
+                      uint8_t* v,
+                      int pixels) {
+  const uint16x8_t round = vdupq_n_u16(2);
+  int x = 0;
+  for (; x + 16 <= pixels; x += 16) {
+    const uint8x16x4_t p0 = vld4q_u8(src0 + x * 4);
+    const uint8x16x4_t p1 = vld4q_u8(src1 + x * 4);
+    // 2x2 block averages, rounded like BgraToUVRow_C.
+    uint16x8_t avg[3];
+    for (int c = 0; c < 3; ++c) {
+      const uint16x8_t sum =
+          vaddq_u16(vpaddlq_u8(p0.val[c]), vpaddlq_u8(p1.val[c]));
+      avg[c] = vshrq_n_u16(vaddq_u16(sum, round), 2);
+    }
+    vst1_u8(u + x / 2, Chroma8(avg[0], avg[1], avg[2], kUB, kUG, kUR));
+    vst1_u8(v + x / 2, Chroma8(avg[0], avg[1], avg[2], kVB, kVG, kVR));
+  }
+  BgraToUVRow_C(src0 + x * 4, src1 + x * 4, u + x / 2, v + x / 2, pixels - x);
+}
+
+// One 16-byte block of HashRow_C: two 64-bit lanes.
+inline uint64x2_t HashBlock(uint64x2_t acc, uint64x2_t data, uint64x2_t key) {
+  const uint64x2_t keyed = veorq_u64(data, key);
+  const uint64x2_t product =
+      vmull_u32(vmovn_u64(keyed), vshrn_n_u64(keyed, 32));
+  const uint64x2_t swapped = vextq_u64(data, data, 1);
+  return vaddq_u64(acc, vaddq_u64(swapped, product));
+}
+
+void HashRow_NEON(const uint8_t* src, int pixels, HashState* state) {
+  uint64x2_t acc0 = vld1q_u64(state->acc);
+  uint64x2_t acc1 = vld1q_u64(state->acc + 2);
+  uint64x2_t key0 = vld1q_u64(state->key);
+  uint64x2_t key1 = vld1q_u64(state->key + 2);
+  const uint64x2_t step = vdupq_n_u64(kHashKeyStep);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const uint8_t* block = src + x * 4;
+    acc0 = HashBlock(acc0, vreinterpretq_u64_u8(vld1q_u8(block)), key0);
+    acc1 = HashBlock(acc1, vreinterpretq_u64_u8(vld1q_u8(block + 16)), key1);
+    key0 = vaddq_u64(key0, step);
+    key1 = vaddq_u64(key1, step);
+  }
+  vst1q_u64(state->acc, acc0);
+  vst1q_u64(state->acc + 2, acc1);
+  vst1q_u64(state->key, key0);
+  vst1q_u64(state->key + 2, key1);
+  HashRow_C(src + x * 4, pixels - x, state);
+}
+
+}  // namespace
+
+// 32-bit ARM has no round-to-nearest float conversion, so unpremultiplying
+// stays scalar there.
+const Kernels kNeonKernels = {
+    SwapRedBlueRow_NEON, PremultiplyRow_NEON,
+#if defined(__aarch64__) || defined(_M_ARM64)
+    UnpremultiplyRow_NEON,
+#else
+    UnpremultiplyRow_C,
+#endif
+    BgraToYRow_NEON, BgraToUVRow_NEON, HashRow_NEON};
+
+}  // namespace internal
+}  // namespace pixel_convert
+
+#endif  // defined(PIXEL_CONVERT_NEON)
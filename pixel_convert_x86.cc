@@ -0,0 +1,424 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// SSE2 and AVX2 kernels. SSE2 is part of every x86-64 CPU. The AVX2 kernels
+// are compiled with a function-level target attribute, so the file needs no
+// special compiler flags, and are only used if CpuHasAvx2() returns true.
+
+#include "pixel_convert_internal.h"
+
+#if defined(PIXEL_CONVERT_X86)
+
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace pixel_convert {
+namespace internal {
+
+namespace {
+
+// SSE2
+
+void SwapRedBlueRow_SSE2(const uint8_t* src, uint8_t* dst, int pixels) {
+  const __m128i ga_mask = _mm_set1_epi32(0xff00ff00);
+  const __m128i rb_mask = _mm_set1_epi32(0x00ff00ff);
+  int x = 0;
+  for (; x + 4 <= pixels; x += 4) {
+    const __m128i p =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+    const __m128i rb = _mm_and_si128(p, rb_mask);
+    const __m128i swapped = _mm_or_si128(
+        _mm_and_si128(p, ga_mask),
+        _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), swapped);
+  }
+  SwapRedBlueRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+// Multiply the 16-bit channels of two pixels by their alpha, rounding like
+// PremultiplyRow_C.
+inline __m128i PremultiplyPixels_SSE2(__m128i p) {
+  __m128i alpha = _mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(p, alpha), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+void PremultiplyRow_SSE2(const uint8_t* src, uint8_t* dst, int pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+  int x = 0;
+  for (; x + 4 <= pixels; x += 4) {
+    const __m128i p =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+    const __m128i lo = PremultiplyPixels_SSE2(_mm_unpacklo_epi8(p, zero));
+    const __m128i hi = PremultiplyPixels_SSE2(_mm_unpackhi_epi8(p, zero));
+    const __m128i result =
+        _mm_or_si128(_mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi)),
+                     _mm_and_si128(p, alpha_mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), result);
+  }
+  PremultiplyRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+// Unpremultiply one pixel held as four 32-bit channels. Zero alpha yields an
+// infinite or NaN scale, which converts to INT_MIN and saturates to 0 when
+// packed.
+inline __m128i UnpremultiplyPixel_SSE2(__m128i p) {
+  const __m128 channels = _mm_cvtepi32_ps(p);
+  const __m128 alpha = _mm_shuffle_ps(channels, channels, 0xff);
+  const __m128 scale = _mm_div_ps(_mm_set1_ps(255.0f), alpha);
+  return _mm_cvtps_epi32(_mm_mul_ps(channels, scale));
+}
+
+void UnpremultiplyRow_SSE2(const uint8_t* src, uint8_t* dst, int pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alpha_mask = _mm_set1_epi32(0xff000000);
+  int x = 0;
+  for (; x + 4 <= pixels; x += 4) {
+    const __m128i p =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+    const __m128i lo = _mm_unpacklo_epi8(p, zero);
+    const __m128i hi = _mm_unpackhi_epi8(p, zero);
+    const __m128i p0 = UnpremultiplyPixel_SSE2(_mm_unpacklo_epi16(lo, zero));
+    const __m128i p1 = UnpremultiplyPixel_SSE2(_mm_unpackhi_epi16(lo, zero));
+    const __m128i p2 = UnpremultiplyPixel_SSE2(_mm_unpacklo_epi16(hi, zero));
+    const __m128i p3 = UnpremultiplyPixel_SSE2(_mm_unpackhi_epi16(hi, zero));
+    // Saturating packs clamp to 0..255.
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(p0, p1),
+                                            _mm_packs_epi32(p2, p3));
+    const __m128i alpha = _mm_and_si128(p, alpha_mask);
+    // Transparent pixels become transparent black.
+    const __m128i opaque_mask = _mm_cmpeq_epi32(
+        _mm_cmpeq_epi32(alpha, zero), zero);
+    const __m128i result = _mm_and_si128(
+        _mm_or_si128(_mm_andnot_si128(alpha_mask, packed), alpha),
+        opaque_mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), result);
+  }
+  UnpremultiplyRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+// Weighted sum of the channels of four pixels given as two registers of two
+// 16-bit pixels each, one 32-bit result per pixel.
+inline __m128i WeightedSum4_SSE2(__m128i p01, __m128i p23, __m128i coeffs) {
+  const __m128 s01 = _mm_castsi128_ps(_mm_madd_epi16(p01, coeffs));
+  const __m128 s23 = _mm_castsi128_ps(_mm_madd_epi16(p23, coeffs));
+  const __m128i even =
+      _mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(2, 0, 2, 0)));
+  const __m128i odd =
+      _mm_castps_si128(_mm_shuffle_ps(s01, s23, _MM_SHUFFLE(3, 1, 3, 1)));
+  return _mm_add_epi32(even, odd);
+}
+
+void BgraToYRow_SSE2(const uint8_t* src, uint8_t* y, int pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i coeffs = _mm_setr_epi16(kYB, kYG, kYR, 0, kYB, kYG, kYR, 0);
+  const __m128i bias = _mm_set1_epi32(kYBias);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const __m128i a =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4 + 16));
+    __m128i y0 = WeightedSum4_SSE2(_mm_unpacklo_epi8(a, zero),
+                                   _mm_unpackhi_epi8(a, zero), coeffs);
+    __m128i y1 = WeightedSum4_SSE2(_mm_unpacklo_epi8(b, zero),
+                                   _mm_unpackhi_epi8(b, zero), coeffs);
+    y0 = _mm_srli_epi32(_mm_add_epi32(y0, bias), 8);
+    y1 = _mm_srli_epi32(_mm_add_epi32(y1, bias), 8);
+    const __m128i packed = _mm_packs_epi32(y0, y1);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(y + x),
+                     _mm_packus_epi16(packed, packed));
+  }
+  BgraToYRow_C(src + x * 4, y + x, pixels - x);
+}
+
+// Sum the two 16-bit pixels of |p| into the low four lanes.
+inline __m128i SumPixelPair_SSE2(__m128i p) {
+  return _mm_add_epi16(p, _mm_srli_si128(p, 8));
+}
+
+inline void StoreChroma4_SSE2(__m128i values, uint8_t* dst) {
+  const __m128i packed = _mm_packs_epi32(values, values);
+  const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+  memcpy(dst, &bytes, 4);
+}
+
+void BgraToUVRow_SSE2(const uint8_t* src0,
+                      const uint8_t* src1,
+                      uint8_t* u,
+                      uint8_t* v,
+                      int pixels) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi16(2);
+  const __m128i u_coeffs = _mm_setr_epi16(kUB, kUG, kUR, 0, kUB, kUG, kUR, 0);
+  const __m128i v_coeffs = _mm_setr_epi16(kVB, kVG, kVR, 0, kVB, kVG, kVR, 0);
+  const __m128i bias = _mm_set1_epi32(kUVBias);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const __m128i a0 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 4));
+    const __m128i a1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x * 4 + 16));
+    const __m128i b0 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 4));
+    const __m128i b1 =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x * 4 + 16));
+
+    // Column sums of pixel pairs, then the 2x2 block sums.
+    const __m128i s0 = SumPixelPair_SSE2(_mm_add_epi16(
+        _mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero)));
+    const __m128i s1 = SumPixelPair_SSE2(_mm_add_epi16(
+        _mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero)));
+    const __m128i s2 = SumPixelPair_SSE2(_mm_add_epi16(
+        _mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero)));
+    const __m128i s3 = SumPixelPair_SSE2(_mm_add_epi16(
+        _mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero)));
+
+    const __m128i c01 = _mm_srli_epi16(
+        _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), round), 2);
+    const __m128i c23 = _mm_srli_epi16(
+        _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), round), 2);
+
+    const __m128i u4 = _mm_srai_epi32(
+        _mm_add_epi32(WeightedSum4_SSE2(c01, c23, u_coeffs), bias), 8);
+    const __m128i v4 = _mm_srai_epi32(
+        _mm_add_epi32(WeightedSum4_SSE2(c01, c23, v_coeffs), bias), 8);
+    StoreChroma4_SSE2(u4, u + x / 2);
+    StoreChroma4_SSE2(v4, v + x / 2);
+  }
+  BgraToUVRow_C(src0 + x * 4, src1 + x * 4, u + x / 2, v + x / 2, pixels - x);
+}
+
+// One 16-byte block of HashRow_C: two 64-bit lanes.
+inline __m128i HashBlock_SSE2(__m128i acc, __m128i data, __m128i key) {
+  const __m128i keyed = _mm_xor_si128(data, key);
+  const __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+  const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+  return _mm_add_epi64(acc, _mm_add_epi64(swapped, product));
+}
+
+void HashRow_SSE2(const uint8_t* src, int pixels, HashState* state) {
+  __m128i acc0 = _mm_loadu_si128(reinterpret_cast<__m128i*>(state->acc));
+  __m128i acc1 = _mm_loadu_si128(reinterpret_cast<__m128i*>(state->acc + 2));
+  __m128i key0 = _mm_loadu_si128(reinterpret_cast<__m128i*>(state->key));
+  __m128i key1 = _mm_loadu_si128(reinterpret_cast<__m128i*>(state->key + 2));
+  const __m128i step = _mm_set1_epi64x(kHashKeyStep);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const __m128i* block = reinterpret_cast<const __m128i*>(src + x * 4);
+    acc0 = HashBlock_SSE2(acc0, _mm_loadu_si128(block), key0);
+    acc1 = HashBlock_SSE2(acc1, _mm_loadu_si128(block + 1), key1);
+    key0 = _mm_add_epi64(key0, step);
+    key1 = _mm_add_epi64(key1, step);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state->acc), acc0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state->acc + 2), acc1);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state->key), key0);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state->key + 2), key1);
+  HashRow_C(src + x * 4, pixels - x, state);
+}
+
+// AVX2
+
+TARGET_AVX2 void SwapRedBlueRow_AVX2(const uint8_t* src,
+                                     uint8_t* dst,
+                                     int pixels) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const __m256i p =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4),
+                        _mm256_shuffle_epi8(p, shuffle));
+  }
+  SwapRedBlueRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+TARGET_AVX2 inline __m256i PremultiplyPixels_AVX2(__m256i p) {
+  __m256i alpha = _mm256_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+  __m256i t =
+      _mm256_add_epi16(_mm256_mullo_epi16(p, alpha), _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+TARGET_AVX2 void PremultiplyRow_AVX2(const uint8_t* src,
+                                     uint8_t* dst,
+                                     int pixels) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i alpha_mask = _mm256_set1_epi32(0xff000000);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const __m256i p =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+    // Unpack and pack both work within 128-bit lanes, so pixel order is
+    // preserved.
+    const __m256i lo = PremultiplyPixels_AVX2(_mm256_unpacklo_epi8(p, zero));
+    const __m256i hi = PremultiplyPixels_AVX2(_mm256_unpackhi_epi8(p, zero));
+    const __m256i result = _mm256_or_si256(
+        _mm256_andnot_si256(alpha_mask, _mm256_packus_epi16(lo, hi)),
+        _mm256_and_si256(p, alpha_mask));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), result);
+  }
+  PremultiplyRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+// Unpremultiply two pixels, one per 128-bit lane, loaded from |src|.
+TARGET_AVX2 inline __m256i UnpremultiplyPixels_AVX2(const uint8_t* src) {
+  const __m256 channels = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+  const __m256 alpha = _mm256_shuffle_ps(channels, channels, 0xff);
+  const __m256 scale = _mm256_div_ps(_mm256_set1_ps(255.0f), alpha);
+  return _mm256_cvtps_epi32(_mm256_mul_ps(channels, scale));
+}
+
+TARGET_AVX2 void UnpremultiplyRow_AVX2(const uint8_t* src,
+                                       uint8_t* dst,
+                                       int pixels) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i alpha_mask = _mm256_set1_epi32(0xff000000);
+  // The packs below leave the pixels in the order 0 2 4 6 1 3 5 7.
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const uint8_t* s = src + x * 4;
+    const __m256i p01 = UnpremultiplyPixels_AVX2(s);
+    const __m256i p23 = UnpremultiplyPixels_AVX2(s + 8);
+    const __m256i p45 = UnpremultiplyPixels_AVX2(s + 16);
+    const __m256i p67 = UnpremultiplyPixels_AVX2(s + 24);
+    const __m256i packed = _mm256_permutevar8x32_epi32(
+        _mm256_packus_epi16(_mm256_packs_epi32(p01, p23),
+                            _mm256_packs_epi32(p45, p67)),
+        order);
+
+    const __m256i p =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+    const __m256i alpha = _mm256_and_si256(p, alpha_mask);
+    const __m256i transparent = _mm256_cmpeq_epi32(alpha, zero);
+    const __m256i result = _mm256_andnot_si256(
+        transparent,
+        _mm256_or_si256(_mm256_andnot_si256(alpha_mask, packed), alpha));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), result);
+  }
+  UnpremultiplyRow_C(src + x * 4, dst + x * 4, pixels - x);
+}
+
+// Luma of eight pixels, one 32-bit result per pixel, in the order
+// 0 1 2 3 | 4 5 6 7 across the two 128-bit lanes.
+TARGET_AVX2 inline __m256i Luma8_AVX2(__m256i p, __m256i coeffs) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256 lo = _mm256_castsi256_ps(
+      _mm256_madd_epi16(_mm256_unpacklo_epi8(p, zero), coeffs));
+  const __m256 hi = _mm256_castsi256_ps(
+      _mm256_madd_epi16(_mm256_unpackhi_epi8(p, zero), coeffs));
+  const __m256i even =
+      _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+  const __m256i odd =
+      _mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+  return _mm256_srli_epi32(
+      _mm256_add_epi32(_mm256_add_epi32(even, odd),
+                       _mm256_set1_epi32(kYBias)),
+      8);
+}
+
+TARGET_AVX2 void BgraToYRow_AVX2(const uint8_t* src, uint8_t* y, int pixels) {
+  const __m256i coeffs = _mm256_setr_epi16(kYB, kYG, kYR, 0, kYB, kYG, kYR, 0,
+                                           kYB, kYG, kYR, 0, kYB, kYG, kYR, 0);
+  // The packs below leave groups of four in the order 0 2 x x 1 3 x x.
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int x = 0;
+  for (; x + 16 <= pixels; x += 16) {
+    const __m256i y0 = Luma8_AVX2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4)),
+        coeffs);
+    const __m256i y1 = Luma8_AVX2(
+        _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(src + x * 4 + 32)),
+        coeffs);
+    const __m256i packed = _mm256_packs_epi32(y0, y1);
+    const __m256i bytes = _mm256_permutevar8x32_epi32(
+        _mm256_packus_epi16(packed, packed), order);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x),
+                     _mm256_castsi256_si128(bytes));
+  }
+  BgraToYRow_C(src + x * 4, y + x, pixels - x);
+}
+
+TARGET_AVX2 void HashRow_AVX2(const uint8_t* src,
+                              int pixels,
+                              HashState* state) {
+  __m256i acc = _mm256_loadu_si256(reinterpret_cast<__m256i*>(state->acc));
+  __m256i key = _mm256_loadu_si256(reinterpret_cast<__m256i*>(state->key));
+  const __m256i step = _mm256_set1_epi64x(kHashKeyStep);
+  int x = 0;
+  for (; x + 8 <= pixels; x += 8) {
+    const __m256i data =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+    const __m256i keyed = _mm256_xor_si256(data, key);
+    const __m256i product =
+        _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+    // Swaps the 64-bit lanes within each 128-bit half, like data[i ^ 1].
+    const __m256i swapped =
+        _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    acc = _mm256_add_epi64(acc, _mm256_add_epi64(swapped, product));
+    key = _mm256_add_epi64(key, step);
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(state->acc), acc);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(state->key), key);
+  HashRow_C(src + x * 4, pixels - x, state);
+}
+
+}  // namespace
+
+bool CpuHasAvx2() {
+  static const bool has_avx2 = [] {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+      return false;
+    // The OS must also save the YMM registers.
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+      return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+  }();
+  return has_avx2;
+}
+
+const Kernels kSse2Kernels = {SwapRedBlueRow_SSE2, PremultiplyRow_SSE2,
+                              UnpremultiplyRow_SSE2, BgraToYRow_SSE2,
+                              BgraToUVRow_SSE2, HashRow_SSE2};
+
+// Chroma is computed at a quarter of the luma rate, so the SSE2 kernel is
+// kept for it.
+const Kernels kAvx2Kernels = {SwapRedBlueRow_AVX2, PremultiplyRow_AVX2,
+                              UnpremultiplyRow_AVX2, BgraToYRow_AVX2,
+                              BgraToUVRow_SSE2, HashRow_AVX2};
+
+}  // namespace internal
+}  // namespace pixel_convert
+
+#endif  // defined(PIXEL_CONVERT_X86)
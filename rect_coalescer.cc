@@ -0,0 +1,255 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "rect_coalescer.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "include/base/cef_logging.h"
+
+namespace {
+
+int64_t Area(const CefRect& rect) {
+  return static_cast<int64_t>(rect.width) * rect.height;
+}
+
+CefRect Union(const CefRect& a, const CefRect& b) {
+  const int left = std::min(a.x, b.x);
+  const int top = std::min(a.y, b.y);
+  const int right = std::max(a.x + a.width, b.x + b.width);
+  const int bottom = std::max(a.y + a.height, b.y + b.height);
+  return CefRect(left, top, right - left, bottom - top);
+}
+
+// Saving of merging |a| and |b|: one call and the pixels of both rectangles,
+// less the pixels of their bounding box. Avoids constructing a CefRect since
+// it is the inner loop of MergePairs().
+inline int64_t MergeGain(const CefRect& a,
+                         int64_t area_a,
+                         const CefRect& b,
+                         int64_t area_b,
+                         int64_t call_cost_pixels) {
+  const int width =
+      std::max(a.x + a.width, b.x + b.width) - std::min(a.x, b.x);
+  const int height =
+      std::max(a.y + a.height, b.y + b.height) - std::min(a.y, b.y);
+  return call_cost_pixels + area_a + area_b -
+         static_cast<int64_t>(width) * height;
+}
+
+// Grid cell of the center of |rect|.
+int64_t TileKey(const CefRect& rect, int tile) {
+  const int x = std::max(0, rect.x + rect.width / 2) / tile;
+  const int y = std::max(0, rect.y + rect.height / 2) / tile;
+  return static_cast<int64_t>(y) << 32 | x;
+}
+
+// Orders rectangles by grid cell, then top to bottom and left to right, so
+// that the rectangles of a cell are adjacent and near ones come together.
+class TileOrder {
+ public:
+  explicit TileOrder(int tile) : tile_(tile) {}
+
+  bool operator()(const CefRect& a, const CefRect& b) const {
+    const int64_t key_a = TileKey(a, tile_);
+    const int64_t key_b = TileKey(b, tile_);
+    if (key_a != key_b)
+      return key_a < key_b;
+    if (a.y != b.y)
+      return a.y < b.y;
+    return a.x < b.x;
+  }
+
+ private:
+  const int tile_;
+};
+
+const int64_t kNoGain = INT64_MIN;
+
+}  // namespace
+
+RectCoalescer::RectCoalescer() : RectCoalescer(kDefaultCallCostPixels) {}
+
+RectCoalescer::RectCoalescer(int64_t call_cost_pixels)
+    : call_cost_pixels_(call_cost_pixels),
+      scratch_allocations_(0),
+      work_(ScratchAllocator<CefRect>(&scratch_allocations_)),
+      group_(ScratchAllocator<CefRect>(&scratch_allocations_)),
+      merged_(ScratchAllocator<CefRect>(&scratch_allocations_)),
+      areas_(ScratchAllocator<int64_t>(&scratch_allocations_)),
+      gains_(ScratchAllocator<int64_t>(&scratch_allocations_)),
+      partners_(ScratchAllocator<size_t>(&scratch_allocations_)) {}
+
+void RectCoalescer::Coalesce(const RectList& rects, RectList* out) {
+  DCHECK(out);
+  DCHECK_NE(out, &rects);
+
+  work_.clear();
+  CefRect bounds;
+  for (RectList::const_iterator it = rects.begin(); it != rects.end(); ++it) {
+    if (it->IsEmpty())
+      continue;
+    bounds = work_.empty() ? *it : Union(bounds, *it);
+    work_.push_back(*it);
+  }
+
+  // A rectangle that covers all the others, e.g. a full-frame paint, is the
+  // cheapest result there is.
+  for (size_t i = 0; i < work_.size(); ++i) {
+    if (work_[i] == bounds) {
+      out->assign(1, bounds);
+      return;
+    }
+  }
+
+  // The pairwise merge is quadratic. Merge large inputs locally first, in
+  // ever larger cells, until few enough rectangles are left.
+  if (work_.size() > kMaxPairwiseRects) {
+    const int extent = std::max(bounds.x + bounds.width,
+                                bounds.y + bounds.height);
+    for (int tile = kTileSize; work_.size() > kMaxPairwiseRects; tile *= 2) {
+      MergeTiles(tile);
+      if (tile >= extent)
+        break;
+    }
+  }
+
+  if (work_.size() <= kMaxPairwiseRects) {
+    MergePairs(&work_);
+  } else {
+    // Still too many rectangles that do not pay to merge locally. Upload
+    // the bounding box if that is cheaper.
+    int64_t cost = 0;
+    for (size_t i = 0; i < work_.size(); ++i)
+      cost += Area(work_[i]) + call_cost_pixels_;
+    if (Area(bounds) + call_cost_pixels_ <= cost) {
+      work_.clear();
+      work_.push_back(bounds);
+    }
+  }
+
+  out->assign(work_.begin(), work_.end());
+}
+
+void RectCoalescer::MergeTiles(int tile) {
+  std::sort(work_.begin(), work_.end(), TileOrder(tile));
+
+  merged_.clear();
+  size_t begin = 0;
+  while (begin < work_.size()) {
+    const int64_t key = TileKey(work_[begin], tile);
+    size_t end = begin + 1;
+    while (end < work_.size() && end - begin < kMaxPairwiseRects &&
+           TileKey(work_[end], tile) == key) {
+      end++;
+    }
+
+    group_.assign(work_.begin() + begin, work_.begin() + end);
+    MergePairs(&group_);
+    merged_.insert(merged_.end(), group_.begin(), group_.end());
+    begin = end;
+  }
+  work_.assign(merged_.begin(), merged_.end());
+}
+
+// Merging |a| and |b| saves one call and the pixels of both rectangles, and
+// costs the pixels of their bounding box. Every rectangle remembers its best
+// partner, so that a merge only rescans the rectangles whose partner it
+// consumed, instead of every pair.
+void RectCoalescer::MergePairs(ScratchRectList* rects) {
+  ScratchRectList& r = *rects;
+  size_t count = r.size();
+  areas_.resize(count);
+  gains_.resize(count);
+  partners_.resize(count);
+  for (size_t i = 0; i < count; ++i)
+    areas_[i] = Area(r[i]);
+  for (size_t i = 0; i < count; ++i)
+    FindBestPartner(r, i);
+
+  while (count > 1) {
+    size_t best = 0;
+    for (size_t i = 1; i < count; ++i) {
+      if (gains_[i] > gains_[best])
+        best = i;
+    }
+    if (gains_[best] < 0)
+      break;
+
+    // Merge |j| into |i| and move the last rectangle into the place of |j|.
+    const size_t i = std::min(best, partners_[best]);
+    const size_t j = std::max(best, partners_[best]);
+    const size_t last = count - 1;
+    r[i] = Union(r[i], r[j]);
+    areas_[i] = Area(r[i]);
+    for (size_t k = 0; k < count; ++k) {
+      if (partners_[k] == j)
+        gains_[k] = kNoGain;
+    }
+    r[j] = r[last];
+    areas_[j] = areas_[last];
+    gains_[j] = gains_[last];
+    partners_[j] = partners_[last];
+    count--;
+    r.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+      if (partners_[k] == last)
+        partners_[k] = j;
+    }
+
+    FindBestPartner(r, i);
+    for (size_t k = 0; k < count; ++k) {
+      if (k == i)
+        continue;
+      if (gains_[k] == kNoGain) {
+        // Its partner was merged away.
+        FindBestPartner(r, k);
+        continue;
+      }
+      const int64_t gain =
+          MergeGain(r[k], areas_[k], r[i], areas_[i], call_cost_pixels_);
+      if (partners_[k] == i && gain < gains_[k]) {
+        // The grown rectangle is a worse partner than before, so another
+        // one may now be the best.
+        FindBestPartner(r, k);
+      } else if (partners_[k] == i || gain > gains_[k]) {
+        gains_[k] = gain;
+        partners_[k] = i;
+      }
+    }
+  }
+
+  areas_.resize(count);
+  gains_.resize(count);
+  partners_.resize(count);
+}
+
+void RectCoalescer::FindBestPartner(const ScratchRectList& rects, size_t i) {
+  const CefRect& rect = rects[i];
+  const int64_t area = areas_[i];
+  int64_t best_gain = kNoGain;
+  size_t best = i;
+  for (size_t j = 0; j < rects.size(); ++j) {
+    if (j == i)
+      continue;
+    const int64_t gain =
+        MergeGain(rect, area, rects[j], areas_[j], call_cost_pixels_);
+    if (gain > best_gain) {
+      best_gain = gain;
+      best = j;
+    }
+  }
+  gains_[i] = best_gain;
+  partners_[i] = best;
+}
+
+// static
+int64_t RectCoalescer::Cost(const RectList& rects, int64_t call_cost_pixels) {
+  int64_t cost = 0;
+  for (RectList::const_iterator it = rects.begin(); it != rects.end(); ++it)
+    cost += Area(*it) + call_cost_pixels;
+  return cost;
+}
@@ -0,0 +1,121 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_RECT_COALESCER_H_
+#define CEF_TESTS_CEFSIMPLE_RECT_COALESCER_H_
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/internal/cef_types_wrappers.h"
+
+// Merges a list of dirty rectangles into a near-minimal set of upload
+// rectangles. Every upload call is charged a fixed cost expressed in pixels,
+// so two rectangles are merged into their bounding box whenever the pixels
+// wasted by the merge cost less than the call that is saved. The result
+// always covers every input rectangle and never costs more than the input.
+class RectCoalescer {
+ public:
+  typedef std::vector<CefRect> RectList;
+
+  // Roughly the cost of a glTexSubImage2D call plus its glPixelStorei setup,
+  // expressed as the number of pixels that could be uploaded instead.
+  static const int kDefaultCallCostPixels = 64 * 64;
+
+  // Largest group of rectangles merged pairwise in one go. Larger inputs are
+  // first merged within the cells of a grid, starting at kTileSize pixels
+  // and doubling the cell size until at most this many rectangles are left
+  // or one cell holds them all. A crowded cell is merged this many
+  // rectangles at a time.
+  static const size_t kMaxPairwiseRects = 32;
+  static const int kTileSize = 128;
+
+  RectCoalescer();
+  explicit RectCoalescer(int64_t call_cost_pixels);
+
+  void set_call_cost_pixels(int64_t call_cost_pixels) {
+    call_cost_pixels_ = call_cost_pixels;
+  }
+  int64_t call_cost_pixels() const { return call_cost_pixels_; }
+
+  // Write the coalesced version of |rects| to |out|. Empty rectangles are
+  // dropped. |out| may not alias |rects|.
+  void Coalesce(const RectList& rects, RectList* out);
+
+  // Total cost of uploading |rects|: the pixel count plus one call cost per
+  // rectangle.
+  static int64_t Cost(const RectList& rects, int64_t call_cost_pixels);
+
+  // Allocations made for the scratch storage since construction. Steady-state
+  // coalescing reuses the storage and makes none.
+  int64_t scratch_allocations() const { return scratch_allocations_; }
+
+ private:
+  // Counts the allocations of the scratch storage.
+  template <typename T>
+  class ScratchAllocator {
+   public:
+    typedef T value_type;
+
+    explicit ScratchAllocator(int64_t* count) : count_(count) {}
+    template <typename U>
+    ScratchAllocator(const ScratchAllocator<U>& other)
+        : count_(other.count_) {}
+
+    T* allocate(size_t n) {
+      ++*count_;
+      return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) { std::allocator<T>().deallocate(p, n); }
+
+    friend bool operator==(const ScratchAllocator& a,
+                           const ScratchAllocator& b) {
+      return a.count_ == b.count_;
+    }
+    friend bool operator!=(const ScratchAllocator& a,
+                           const ScratchAllocator& b) {
+      return a.count_ != b.count_;
+    }
+
+   private:
+    template <typename U>
+    friend class ScratchAllocator;
+
+    int64_t* count_;
+  };
+
+  typedef std::vector<CefRect, ScratchAllocator<CefRect>> ScratchRectList;
+
+  // Merge the rectangles of each |tile| x |tile| grid cell, by center.
+  void MergeTiles(int tile);
+
+  // Greedily merge the pair of |rects| with the largest saving until no
+  // merge pays off.
+  void MergePairs(ScratchRectList* rects);
+
+  // Find the partner of rects[i] that saves the most.
+  void FindBestPartner(const ScratchRectList& rects, size_t i);
+
+  int64_t call_cost_pixels_;
+  int64_t scratch_allocations_;
+
+  // Scratch storage reused between calls so that steady-state coalescing
+  // does not allocate.
+  ScratchRectList work_;
+  ScratchRectList group_;
+  ScratchRectList merged_;
+  std::vector<int64_t, ScratchAllocator<int64_t>> areas_;
+  // Best merge of each rectangle in MergePairs().
+  std::vector<int64_t, ScratchAllocator<int64_t>> gains_;
+  std::vector<size_t, ScratchAllocator<size_t>> partners_;
+
+  DISALLOW_COPY_AND_ASSIGN(RectCoalescer);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_RECT_COALESCER_H_
@@ -0,0 +1,92 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "render_thread.h"
+
+namespace {
+
+// Longest the render thread sleeps before checking |running_| again.
+const int kIdleWaitMs = 100;
+
+}  // namespace
+
+RenderThread::RenderThread(GLFWwindow* window,
+                           CefRefPtr<SimpleHandler> handler)
+    : window_(window), handler_(handler), running_(false), pending_size_(-1) {
+  DCHECK(window_);
+  DCHECK(handler_);
+}
+
+RenderThread::~RenderThread() {
+  DCHECK(!running_) << "Stop() must be called before destruction";
+}
+
+void RenderThread::Start() {
+  DCHECK(!running_);
+
+  int width = 0, height = 0;
+  glfwGetFramebufferSize(window_, &width, &height);
+  Resize(width, height);
+
+  // A context may only be current on one thread at a time.
+  glfwMakeContextCurrent(NULL);
+
+  running_ = true;
+  thread_ = std::thread(&RenderThread::Run, this);
+}
+
+void RenderThread::Stop() {
+  if (!running_)
+    return;
+
+  running_ = false;
+  thread_.join();
+
+  glfwMakeContextCurrent(window_);
+}
+
+void RenderThread::Resize(int width, int height) {
+  pending_size_ = (static_cast<int64_t>(width) << 32) | height;
+}
+
+void RenderThread::Run() {
+  glfwMakeContextCurrent(window_);
+  glfwSwapInterval(1);
+
+  DamageTracker& damage = handler_->damage_tracker();
+  FrameMetrics& metrics = handler_->frame_metrics();
+
+  while (running_) {
+    // Sleep instead of redrawing and swapping an unchanged frame.
+    if (!damage.WaitForDamage(kIdleWaitMs)) {
+      damage.OnFrameSkipped();
+      metrics.OnFrameSkipped();
+      continue;
+    }
+
+    const int64_t size = pending_size_.exchange(-1);
+    if (size >= 0) {
+      glViewport(0, 0, static_cast<GLsizei>(size >> 32),
+                 static_cast<GLsizei>(size & 0xffffffff));
+      VERIFY_NO_ERROR;
+    }
+
+    {
+      FrameMetrics::ScopedTimer timer(&metrics, FrameMetrics::RENDER_MS);
+      handler_->Render();
+    }
+
+    // Blocks until vsync without holding up the main thread.
+    {
+      FrameMetrics::ScopedTimer timer(&metrics, FrameMetrics::SWAP_MS);
+      glfwSwapBuffers(window_);
+    }
+    damage.OnFramePresented();
+    if (handler_->settings().log_input_latency)
+      handler_->latency_tracer().OnFramePresented();
+    metrics.EndFrame();
+  }
+
+  glfwMakeContextCurrent(NULL);
+}
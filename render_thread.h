@@ -0,0 +1,50 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_RENDER_THREAD_H_
+#define CEF_TESTS_CEFSIMPLE_RENDER_THREAD_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+
+#include "include/base/cef_macros.h"
+#include "simple_handler.h"
+
+// Renders and swaps |window| on a dedicated thread that owns its GL context,
+// so that a vsync wait never delays event and CEF message processing on the
+// main thread. Frames reach the thread through the handler's FrameMailbox.
+class RenderThread {
+ public:
+  RenderThread(GLFWwindow* window, CefRefPtr<SimpleHandler> handler);
+  ~RenderThread();
+
+  // Release the GL context from the calling thread and start rendering.
+  void Start();
+
+  // Stop rendering and make the GL context current on the calling thread
+  // again.
+  void Stop();
+
+  // Apply a new framebuffer size before the next frame. May be called from
+  // any thread.
+  void Resize(int width, int height);
+
+ private:
+  void Run();
+
+  GLFWwindow* const window_;
+  CefRefPtr<SimpleHandler> handler_;
+  std::thread thread_;
+  std::atomic<bool> running_;
+
+  // Framebuffer size packed as (width << 32 | height), or -1 if unchanged.
+  std::atomic<int64_t> pending_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(RenderThread);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_RENDER_THREAD_H_
@@ -0,0 +1,37 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "resize_throttle.h"
+
+#include <algorithm>
+
+namespace {
+
+int RoundUpToSizeClass(int value) {
+  return (value + ResizeThrottle::kTextureSizeClass - 1) /
+         ResizeThrottle::kTextureSizeClass * ResizeThrottle::kTextureSizeClass;
+}
+
+}  // namespace
+
+ResizeThrottle::ResizeThrottle() : last_flush_us_(0) {}
+
+int64_t ResizeThrottle::TimeUntilFlushUs(int64_t now_us,
+                                         int64_t interval_us) const {
+  if (last_flush_us_ == 0)
+    return 0;
+  return std::max<int64_t>(0, last_flush_us_ + interval_us - now_us);
+}
+
+// static
+bool ResizeThrottle::GrowTextureSize(int width,
+                                     int height,
+                                     int* texture_width,
+                                     int* texture_height) {
+  if (width <= *texture_width && height <= *texture_height)
+    return false;
+  *texture_width = std::max(*texture_width, RoundUpToSizeClass(width));
+  *texture_height = std::max(*texture_height, RoundUpToSizeClass(height));
+  return true;
+}
@@ -0,0 +1,44 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_RESIZE_THROTTLE_H_
+#define CEF_TESTS_CEFSIMPLE_RESIZE_THROTTLE_H_
+#pragma once
+
+#include <stdint.h>
+
+#include "include/base/cef_macros.h"
+
+// Keeps an interactive window resize from costing a WasResized notification
+// and a texture reallocation per input event. Notifications go out at most
+// once per present interval, and view textures grow in size classes.
+class ResizeThrottle {
+ public:
+  // View textures are allocated in multiples of this many pixels.
+  static const int kTextureSizeClass = 256;
+
+  ResizeThrottle();
+
+  // Microseconds from |now_us| until deferred notifications may be sent,
+  // given the display's present interval. 0 if they may be sent now.
+  int64_t TimeUntilFlushUs(int64_t now_us, int64_t interval_us) const;
+
+  // Notifications were sent at |now_us|.
+  void OnFlushed(int64_t now_us) { last_flush_us_ = now_us; }
+
+  // Grow |*texture_width| x |*texture_height| to fit |width| x |height|,
+  // rounded up to the size class. Textures never shrink. Returns true if the
+  // size changed and the storage has to be reallocated.
+  static bool GrowTextureSize(int width,
+                              int height,
+                              int* texture_width,
+                              int* texture_height);
+
+ private:
+  int64_t last_flush_us_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResizeThrottle);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_RESIZE_THROTTLE_H_
@@ -3,8 +3,13 @@
 // can be found in the LICENSE file.
 
 #include "simple_app.h"
+#include "external_message_pump.h"
+#include "latency_tracer.h"
 #include "simple_handler.h"
 
+#include <stdlib.h>
+
+#include <algorithm>
 #include <string>
 
 #include "include/cef_browser.h"
@@ -52,7 +57,8 @@ class SimpleWindowDelegate : public CefWindowDelegate {
 
 }  // namespace
 
-SimpleApp::SimpleApp() {}
+SimpleApp::SimpleApp(ExternalMessagePump* message_pump)
+    : message_pump_(message_pump) {}
 
 void SimpleApp::OnContextInitialized() {
   CEF_REQUIRE_UI_THREAD();
@@ -75,14 +81,11 @@ void SimpleApp::OnContextInitialized() {
 
   // Specify CEF browser settings here.
   CefBrowserSettings browser_settings;
+  if (handler->settings().windowless_frame_rate > 0)
+    browser_settings.windowless_frame_rate =
+        handler->settings().windowless_frame_rate;
 
-  std::string url;
-
-  // Check if a "--url=" value was provided via the command-line. If so, use
-  // that instead of the default URL.
-  url = command_line->GetSwitchValue("url");
-  if (url.empty())
-    url = "https://www.baidu.com";
+  const std::string url = GetStartupUrl();
 
   if (use_views) {
     // Create the BrowserView.
@@ -92,18 +95,42 @@ void SimpleApp::OnContextInitialized() {
     // Create the Window. It will show itself after creation.
     CefWindow::CreateTopLevelWindow(new SimpleWindowDelegate(browser_view));
   } else {
-    // Information used when creating the native window.
-    CefWindowInfo window_info;
+    // Check if a "--browser-count=" value was provided via the command-line.
+    // All windowless browsers are composited into the same window.
+    int browser_count = 1;
+    if (command_line->HasSwitch("browser-count"))
+      browser_count =
+          std::max(1, atoi(command_line->GetSwitchValue("browser-count")
+                               .ToString()
+                               .c_str()));
+
+    // Create the browser windows. The handler starts filling the browser
+    // pool once these are on their way.
+    for (int i = 0; i < browser_count; ++i)
+      handler->OpenBrowser(url);
+  }
+}
 
-#if defined(OS_WIN)
-    // On Windows we need to specify certain flags that will be passed to
-    // CreateWindowEx().
-    window_info.SetAsPopup(NULL, "cefsimple");
-#endif
+// static
+std::string SimpleApp::GetStartupUrl() {
+  CefRefPtr<CefCommandLine> command_line =
+      CefCommandLine::GetGlobalCommandLine();
 
-    window_info.SetAsWindowless(kNullWindowHandle);
+  // "--latency-echo" loads a page that paints the input it receives, so that
+  // each paint can be matched to the input it reflects.
+  if (command_line->HasSwitch("latency-echo"))
+    return LatencyTracer::kEchoPageUrl;
 
-    // Create the first browser window.
-    CefBrowserHost::CreateBrowser(window_info, handler, url, browser_settings, nullptr);
-  }
+  // Check if a "--url=" value was provided via the command-line. If so, use
+  // that instead of the default URL.
+  std::string url = command_line->GetSwitchValue("url");
+  if (url.empty())
+    url = "https://www.baidu.com";
+  return url;
+}
+
+void SimpleApp::OnScheduleMessagePumpWork(int64 delay_ms) {
+  // Called on any thread.
+  if (message_pump_)
+    message_pump_->ScheduleWork(delay_ms);
 }
@@ -5,12 +5,22 @@
 #ifndef CEF_TESTS_CEFSIMPLE_SIMPLE_APP_H_
 #define CEF_TESTS_CEFSIMPLE_SIMPLE_APP_H_
 
+#include <string>
+
 #include "include/cef_app.h"
 
+class ExternalMessagePump;
+
 // Implement application-level callbacks for the browser process.
 class SimpleApp : public CefApp, public CefBrowserProcessHandler {
  public:
-  SimpleApp();
+  // |message_pump| receives OnScheduleMessagePumpWork() requests when
+  // CefSettings.external_message_pump is enabled, and is NULL otherwise. It
+  // must outlive CEF.
+  explicit SimpleApp(ExternalMessagePump* message_pump);
+
+  // URL of the browsers opened at startup, from --url or --latency-echo.
+  static std::string GetStartupUrl();
 
   // CefApp methods:
   virtual CefRefPtr<CefBrowserProcessHandler> GetBrowserProcessHandler()
@@ -20,8 +30,11 @@ class SimpleApp : public CefApp, public CefBrowserProcessHandler {
 
   // CefBrowserProcessHandler methods:
   virtual void OnContextInitialized() OVERRIDE;
+  virtual void OnScheduleMessagePumpWork(int64 delay_ms) OVERRIDE;
 
  private:
+  ExternalMessagePump* const message_pump_;
+
   // Include the default reference counting implementation.
   IMPLEMENT_REFCOUNTING(SimpleApp);
 };
@@ -4,39 +4,100 @@
 
 #include "simple_handler.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 #include <string>
 
 #include "include/base/cef_bind.h"
 #include "include/cef_app.h"
+#include "include/cef_command_line.h"
 #include "include/views/cef_browser_view.h"
 #include "include/views/cef_window.h"
 #include "include/wrapper/cef_closure_task.h"
 #include "include/wrapper/cef_helpers.h"
 
-// DCHECK on gl errors.
-#if DCHECK_IS_ON()
-#define VERIFY_NO_ERROR                                                      \
-  {                                                                          \
-    int _gl_error = glGetError();                                            \
-    DCHECK(_gl_error == GL_NO_ERROR) << "glGetError returned " << _gl_error; \
-  }
-#else
-#define VERIFY_NO_ERROR
-#endif
-
 namespace {
 
     SimpleHandler* g_instance = NULL;
 
+    // Number of OnPaint uploads averaged per upload time report.
+    const int kUploadReportInterval = 120;
+
+    // Frame time graph drawn by the HUD, in window pixels.
+    const int kHudFrames = 120;
+    const int kHudBarWidth = 3;
+    const int kHudPixelsPerMs = 4;
+    const int kHudMaxMs = 50;
+    const int kHudMargin = 8;
+    const double kHudBudgetMs = 1000.0 / 60;
+
+    // Lowest accepted render scale.
+    const double kMinRenderScale = 0.25;
+
+    // The browser pool creates one browser per delay so that refilling does
+    // not compete with the views that are loading.
+    const int64 kBrowserPoolRefillDelayMs = 250;
+
+    // Rate of parked browsers, and the CefBrowserSettings default restored
+    // when one is handed out.
+    const int kParkedFrameRate = 1;
+    const int kDefaultWindowlessFrameRate = 30;
+
+    // Vertex layout used with glInterleavedArrays(GL_T2F_V3F).
+    struct Vertex {
+      float tu, tv;
+      float x, y, z;
+    };
+
+    int64_t NowUs() {
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+    }
+
 }  // namespace
 
 SimpleHandler::SimpleHandler(bool use_views)
-  : use_views_(use_views), is_closing_(false) {
+  : use_views_(use_views),
+    is_closing_(false),
+    initialized_(false),
+    layout_width_(0),
+    layout_height_(0),
+    layout_dirty_(true),
+    vertex_buffer_id_(0),
+    headless_frame_limit_(0),
+    creating_pooled_browser_(false),
+    browser_pool_refill_scheduled_(false),
+    paint_governor_scheduled_(false),
+    window_occluded_(false),
+    layout_changes_(0),
+    resize_notifications_(0),
+    resize_paints_(0),
+    texture_allocations_(0),
+    texture_resizes_(0),
+    render_scale_(1.0f),
+    hud_visible_(false),
+    upload_frames_(0),
+    upload_time_ms_(0),
+    upload_time_max_ms_(0) {
   DCHECK(!g_instance);
   g_instance = this;
 
-  Initialize();
+  InitializeSettings();
+  InitializeFrameSinks();
+  if (settings_.log_input_latency)
+    input_router_.set_latency_tracer(&latency_tracer_);
+  render_scale_ = static_cast<float>(settings_.render_scale);
+
+  // With a render thread the GL context is not current here; Render()
+  // initializes GL on first use instead. Headless runs have no GL at all.
+  if (!settings_.render_thread_enabled && !settings_.headless_enabled)
+    Initialize();
 }
 
 SimpleHandler::~SimpleHandler() {
@@ -70,8 +131,30 @@ void SimpleHandler::OnTitleChange(CefRefPtr<CefBrowser> browser,
 void SimpleHandler::OnAfterCreated(CefRefPtr<CefBrowser> browser) {
   CEF_REQUIRE_UI_THREAD();
 
-  // Add to the list of existing browsers.
-  browser_list_.push_back(browser);
+  // Parked browsers get a view when they are handed out.
+  if (creating_pooled_browser_ ||
+      browser_pool_.Contains(browser->GetIdentifier())) {
+    return;
+  }
+  browser_pool_.OnColdCreated(browser->GetIdentifier());
+  AddView(browser);
+}
+
+void SimpleHandler::AddView(CefRefPtr<CefBrowser> browser) {
+  std::unique_ptr<OsrView> view(new OsrView());
+  view->damage_filter.set_tile_size(settings_.damage_tile_size);
+  browsers_.Add(browser, view.get());
+  {
+    base::AutoLock lock_scope(views_lock_);
+    views_[browser->GetIdentifier()] = std::move(view);
+  }
+  if (settings_.external_begin_frame_enabled)
+    begin_frame_scheduler_.AddBrowser(browser);
+  else if (settings_.windowless_frame_rate > 0)
+    browser->GetHost()->SetWindowlessFrameRate(settings_.windowless_frame_rate);
+  paint_governor_.AddBrowser(browser->GetIdentifier());
+  SchedulePaintGovernor();
+  Layout();
 }
 
 bool SimpleHandler::DoClose(CefRefPtr<CefBrowser> browser) {
@@ -80,7 +163,8 @@ bool SimpleHandler::DoClose(CefRefPtr<CefBrowser> browser) {
   // Closing the main window requires special handling. See the DoClose()
   // documentation in the CEF header for a detailed destription of this
   // process.
-  if (browser_list_.size() == 1) {
+  if (browsers_.size() == 1 &&
+      !browser_pool_.Contains(browser->GetIdentifier())) {
     // Set a flag to indicate that the window close should be allowed.
     is_closing_ = true;
   }
@@ -93,19 +177,74 @@ bool SimpleHandler::DoClose(CefRefPtr<CefBrowser> browser) {
 void SimpleHandler::OnBeforeClose(CefRefPtr<CefBrowser> browser) {
   CEF_REQUIRE_UI_THREAD();
 
-  // Remove from the list of existing browsers.
-  BrowserList::iterator bit = browser_list_.begin();
-  for (; bit != browser_list_.end(); ++bit) {
-    if ((*bit)->IsSame(browser)) {
-      browser_list_.erase(bit);
-      break;
+  if (browser_pool_.Remove(browser->GetIdentifier())) {
+    QuitWhenAllClosed();
+    return;
+  }
+
+  browsers_.Remove(browser->GetIdentifier());
+
+  {
+    // The texture is deleted by the GL thread.
+    base::AutoLock lock_scope(views_lock_);
+    ViewMap::iterator it = views_.find(browser->GetIdentifier());
+    if (it != views_.end()) {
+      if (settings_.tile_damage_enabled)
+        LogDamageFilterStats(it->second->damage_filter.total());
+      closed_views_.push_back(std::move(it->second));
+      views_.erase(it);
     }
   }
+  begin_frame_scheduler_.RemoveBrowser(browser->GetIdentifier());
+  headless_frames_.erase(browser->GetIdentifier());
+  pending_resizes_.erase(browser->GetIdentifier());
+  latency_tracer_.OnBrowserClosed(browser->GetIdentifier());
+  browser_pool_.OnBrowserClosed(browser->GetIdentifier());
+  paint_governor_.RemoveBrowser(browser->GetIdentifier());
+  Layout();
+  QuitWhenAllClosed();
+}
 
-  if (browser_list_.empty()) {
-    // All browser windows have closed. Quit the application message loop.
-    CefQuitMessageLoop();
+void SimpleHandler::QuitWhenAllClosed() {
+  if (!browsers_.empty())
+    return;
+
+  // Parked browsers are of no use without a view to hand them out to.
+  CloseBrowserPool(true);
+  if (!browser_pool_.empty())
+    return;
+
+  // Let the sinks finish the queued frames.
+  if (sink_pipeline_.IsRunning()) {
+    sink_pipeline_.Stop();
+    sink_pipeline_.LogStats();
   }
+
+  // All browser windows have closed. Quit the application message loop.
+  CefQuitMessageLoop();
+}
+
+void SimpleHandler::OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                         bool isLoading,
+                                         bool canGoBack,
+                                         bool canGoForward) {
+  CEF_REQUIRE_UI_THREAD();
+
+  // A new document paints without input, so don't leave it on the idle
+  // heartbeat.
+  begin_frame_scheduler_.Wake(browser->GetIdentifier());
+
+  if (!isLoading)
+    browser_pool_.OnLoaded(browser->GetIdentifier());
+}
+
+void SimpleHandler::OnLoadStart(CefRefPtr<CefBrowser> browser,
+                                CefRefPtr<CefFrame> frame,
+                                TransitionType transition_type) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (frame->IsMain())
+    browser_pool_.OnNavigationCommitted(browser->GetIdentifier());
 }
 
 void SimpleHandler::OnLoadError(CefRefPtr<CefBrowser> browser,
@@ -136,149 +275,972 @@ void SimpleHandler::CloseAllBrowsers(bool force_close) {
     return;
   }
 
-  if (browser_list_.empty())
+  BrowserRegistry::Snapshot browsers = browsers_.GetSnapshot();
+  for (const BrowserRegistry::Entry& entry : *browsers)
+    entry.host->CloseBrowser(force_close);
+  CloseBrowserPool(force_close);
+}
+
+void SimpleHandler::OpenBrowser(const std::string& url) {
+  if (!CefCurrentlyOn(TID_UI)) {
+    CefPostTask(TID_UI, base::Bind(&SimpleHandler::OpenBrowser, this, url));
+    return;
+  }
+
+  CefRefPtr<CefBrowser> browser = browser_pool_.Take();
+  if (browser) {
+    CefRefPtr<CefBrowserHost> host = browser->GetHost();
+    if (!settings_.external_begin_frame_enabled) {
+      host->SetWindowlessFrameRate(settings_.windowless_frame_rate > 0
+                                       ? settings_.windowless_frame_rate
+                                       : kDefaultWindowlessFrameRate);
+    }
+    host->WasHidden(false);
+    AddView(browser);
+    browser_pool_.OnOpen(browser->GetIdentifier(), BrowserPool::SOURCE_POOL);
+    browser->GetMainFrame()->LoadURL(url);
+  } else {
+    CefBrowserSettings browser_settings;
+    if (settings_.windowless_frame_rate > 0)
+      browser_settings.windowless_frame_rate = settings_.windowless_frame_rate;
+    CefWindowInfo window_info;
+    GetWindowInfo(&window_info);
+    browser_pool_.OnColdOpen();
+    CefBrowserHost::CreateBrowser(window_info, this, url, browser_settings,
+                                  NULL);
+  }
+  ScheduleBrowserPoolRefill();
+}
+
+void SimpleHandler::GetWindowInfo(CefWindowInfo* window_info) const {
+#if defined(OS_WIN)
+  // On Windows we need to specify certain flags that will be passed to
+  // CreateWindowEx().
+  window_info->SetAsPopup(NULL, "cefsimple");
+#endif
+
+  window_info->SetAsWindowless(kNullWindowHandle);
+
+  // BeginFrames are sent by the handler in step with the present.
+  window_info->external_begin_frame_enabled =
+      settings_.external_begin_frame_enabled;
+}
+
+void SimpleHandler::ScheduleBrowserPoolRefill() {
+  if (browser_pool_refill_scheduled_ || !browser_pool_.NeedsBrowser())
+    return;
+  browser_pool_refill_scheduled_ = true;
+  CefPostDelayedTask(
+      TID_UI, base::Bind(&SimpleHandler::RefillBrowserPool, this),
+      kBrowserPoolRefillDelayMs);
+}
+
+void SimpleHandler::RefillBrowserPool() {
+  CEF_REQUIRE_UI_THREAD();
+
+  browser_pool_refill_scheduled_ = false;
+  if (!browser_pool_.NeedsBrowser())
+    return;
+
+  // Parked browsers are hidden and get no BeginFrames, so they paint almost
+  // nothing until they are handed out.
+  CefWindowInfo window_info;
+  GetWindowInfo(&window_info);
+  CefBrowserSettings browser_settings;
+  browser_settings.windowless_frame_rate = kParkedFrameRate;
+  creating_pooled_browser_ = true;
+  CefRefPtr<CefBrowser> browser = CefBrowserHost::CreateBrowserSync(
+      window_info, this, "about:blank", browser_settings, NULL);
+  creating_pooled_browser_ = false;
+  if (!browser) {
+    LOG(ERROR) << "Failed to create a pooled browser";
+    return;
+  }
+
+  browser->GetHost()->WasHidden(true);
+  browser_pool_.Add(browser);
+  ScheduleBrowserPoolRefill();
+}
+
+void SimpleHandler::CloseBrowserPool(bool force_close) {
+  BrowserPool::BrowserList parked = browser_pool_.Close();
+  for (size_t i = 0; i < parked.size(); ++i)
+    parked[i]->GetHost()->CloseBrowser(force_close);
+}
+
+void SimpleHandler::SetWindowOccluded(bool occluded) {
+  CEF_REQUIRE_UI_THREAD();
+  window_occluded_ = occluded;
+}
+
+void SimpleHandler::SchedulePaintGovernor() {
+  if (settings_.paint_budget_ms <= 0 || paint_governor_scheduled_ ||
+      browsers_.empty()) {
+    return;
+  }
+  paint_governor_scheduled_ = true;
+  CefPostDelayedTask(
+      TID_UI, base::Bind(&SimpleHandler::EvaluatePaintGovernor, this),
+      PaintGovernor::kEvaluateIntervalUs / 1000);
+}
+
+void SimpleHandler::EvaluatePaintGovernor() {
+  CEF_REQUIRE_UI_THREAD();
+
+  paint_governor_scheduled_ = false;
+  if (browsers_.empty())
     return;
 
-  BrowserList::const_iterator it = browser_list_.begin();
-  for (; it != browser_list_.end(); ++it)
-    (*it)->GetHost()->CloseBrowser(force_close);
+  // The focused view of a focused window is the one being interacted with.
+  // The rest of the window is still watched, more so while it has focus.
+  const int focus_id = input_router_.focus_id();
+  const bool window_focused = input_router_.window_focused();
+  BrowserRegistry::Snapshot browsers = browsers_.GetSnapshot();
+  for (const BrowserRegistry::Entry& entry : *browsers) {
+    PaintGovernor::Priority priority;
+    if (window_occluded_ || entry.view->layout_rect.IsEmpty())
+      priority = PaintGovernor::PRIORITY_OCCLUDED;
+    else if (entry.id == focus_id && window_focused)
+      priority = PaintGovernor::PRIORITY_FOCUSED;
+    else if (entry.id == focus_id || window_focused)
+      priority = PaintGovernor::PRIORITY_VISIBLE;
+    else
+      priority = PaintGovernor::PRIORITY_BACKGROUND;
+    paint_governor_.SetPriority(entry.id, priority);
+  }
+
+  int max_frame_rate = settings_.windowless_frame_rate > 0
+                           ? settings_.windowless_frame_rate
+                           : kDefaultWindowlessFrameRate;
+  if (settings_.external_begin_frame_enabled) {
+    max_frame_rate = static_cast<int>(
+        1000.0 / begin_frame_scheduler_.present_interval_ms() + 0.5);
+  }
+  paint_governor_.set_max_frame_rate(max_frame_rate);
+
+  governor_changes_.clear();
+  paint_governor_.Evaluate(NowUs(), &governor_changes_);
+  for (size_t i = 0; i < governor_changes_.size(); ++i) {
+    const PaintGovernor::Decision& decision = governor_changes_[i];
+    const BrowserRegistry::Entry* entry = browsers_.Find(decision.browser_id);
+    if (!entry)
+      continue;
+    if (decision.hidden_changed) {
+      entry->host->WasHidden(decision.hidden);
+      begin_frame_scheduler_.SetHidden(entry->id, decision.hidden);
+    }
+    if (settings_.external_begin_frame_enabled) {
+      begin_frame_scheduler_.SetMaxFrameRate(entry->id, decision.frame_rate);
+    } else {
+      entry->host->SetWindowlessFrameRate(decision.frame_rate);
+    }
+  }
+
+  SchedulePaintGovernor();
 }
 
 void SimpleHandler::GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) {
-  printf("wtf:GetViewRect:%d, %d\n", width, height);
+  {
+    base::AutoLock lock_scope(views_lock_);
+    ViewMap::const_iterator it = views_.find(browser->GetIdentifier());
+    if (it != views_.end() && !it->second->layout_rect.IsEmpty()) {
+      rect = CefRect(0, 0, it->second->layout_rect.width,
+                     it->second->layout_rect.height);
+      return;
+    }
+  }
 
   rect = CefRect(0, 0, width, height);
 }
 
+bool SimpleHandler::GetScreenInfo(CefRefPtr<CefBrowser> browser,
+                                  CefScreenInfo& screen_info) {
+  CEF_REQUIRE_UI_THREAD();
+
+  // The window is the whole screen as far as the page is concerned.
+  const CefRect screen_rect(0, 0, width, height);
+  screen_info.device_scale_factor = render_scale_;
+  screen_info.rect = screen_rect;
+  screen_info.available_rect = screen_rect;
+  return true;
+}
+
+void SimpleHandler::SetRenderScale(double scale) {
+  if (!CefCurrentlyOn(TID_UI)) {
+    CefPostTask(TID_UI,
+                base::Bind(&SimpleHandler::SetRenderScale, this, scale));
+    return;
+  }
+
+  const float clamped =
+      static_cast<float>(std::max(kMinRenderScale, std::min(scale, 1.0)));
+  if (clamped == render_scale_)
+    return;
+  render_scale_ = clamped;
+
+  // The browsers query GetScreenInfo again and repaint at the new size.
+  BrowserRegistry::Snapshot browsers = browsers_.GetSnapshot();
+  for (const BrowserRegistry::Entry& entry : *browsers) {
+    entry.host->NotifyScreenInfoChanged();
+    entry.host->WasResized();
+    begin_frame_scheduler_.Wake(entry.id);
+  }
+}
+
+void SimpleHandler::OnPopupShow(CefRefPtr<CefBrowser> browser, bool show) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (show)
+    return;
+
+  // The popup is an overlay, so hiding it needs no repaint of the view.
+  {
+    base::AutoLock lock_scope(views_lock_);
+    ViewMap::iterator it = views_.find(browser->GetIdentifier());
+    if (it == views_.end())
+      return;
+    it->second->popup_rect.Set(0, 0, 0, 0);
+    it->second->original_popup_rect.Set(0, 0, 0, 0);
+  }
+  damage_tracker_.Invalidate();
+}
+
+void SimpleHandler::OnPopupSize(CefRefPtr<CefBrowser> browser,
+                                const CefRect& rect) {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (rect.width <= 0 || rect.height <= 0)
+    return;
+
+  {
+    base::AutoLock lock_scope(views_lock_);
+    ViewMap::iterator it = views_.find(browser->GetIdentifier());
+    if (it == views_.end())
+      return;
+
+    OsrView* view = it->second.get();
+    view->original_popup_rect = rect;
+
+    // Keep the popup inside the view where possible.
+    CefRect popup_rect(rect);
+    const int view_width = view->layout_rect.width;
+    const int view_height = view->layout_rect.height;
+    if (popup_rect.x + popup_rect.width > view_width)
+      popup_rect.x = view_width - popup_rect.width;
+    if (popup_rect.y + popup_rect.height > view_height)
+      popup_rect.y = view_height - popup_rect.height;
+    if (popup_rect.x < 0)
+      popup_rect.x = 0;
+    if (popup_rect.y < 0)
+      popup_rect.y = 0;
+    view->popup_rect = popup_rect;
+  }
+  damage_tracker_.Invalidate();
+}
+
+OsrView* SimpleHandler::GetView(CefRefPtr<CefBrowser> browser) {
+  base::AutoLock lock_scope(views_lock_);
+  ViewMap::const_iterator it = views_.find(browser->GetIdentifier());
+  return it != views_.end() ? it->second.get() : NULL;
+}
+
+void SimpleHandler::Layout() {
+  CEF_REQUIRE_UI_THREAD();
+
+  InputRouter::TargetList targets;
+  {
+    base::AutoLock lock_scope(views_lock_);
+
+    const int count = static_cast<int>(views_.size());
+    int columns = 1;
+    while (columns * columns < count)
+      columns++;
+    const int rows = count > 0 ? (count + columns - 1) / columns : 1;
+
+    int index = 0;
+    for (ViewMap::iterator it = views_.begin(); it != views_.end();
+         ++it, ++index) {
+      const int column = index % columns;
+      const int row = index / columns;
+      const int left = column * width / columns;
+      const int top = row * height / rows;
+      const CefRect rect(left, top, (column + 1) * width / columns - left,
+                         (row + 1) * height / rows - top);
+
+      OsrView* view = it->second.get();
+      if (view->layout_rect.width != rect.width ||
+          view->layout_rect.height != rect.height) {
+        pending_resizes_.insert(it->first);
+        layout_changes_++;
+      }
+      view->layout_rect = rect;
+    }
+
+    layout_width_ = width;
+    layout_height_ = height;
+    layout_dirty_ = true;
+
+    BrowserRegistry::Snapshot browsers = browsers_.GetSnapshot();
+    for (const BrowserRegistry::Entry& entry : *browsers) {
+      InputRouter::Target target;
+      target.id = entry.id;
+      target.host = entry.host;
+      target.rect = entry.view->layout_rect;
+      targets.push_back(target);
+    }
+  }
+  // Outside the lock; the router calls into the browsers.
+  input_router_.SetLayout(targets, width, height);
+  damage_tracker_.Invalidate();
+}
+
+void SimpleHandler::FlushResizes() {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (pending_resizes_.empty())
+    return;
+
+  // A window drag produces a size change per input event. Notify at most
+  // once per frame; the last change of a drag goes out on the next frame,
+  // after the size has settled.
+  if (TimeUntilResizeFlushUs() > 0)
+    return;
+  resize_throttle_.OnFlushed(NowUs());
+
+  for (std::set<int>::const_iterator it = pending_resizes_.begin();
+       it != pending_resizes_.end(); ++it) {
+    const BrowserRegistry::Entry* entry = browsers_.Find(*it);
+    if (!entry)
+      continue;
+    entry->host->WasResized();
+    begin_frame_scheduler_.Wake(entry->id);
+    resize_notifications_++;
+  }
+  pending_resizes_.clear();
+}
+
+int64_t SimpleHandler::TimeUntilResizeFlushUs() const {
+  CEF_REQUIRE_UI_THREAD();
+
+  if (pending_resizes_.empty())
+    return -1;
+  const int64_t interval_us = static_cast<int64_t>(
+      begin_frame_scheduler_.present_interval_ms() * 1000);
+  return resize_throttle_.TimeUntilFlushUs(NowUs(), interval_us);
+}
+
+void SimpleHandler::LogResizeStats() {
+  LOG(INFO) << "Resize: " << layout_changes_ << " view size changes, "
+            << resize_notifications_ << " WasResized calls, "
+            << resize_paints_ << " resized paints, " << texture_allocations_
+            << " texture allocations for " << texture_resizes_
+            << " texture size changes";
+}
+
 void SimpleHandler::OnPaint(CefRefPtr<CefBrowser> browser,
                             PaintElementType type,
                             const RectList& dirtyRects,
                             const void* buffer,
                             int width,
                             int height) {
-  printf("wtf:OnPaint:width=%d, height=%d\n", width, height);
+  OsrView* view = GetView(browser);
+  if (!view)
+    return;
+
+  if (type == PET_VIEW)
+    browser_pool_.OnViewPaint(browser->GetIdentifier());
+
+  PaintGovernor::ScopedPaint paint_cost(&paint_governor_,
+                                        browser->GetIdentifier());
+
+  int64_t dirty_area = 0;
+  for (RectList::const_iterator it = dirtyRects.begin();
+       it != dirtyRects.end(); ++it) {
+    dirty_area += static_cast<int64_t>(it->width) * it->height;
+  }
+  frame_metrics_.RecordPaint(static_cast<int>(dirtyRects.size()), dirty_area);
+
+  if (type == PET_VIEW) {
+    const CefSize paint_size(width, height);
+    if (paint_size != view->paint_size && !view->paint_size.IsEmpty())
+      resize_paints_++;
+    view->paint_size = paint_size;
+  }
+
+  // Everything below only sees the damage whose pixels changed. Popups are
+  // small and always used as reported.
+  const RectList* damage = &dirtyRects;
+  if (type == PET_VIEW && settings_.tile_damage_enabled) {
+    view->damage_filter.Filter(dirtyRects, buffer, width, height,
+                               &refined_damage_);
+    damage = &refined_damage_;
+    const TileDamageFilter::Stats& stats = view->damage_filter.last();
+    frame_metrics_.RecordDamageFilter(
+        stats.reported_bytes - stats.refined_bytes, stats.filter_ms);
+  }
+
+  // Popups are not composited into sink output. Sinks see every paint, even
+  // an unchanged one, so that frame pacing is preserved.
+  if (type == PET_VIEW && sink_pipeline_.IsRunning()) {
+    sink_pipeline_.Submit(browser->GetIdentifier(), *damage, buffer, width,
+                          height);
+  }
+
+  if (settings_.headless_enabled) {
+    if (type == PET_VIEW)
+      CountHeadlessFrame(browser);
+    return;
+  }
+
+  if (type == PET_VIEW) {
+    if (settings_.log_input_latency) {
+      latency_tracer_.OnPaint(browser->GetIdentifier(), buffer, width, height,
+                              render_scale_);
+    }
+    begin_frame_scheduler_.OnPaint(browser->GetIdentifier());
+  }
+
+  // Nothing visible changed.
+  if (damage->empty())
+    return;
+
+  damage_tracker_.Invalidate();
+
+  if (settings_.frame_mailbox_enabled) {
+    // Hand the frame to Render() without touching GL.
+    if (type == PET_VIEW) {
+      view->frame_mailbox.Publish(*damage, buffer, width, height);
+    } else {
+      // Published first so that Render() never pairs the new size with the
+      // old texture.
+      view->popup_mailbox.Publish(*damage, buffer, width, height);
+      SetPopupPaintSize(view);
+    }
+    return;
+  }
+
+  // The GL context belongs to the render thread.
+  if (settings_.render_thread_enabled)
+    return;
 
   if (!initialized_)
     Initialize();
 
-  if (IsTransparent()) {
+  std::chrono::steady_clock::time_point upload_start =
+      std::chrono::steady_clock::now();
+
+  // Fixed-function enables are invalid in a core profile context and not
+  // needed for the upload itself.
+  const bool fixed_function = !settings_.core_profile_enabled;
+
+  if (fixed_function && IsTransparent()) {
     // Enable alpha blending.
     glEnable(GL_BLEND);
     VERIFY_NO_ERROR;
   }
 
-  // Enable 2D textures.
-  glEnable(GL_TEXTURE_2D);
+  if (fixed_function) {
+    // Enable 2D textures.
+    glEnable(GL_TEXTURE_2D);
+    VERIFY_NO_ERROR;
+  }
+
+  int64_t upload_bytes = 0;
+  if (type == PET_VIEW) {
+    BindTexture(&view->texture_id);
+    upload_bytes = UploadView(view, *damage, buffer, width, height);
+  } else {
+    upload_bytes = UploadPopup(view, *damage, buffer, width, height);
+    SetPopupPaintSize(view);
+  }
+
+  if (fixed_function) {
+    // Disable 2D textures.
+    glDisable(GL_TEXTURE_2D);
+    VERIFY_NO_ERROR;
+  }
+
+  if (fixed_function && IsTransparent()) {
+    // Disable alpha blending.
+    glDisable(GL_BLEND);
+    VERIFY_NO_ERROR;
+  }
+
+  RecordUploadTime(upload_bytes,
+                   std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - upload_start)
+                       .count());
+}
+
+void SimpleHandler::SetPopupPaintSize(OsrView* view) {
+  base::AutoLock lock_scope(views_lock_);
+  view->popup_paint_size =
+      CefSize(view->popup_rect.width, view->popup_rect.height);
+}
+
+void SimpleHandler::CountHeadlessFrame(CefRefPtr<CefBrowser> browser) {
+  CEF_REQUIRE_UI_THREAD();
+
+  // Nothing is presented without a window, so a view paint is a frame.
+  frame_metrics_.EndFrame();
+
+  if (headless_frame_limit_ <= 0)
+    return;
+
+  int64_t& frames = headless_frames_[browser->GetIdentifier()];
+  if (++frames == headless_frame_limit_)
+    browser->GetHost()->CloseBrowser(true);
+}
+
+void SimpleHandler::BindTexture(unsigned int* texture_id) {
+  if (*texture_id == 0) {
+    glGenTextures(1, texture_id);
+    VERIFY_NO_ERROR;
+    DCHECK_NE(*texture_id, 0U);
+
+    glBindTexture(GL_TEXTURE_2D, *texture_id);
+    VERIFY_NO_ERROR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    VERIFY_NO_ERROR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    VERIFY_NO_ERROR;
+    // Linear filtering must not wrap around to the opposite edge.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    VERIFY_NO_ERROR;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    VERIFY_NO_ERROR;
+    return;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, *texture_id);
   VERIFY_NO_ERROR;
+}
+
+// static
+void SimpleHandler::UpdateTextureFilter(unsigned int texture_id,
+                                        bool scaled,
+                                        int* filter) {
+  const int wanted = scaled ? GL_LINEAR : GL_NEAREST;
+  if (texture_id == 0 || *filter == wanted)
+    return;
 
-  DCHECK_NE(texture_id_, 0U);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  VERIFY_NO_ERROR;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, wanted);
+  VERIFY_NO_ERROR;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, wanted);
   VERIFY_NO_ERROR;
+  *filter = wanted;
+}
 
-  if (type == PET_VIEW) {
-    int old_width = view_width_;
-    int old_height = view_height_;
+int64_t SimpleHandler::UploadView(OsrView* view,
+                                  const RectList& dirtyRects,
+                                  const void* buffer,
+                                  int width,
+                                  int height) {
+  int old_width = view->view_width;
+  int old_height = view->view_height;
+
+  view->view_width = width;
+  view->view_height = height;
+
+  if (settings_.show_update_rect)
+    view->update_rect = dirtyRects[0];
+
+  // Merge small dirty rectangles to save per-call upload overhead.
+  const RectList* rects = &dirtyRects;
+  if (settings_.coalesce_dirty_rects && dirtyRects.size() > 1) {
+    rect_coalescer_.Coalesce(dirtyRects, &upload_rects_);
+    rects = &upload_rects_;
+  }
 
-    view_width_ = width;
-    view_height_ = height;
+  const bool resized =
+      old_width != view->view_width || old_height != view->view_height;
+  const bool full_update =
+      resized || (rects->size() == 1 && (*rects)[0] == CefRect(0, 0, width,
+                                                               height));
+
+  if (resized) {
+    texture_resizes_++;
+    view->texture_coords_changed = true;
+    // Must happen before a pixel-unpack buffer is bound, which would turn
+    // the NULL pixel pointer into a buffer offset.
+    ReserveTextureStorage(view, width, height);
+  }
 
-    if (settings_.show_update_rect)
-      update_rect_ = dirtyRects[0];
+  // With a pixel-unpack buffer bound the pixel pointer is an offset into
+  // the buffer, which mirrors the layout of |buffer|.
+  const void* pixels = buffer;
+  const bool use_pbo =
+      pbo_ring_.IsInitialized() &&
+      CopyToUnpackBuffer(*rects, buffer, width, height, full_update);
+  if (use_pbo)
+    pixels = NULL;
 
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, view_width_);
-    VERIFY_NO_ERROR;
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, view->view_width);
+  VERIFY_NO_ERROR;
 
-    if (old_width != view_width_ || old_height != view_height_ ||
-        (dirtyRects.size() == 1 &&
-         dirtyRects[0] == CefRect(0, 0, view_width_, view_height_))) {
-      // Update/resize the whole texture.
-      glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+  int64_t upload_bytes = 0;
+  if (full_update) {
+    // Update the whole contents. The storage was sized above.
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    VERIFY_NO_ERROR;
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    VERIFY_NO_ERROR;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA,
+                    GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+    VERIFY_NO_ERROR;
+    upload_bytes = static_cast<int64_t>(width) * height * 4;
+  } else {
+    // Update just the dirty rectangles.
+    CefRenderHandler::RectList::const_iterator i = rects->begin();
+    for (; i != rects->end(); ++i) {
+      const CefRect& rect = *i;
+      DCHECK(rect.x + rect.width <= view->view_width);
+      DCHECK(rect.y + rect.height <= view->view_height);
+      glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x);
       VERIFY_NO_ERROR;
-      glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+      glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y);
       VERIFY_NO_ERROR;
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, view_width_, view_height_, 0,
-                   GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width,
+                      rect.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+                      pixels);
       VERIFY_NO_ERROR;
-    } else {
-      // Update just the dirty rectangles.
-      CefRenderHandler::RectList::const_iterator i = dirtyRects.begin();
-      for (; i != dirtyRects.end(); ++i) {
-        const CefRect& rect = *i;
-        DCHECK(rect.x + rect.width <= view_width_);
-        DCHECK(rect.y + rect.height <= view_height_);
-        glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x);
-        VERIFY_NO_ERROR;
-        glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y);
-        VERIFY_NO_ERROR;
-        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width,
-                        rect.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
-                        buffer);
-        VERIFY_NO_ERROR;
-      }
-    }
-  } else if (type == PET_POPUP && popup_rect_.width > 0 &&
-             popup_rect_.height > 0) {
-    int skip_pixels = 0, x = popup_rect_.x;
-    int skip_rows = 0, y = popup_rect_.y;
-    int w = width;
-    int h = height;
-
-    // Adjust the popup to fit inside the view.
-    if (x < 0) {
-      skip_pixels = -x;
-      x = 0;
-    }
-    if (y < 0) {
-      skip_rows = -y;
-      y = 0;
+      upload_bytes += static_cast<int64_t>(rect.width) * rect.height * 4;
     }
-    if (x + w > view_width_)
-      w -= x + w - view_width_;
-    if (y + h > view_height_)
-      h -= y + h - view_height_;
+  }
+
+  if (use_pbo)
+    pbo_ring_.Fence();
+
+  return upload_bytes;
+}
 
-    // Update the popup rectangle.
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+void SimpleHandler::ReserveTextureStorage(OsrView* view,
+                                          int width,
+                                          int height) {
+  // Round up to a size class so that a window drag grows the texture a few
+  // times instead of reallocating it on every step.
+  if (!ResizeThrottle::GrowTextureSize(width, height, &view->texture_width,
+                                       &view->texture_height)) {
+    return;
+  }
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, view->texture_width,
+               view->texture_height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+               NULL);
+  VERIFY_NO_ERROR;
+  texture_allocations_++;
+}
+
+int64_t SimpleHandler::UploadPopup(OsrView* view,
+                                   const RectList& dirtyRects,
+                                   const void* buffer,
+                                   int width,
+                                   int height) {
+  BindTexture(&view->popup_texture_id);
+
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+  VERIFY_NO_ERROR;
+
+  if (width != view->popup_width || height != view->popup_height) {
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    VERIFY_NO_ERROR;
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
     VERIFY_NO_ERROR;
-    glPixelStorei(GL_UNPACK_SKIP_PIXELS, skip_pixels);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_BGRA,
+                 GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
     VERIFY_NO_ERROR;
-    glPixelStorei(GL_UNPACK_SKIP_ROWS, skip_rows);
+    view->popup_width = width;
+    view->popup_height = height;
+    return static_cast<int64_t>(width) * height * 4;
+  }
+
+  int64_t upload_bytes = 0;
+  RectList::const_iterator i = dirtyRects.begin();
+  for (; i != dirtyRects.end(); ++i) {
+    const CefRect& rect = *i;
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x);
     VERIFY_NO_ERROR;
-    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_BGRA,
-                    GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y);
     VERIFY_NO_ERROR;
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height,
+                    GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, buffer);
+    VERIFY_NO_ERROR;
+    upload_bytes += static_cast<int64_t>(rect.width) * rect.height * 4;
   }
+  return upload_bytes;
+}
 
-  // Disable 2D textures.
-  glDisable(GL_TEXTURE_2D);
-  VERIFY_NO_ERROR;
+void SimpleHandler::UploadMailboxFrame(OsrView* view) {
+  const FrameMailbox::Frame* popup = view->popup_mailbox.Acquire();
+  const FrameMailbox::Frame* frame = view->frame_mailbox.Acquire();
+  const bool upload_popup = popup && !popup->damage.empty();
+  const bool upload_view = frame && !frame->damage.empty();
+  if (!upload_popup && !upload_view)
+    return;
 
-  if (IsTransparent()) {
-    // Disable alpha blending.
-    glDisable(GL_BLEND);
-    VERIFY_NO_ERROR;
+  std::chrono::steady_clock::time_point upload_start =
+      std::chrono::steady_clock::now();
+
+  int64_t upload_bytes = 0;
+  if (upload_popup) {
+    upload_bytes += UploadPopup(view, popup->damage, &popup->pixels[0],
+                                popup->width, popup->height);
+  }
+  if (upload_view) {
+    BindTexture(&view->texture_id);
+    upload_bytes += UploadView(view, frame->damage, &frame->pixels[0],
+                               frame->width, frame->height);
   }
+
+  RecordUploadTime(upload_bytes,
+                   std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - upload_start)
+                       .count());
 }
 
-bool SimpleHandler::IsTransparent() {
-  return CefColorGetA(settings_.background_color) == 0;
-};
+bool SimpleHandler::CopyToUnpackBuffer(const RectList& dirtyRects,
+                                       const void* buffer,
+                                       int width,
+                                       int height,
+                                       bool full_update) {
+  const size_t stride = static_cast<size_t>(width) * 4;
+  const size_t size = stride * height;
+
+  uint8_t* dst = static_cast<uint8_t*>(pbo_ring_.Map(size));
+  if (!dst)
+    return false;
+
+  const uint8_t* src = static_cast<const uint8_t*>(buffer);
+  if (full_update) {
+    memcpy(dst, src, size);
+  } else {
+    // Only the dirty rectangles are read by the following texture uploads.
+    RectList::const_iterator i = dirtyRects.begin();
+    for (; i != dirtyRects.end(); ++i) {
+      const CefRect& rect = *i;
+      const size_t offset = rect.y * stride + static_cast<size_t>(rect.x) * 4;
+      const size_t row_bytes = static_cast<size_t>(rect.width) * 4;
+      for (int row = 0; row < rect.height; ++row) {
+        memcpy(dst + offset + row * stride, src + offset + row * stride,
+               row_bytes);
+      }
+    }
+  }
 
-void SimpleHandler::Initialize() {
+  return pbo_ring_.Unmap();
+}
 
-  if (initialized_)
+void SimpleHandler::OnInputEvent() {
+  begin_frame_scheduler_.WakeAll();
+}
+
+void SimpleHandler::SendBeginFrames() {
+  if (settings_.external_begin_frame_enabled)
+    begin_frame_scheduler_.Tick(damage_tracker_.last_present_us());
+}
+
+void SimpleHandler::SetDisplayRefreshRate(int refresh_rate) {
+  if (settings_.begin_frame_rate > 0 || refresh_rate <= 0)
+    return;
+  begin_frame_scheduler_.SetPresentInterval(1000.0 / refresh_rate);
+}
+
+void SimpleHandler::RecordUploadTime(int64_t bytes, double upload_ms) {
+  frame_metrics_.RecordUpload(bytes, upload_ms);
+
+  if (!settings_.log_upload_time)
+    return;
+
+  upload_frames_++;
+  upload_time_ms_ += upload_ms;
+  if (upload_ms > upload_time_max_ms_)
+    upload_time_max_ms_ = upload_ms;
+
+  if (upload_frames_ < kUploadReportInterval)
+    return;
+
+  LOG(INFO) << (pbo_ring_.IsInitialized() ? "PBO" : "Direct")
+            << " upload: avg " << upload_time_ms_ / upload_frames_
+            << " ms, max " << upload_time_max_ms_ << " ms over "
+            << upload_frames_ << " frames, " << pbo_ring_.orphan_count()
+            << " buffer orphans";
+
+  upload_frames_ = 0;
+  upload_time_ms_ = 0;
+  upload_time_max_ms_ = 0;
+}
+
+// static
+void SimpleHandler::LogDamageFilterStats(
+    const TileDamageFilter::Stats& stats) {
+  if (stats.frames == 0)
     return;
+  const double saved =
+      stats.reported_bytes > 0
+          ? 100.0 * (stats.reported_bytes - stats.refined_bytes) /
+                stats.reported_bytes
+          : 0;
+  LOG(INFO) << "Tile damage: " << stats.frames << " paints, "
+            << stats.reported_bytes / 1024 << " KB reported, "
+            << stats.refined_bytes / 1024 << " KB changed (" << saved
+            << "% saved), avg " << stats.filter_ms / stats.frames
+            << " ms, total " << stats.filter_ms << " ms";
+}
+
+bool SimpleHandler::IsTransparent() {
+  return CefColorGetA(settings_.background_color) == 0;
+};
 
+void SimpleHandler::InitializeSettings() {
   // init settings
   settings_.show_update_rect = false;
 
+  CefRefPtr<CefCommandLine> command_line =
+      CefCommandLine::GetGlobalCommandLine();
+  settings_.pbo_upload_enabled = command_line->HasSwitch("pbo-upload");
+  settings_.log_upload_time = command_line->HasSwitch("log-upload-time");
+  settings_.frame_mailbox_enabled = command_line->HasSwitch("frame-mailbox");
+  settings_.render_thread_enabled = command_line->HasSwitch("render-thread");
+  // The echo page is only useful with the tracer.
+  settings_.log_input_latency = command_line->HasSwitch("log-input-latency") ||
+                                command_line->HasSwitch("latency-echo");
+  settings_.core_profile_enabled = command_line->HasSwitch("core-profile");
+  settings_.coalesce_dirty_rects =
+      !command_line->HasSwitch("disable-rect-coalescing");
+  if (command_line->HasSwitch("upload-call-cost")) {
+    settings_.upload_call_cost_pixels =
+        atoi(command_line->GetSwitchValue("upload-call-cost")
+                 .ToString()
+                 .c_str());
+  }
+  rect_coalescer_.set_call_cost_pixels(settings_.upload_call_cost_pixels);
+  if (command_line->HasSwitch("render-scale")) {
+    const double scale = atof(
+        command_line->GetSwitchValue("render-scale").ToString().c_str());
+    if (scale > 0)
+      settings_.render_scale = std::max(kMinRenderScale, std::min(scale, 1.0));
+  }
+  settings_.tile_damage_enabled = command_line->HasSwitch("tile-damage");
+  if (command_line->HasSwitch("damage-tile-size")) {
+    const int tile_size = atoi(
+        command_line->GetSwitchValue("damage-tile-size").ToString().c_str());
+    if (tile_size > 0)
+      settings_.damage_tile_size = tile_size;
+  }
+
 #if defined(OS_WIN)
   settings->shared_texture_enabled = shared_texture_enabled_;
 #endif
-  settings_.external_begin_frame_enabled = true;
-  settings_.begin_frame_rate = 0;
+  settings_.external_begin_frame_enabled =
+      !command_line->HasSwitch("disable-external-begin-frame");
+  if (command_line->HasSwitch("begin-frame-rate")) {
+    settings_.begin_frame_rate =
+        atoi(command_line->GetSwitchValue("begin-frame-rate")
+                 .ToString()
+                 .c_str());
+  }
+  if (settings_.begin_frame_rate > 0)
+    begin_frame_scheduler_.SetPresentInterval(1000.0 /
+                                              settings_.begin_frame_rate);
 //  settings_.background_color = browser_background_color_;
 
+  if (command_line->HasSwitch("browser-pool-size")) {
+    settings_.browser_pool_size = std::max(
+        0, atoi(command_line->GetSwitchValue("browser-pool-size")
+                    .ToString()
+                    .c_str()));
+  }
+  browser_pool_.set_capacity(settings_.browser_pool_size);
+
+  if (command_line->HasSwitch("paint-budget-ms")) {
+    settings_.paint_budget_ms = std::max(
+        0, atoi(command_line->GetSwitchValue("paint-budget-ms")
+                    .ToString()
+                    .c_str()));
+  }
+  paint_governor_.set_budget_ms(settings_.paint_budget_ms);
+
+  settings_.headless_enabled = command_line->HasSwitch("headless");
+  if (command_line->HasSwitch("frame-rate")) {
+    settings_.windowless_frame_rate = atoi(
+        command_line->GetSwitchValue("frame-rate").ToString().c_str());
+  }
+  if (settings_.headless_enabled) {
+    // There is no present to drive BeginFrames from, so frames are paced by
+    // SetWindowlessFrameRate and nothing is drawn.
+    settings_.external_begin_frame_enabled = false;
+    settings_.render_thread_enabled = false;
+    settings_.frame_mailbox_enabled = false;
+    if (settings_.windowless_frame_rate <= 0)
+      settings_.windowless_frame_rate = 30;
+
+    if (command_line->HasSwitch("frame-count")) {
+      headless_frame_limit_ = atoi(
+          command_line->GetSwitchValue("frame-count").ToString().c_str());
+    }
+    if (command_line->HasSwitch("headless-size")) {
+      int w = 0, h = 0;
+      const std::string size =
+          command_line->GetSwitchValue("headless-size").ToString();
+      if (sscanf(size.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+        width = w;
+        height = h;
+      }
+    }
+  }
+
+  // GL calls are only allowed on the render thread, so OnPaint must hand
+  // frames over through the mailbox.
+  if (settings_.render_thread_enabled)
+    settings_.frame_mailbox_enabled = true;
+}
+
+void SimpleHandler::InitializeFrameSinks() {
+  CefRefPtr<CefCommandLine> command_line =
+      CefCommandLine::GetGlobalCommandLine();
+
+  // Headless runs always write their frames somewhere, stdout by default.
+  std::string output = command_line->GetSwitchValue("output");
+  if (output.empty() && settings_.headless_enabled)
+    output = "-";
+  if (output.empty())
+    return;
+
+  FrameWriter::Format format = FrameWriter::FORMAT_BGRA;
+  const std::string format_name =
+      command_line->GetSwitchValue("output-format");
+  if (!format_name.empty() && !FrameWriter::ParseFormat(format_name, &format))
+    LOG(ERROR) << "Unknown --output-format " << format_name << ", using bgra";
+
+  // Writing is lossless by default; encoders fed in real time may prefer to
+  // drop frames instead of holding up the UI thread.
+  FrameSinkPipeline::Policy policy = FrameSinkPipeline::POLICY_BLOCK;
+  const std::string policy_name = command_line->GetSwitchValue("sink-policy");
+  if (!policy_name.empty() &&
+      !FrameSinkPipeline::ParsePolicy(policy_name, &policy)) {
+    LOG(ERROR) << "Unknown --sink-policy " << policy_name << ", using block";
+  }
+
+  size_t queue_size = FrameSinkPipeline::kDefaultQueueSize;
+  if (command_line->HasSwitch("sink-queue-size")) {
+    queue_size = std::max(
+        1, atoi(command_line->GetSwitchValue("sink-queue-size")
+                    .ToString()
+                    .c_str()));
+  }
+
+  sink_pipeline_.AddSink(
+      std::unique_ptr<FrameSink>(new WriterFrameSink(
+          output, format, settings_.windowless_frame_rate)),
+      policy, queue_size);
+  sink_pipeline_.Start();
+}
+
+void SimpleHandler::Initialize() {
+  if (initialized_)
+    return;
+
   glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
   VERIFY_NO_ERROR;
 
@@ -297,37 +1259,294 @@ void SimpleHandler::Initialize() {
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   VERIFY_NO_ERROR;
 
-  // Create the texture.
-  glGenTextures(1, &texture_id_);
-  VERIFY_NO_ERROR;
-  DCHECK_NE(texture_id_, 0U);
-  VERIFY_NO_ERROR;
+  // View textures are created on first paint.
+  if (settings_.core_profile_enabled) {
+    if (!core_renderer_.Initialize(IsTransparent()))
+      LOG(ERROR) << "Failed to initialize the core profile renderer";
+  } else {
+    glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    VERIFY_NO_ERROR;
 
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-  VERIFY_NO_ERROR;
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    // Create the vertex buffer shared by all views.
+    glGenBuffers(1, &vertex_buffer_id_);
+    VERIFY_NO_ERROR;
+    DCHECK_NE(vertex_buffer_id_, 0U);
+  }
+
+  if (settings_.pbo_upload_enabled)
+    pbo_ring_.Initialize(settings_.pbo_count);
+
+  initialized_ = true;
+}
+
+void SimpleHandler::Cleanup() {
+  if (!initialized_)
+    return;
+
+  pbo_ring_.Cleanup();
+  core_renderer_.Cleanup();
+
+  {
+    base::AutoLock lock_scope(views_lock_);
+    DeleteClosedViews();
+    for (ViewMap::iterator it = views_.begin(); it != views_.end(); ++it)
+      DeleteViewTextures(it->second.get());
+    layout_dirty_ = true;
+  }
+
+  if (vertex_buffer_id_ != 0) {
+    glDeleteBuffers(1, &vertex_buffer_id_);
+    VERIFY_NO_ERROR;
+    vertex_buffer_id_ = 0;
+  }
+
+  initialized_ = false;
+}
+
+void SimpleHandler::DeleteClosedViews() {
+  views_lock_.AssertAcquired();
+  for (size_t i = 0; i < closed_views_.size(); ++i)
+    DeleteViewTextures(closed_views_[i].get());
+  closed_views_.clear();
+}
+
+// static
+void SimpleHandler::DeleteViewTextures(OsrView* view) {
+  if (view->texture_id != 0) {
+    glDeleteTextures(1, &view->texture_id);
+    VERIFY_NO_ERROR;
+    view->texture_id = 0;
+  }
+  if (view->popup_texture_id != 0) {
+    glDeleteTextures(1, &view->popup_texture_id);
+    VERIFY_NO_ERROR;
+    view->popup_texture_id = 0;
+  }
+  view->view_width = 0;
+  view->view_height = 0;
+  view->popup_width = 0;
+  view->popup_height = 0;
+  view->texture_width = 0;
+  view->texture_height = 0;
+  view->texture_filter = 0;
+  view->popup_texture_filter = 0;
+}
+
+bool SimpleHandler::ConsumeQuadChanges() {
+  views_lock_.AssertAcquired();
+  bool changed = layout_dirty_;
+  layout_dirty_ = false;
+  for (ViewMap::iterator it = views_.begin(); it != views_.end(); ++it) {
+    changed |= it->second->texture_coords_changed;
+    it->second->texture_coords_changed = false;
+  }
+  return changed;
+}
+
+void SimpleHandler::UpdateVertexBuffer() {
+  views_lock_.AssertAcquired();
+  if (layout_width_ == 0 || layout_height_ == 0 || !ConsumeQuadChanges())
+    return;
+
+  // Map each layout rectangle from window pixels to normalized device
+  // coordinates. Texture row 0 is the top of the page.
+  std::vector<Vertex> vertices;
+  vertices.reserve(views_.size() * 4);
+  for (ViewMap::const_iterator it = views_.begin(); it != views_.end();
+       ++it) {
+    const OsrView* view = it->second.get();
+    const CefRect& rect = view->layout_rect;
+    const float left = 2.0f * rect.x / layout_width_ - 1.0f;
+    const float right = 2.0f * (rect.x + rect.width) / layout_width_ - 1.0f;
+    const float top = 1.0f - 2.0f * rect.y / layout_height_;
+    const float bottom =
+        1.0f - 2.0f * (rect.y + rect.height) / layout_height_;
+    const float u = view->max_u();
+    const float v = view->max_v();
+    const Vertex quad[] = {{0.0f, v, left, bottom, 0.0f},
+                           {u, v, right, bottom, 0.0f},
+                           {u, 0.0f, right, top, 0.0f},
+                           {0.0f, 0.0f, left, top, 0.0f}};
+    vertices.insert(vertices.end(), quad, quad + 4);
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id_);
   VERIFY_NO_ERROR;
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+               vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
   VERIFY_NO_ERROR;
-  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
   VERIFY_NO_ERROR;
+}
 
-  initialized_ = true;
+void SimpleHandler::RenderCoreProfile() {
+  views_lock_.AssertAcquired();
+  if (!core_renderer_.IsInitialized())
+    return;
+
+  if (ConsumeQuadChanges()) {
+    view_quads_.clear();
+    for (ViewMap::const_iterator it = views_.begin(); it != views_.end();
+         ++it) {
+      const OsrView* view = it->second.get();
+      CoreProfileRenderer::ViewQuad quad;
+      quad.rect = view->layout_rect;
+      quad.max_u = view->max_u();
+      quad.max_v = view->max_v();
+      view_quads_.push_back(quad);
+    }
+    core_renderer_.SetViewQuads(view_quads_, layout_width_, layout_height_);
+  }
+
+  view_textures_.clear();
+  for (ViewMap::const_iterator it = views_.begin(); it != views_.end(); ++it) {
+    const OsrView* view = it->second.get();
+    const bool has_content = view->view_width != 0 && view->view_height != 0;
+    view_textures_.push_back(has_content ? view->texture_id : 0);
+  }
+  core_renderer_.Draw(view_textures_);
+
+  popup_rects_.clear();
+  popup_clip_rects_.clear();
+  popup_textures_.clear();
+  for (ViewMap::const_iterator it = views_.begin(); it != views_.end(); ++it) {
+    const OsrView* view = it->second.get();
+    if (!view->HasPopup())
+      continue;
+    popup_rects_.push_back(CefRect(view->layout_rect.x + view->popup_rect.x,
+                                   view->layout_rect.y + view->popup_rect.y,
+                                   view->popup_rect.width,
+                                   view->popup_rect.height));
+    popup_clip_rects_.push_back(view->layout_rect);
+    popup_textures_.push_back(view->popup_texture_id);
+  }
+  core_renderer_.DrawOverlays(popup_rects_, popup_clip_rects_,
+                              popup_textures_, layout_width_, layout_height_);
+
+  // Draw a rectangle around the update region of each view.
+  if (settings_.show_update_rect) {
+    outline_rects_.clear();
+    for (ViewMap::const_iterator it = views_.begin(); it != views_.end();
+         ++it) {
+      const OsrView* view = it->second.get();
+      if (view->update_rect.IsEmpty())
+        continue;
+      outline_rects_.push_back(
+          CefRect(view->layout_rect.x + view->update_rect.x,
+                  view->layout_rect.y + view->update_rect.y,
+                  view->update_rect.width, view->update_rect.height));
+    }
+    core_renderer_.DrawOutlines(outline_rects_, layout_width_,
+                                layout_height_);
+  }
+
+  if (hud_visible_) {
+    UpdateHud();
+    core_renderer_.DrawRects(hud_rects_, hud_colors_, layout_width_,
+                             layout_height_);
+  }
+}
+
+void SimpleHandler::RenderPopups() {
+  views_lock_.AssertAcquired();
+
+  GLint viewport[4] = {0, 0, 0, 0};
+  bool scissor_enabled = false;
+  for (ViewMap::const_iterator it = views_.begin(); it != views_.end(); ++it) {
+    const OsrView* view = it->second.get();
+    if (!view->HasPopup())
+      continue;
+
+    if (!scissor_enabled) {
+      // The viewport may be larger than the window on high-DPI displays.
+      glGetIntegerv(GL_VIEWPORT, viewport);
+      glEnable(GL_SCISSOR_TEST);
+      VERIFY_NO_ERROR;
+      scissor_enabled = true;
+    }
+
+    // Clip the popup to its view.
+    const CefRect& clip = view->layout_rect;
+    const float scale_x = static_cast<float>(viewport[2]) / layout_width_;
+    const float scale_y = static_cast<float>(viewport[3]) / layout_height_;
+    glScissor(viewport[0] + static_cast<GLint>(clip.x * scale_x),
+              viewport[1] + static_cast<GLint>(
+                                (layout_height_ - clip.y - clip.height) *
+                                scale_y),
+              static_cast<GLsizei>(clip.width * scale_x),
+              static_cast<GLsizei>(clip.height * scale_y));
+    VERIFY_NO_ERROR;
+
+    const int x = view->layout_rect.x + view->popup_rect.x;
+    const int y = view->layout_rect.y + view->popup_rect.y;
+    const float left = 2.0f * x / layout_width_ - 1.0f;
+    const float right =
+        2.0f * (x + view->popup_rect.width) / layout_width_ - 1.0f;
+    const float top = 1.0f - 2.0f * y / layout_height_;
+    const float bottom =
+        1.0f - 2.0f * (y + view->popup_rect.height) / layout_height_;
+
+    glBindTexture(GL_TEXTURE_2D, view->popup_texture_id);
+    VERIFY_NO_ERROR;
+    // Don't check for errors until glEnd().
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex2f(left, bottom);
+    glTexCoord2f(1.0f, 1.0f);
+    glVertex2f(right, bottom);
+    glTexCoord2f(1.0f, 0.0f);
+    glVertex2f(right, top);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2f(left, top);
+    glEnd();
+    VERIFY_NO_ERROR;
+  }
+
+  if (scissor_enabled) {
+    glDisable(GL_SCISSOR_TEST);
+    VERIFY_NO_ERROR;
+  }
 }
 
 void SimpleHandler::Render() {
-  if (view_width_ == 0 || view_height_ == 0)
+  if (!initialized_)
+    Initialize();
+
+  if (settings_.log_input_latency)
+    latency_tracer_.OnRenderStart();
+
+  base::AutoLock lock_scope(views_lock_);
+
+  DeleteClosedViews();
+
+  bool has_content = false;
+  for (ViewMap::const_iterator it = views_.begin(); it != views_.end(); ++it) {
+    OsrView* view = it->second.get();
+    if (settings_.frame_mailbox_enabled)
+      UploadMailboxFrame(view);
+    if (view->view_width != 0 && view->view_height != 0)
+      has_content = true;
+
+    // Textures painted below the layout size are upscaled.
+    UpdateTextureFilter(view->texture_id,
+                        view->view_width != view->layout_rect.width ||
+                            view->view_height != view->layout_rect.height,
+                        &view->texture_filter);
+    UpdateTextureFilter(view->popup_texture_id,
+                        view->popup_width != view->popup_rect.width ||
+                            view->popup_height != view->popup_rect.height,
+                        &view->popup_texture_filter);
+  }
+
+  if (!has_content)
     return;
 
-  DCHECK(initialized_);
+  if (settings_.core_profile_enabled) {
+    RenderCoreProfile();
+    return;
+  }
 
-  struct {
-      float tu, tv;
-      float x, y, z;
-  } static vertices[] = {{0.0f, 1.0f, -1.0f, -1.0f, 0.0f},
-                         {1.0f, 1.0f, 1.0f, -1.0f, 0.0f},
-                         {1.0f, 0.0f, 1.0f, 1.0f, 0.0f},
-                         {0.0f, 0.0f, -1.0f, 1.0f, 0.0f}};
+  UpdateVertexBuffer();
 
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   VERIFY_NO_ERROR;
@@ -385,16 +1604,32 @@ void SimpleHandler::Render() {
   glEnable(GL_TEXTURE_2D);
   VERIFY_NO_ERROR;
 
-  // Draw the facets with the texture.
-  DCHECK_NE(texture_id_, 0U);
+  // Draw the facets of all views from the shared vertex buffer. Only the
+  // texture binding changes between views.
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id_);
   VERIFY_NO_ERROR;
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  glInterleavedArrays(GL_T2F_V3F, 0, NULL);
   VERIFY_NO_ERROR;
-  glInterleavedArrays(GL_T2F_V3F, 0, vertices);
+  GLint first = 0;
+  for (ViewMap::const_iterator it = views_.begin(); it != views_.end();
+       ++it, first += 4) {
+    const OsrView* view = it->second.get();
+    if (view->view_width == 0 || view->view_height == 0)
+      continue;
+    glBindTexture(GL_TEXTURE_2D, view->texture_id);
+    VERIFY_NO_ERROR;
+    glDrawArrays(GL_QUADS, first, 4);
+    VERIFY_NO_ERROR;
+  }
+  glDisableClientState(GL_VERTEX_ARRAY);
+  VERIFY_NO_ERROR;
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
   VERIFY_NO_ERROR;
-  glDrawArrays(GL_QUADS, 0, 4);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
   VERIFY_NO_ERROR;
 
+  RenderPopups();
+
   // Disable 2D textures.
   glDisable(GL_TEXTURE_2D);
   VERIFY_NO_ERROR;
@@ -405,23 +1640,8 @@ void SimpleHandler::Render() {
     VERIFY_NO_ERROR;
   }
 
-  // Draw a rectangle around the update region.
-  if (settings_.show_update_rect && !update_rect_.IsEmpty()) {
-    int left = update_rect_.x;
-    int right = update_rect_.x + update_rect_.width;
-    int top = update_rect_.y;
-    int bottom = update_rect_.y + update_rect_.height;
-
-#if defined(OS_LINUX)
-    // Shrink the box so that top & right sides are drawn.
-    top += 1;
-    right -= 1;
-#else
-    // Shrink the box so that left & bottom sides are drawn.
-    left += 1;
-    bottom -= 1;
-#endif
-
+  // Draw a rectangle around the update region of each view.
+  if (settings_.show_update_rect) {
     glPushAttrib(GL_ALL_ATTRIB_BITS);
     VERIFY_NO_ERROR
     glMatrixMode(GL_PROJECTION);
@@ -430,26 +1650,133 @@ void SimpleHandler::Render() {
     VERIFY_NO_ERROR;
     glLoadIdentity();
     VERIFY_NO_ERROR;
-    glOrtho(0, view_width_, view_height_, 0, 0, 1);
+    glOrtho(0, layout_width_, layout_height_, 0, 0, 1);
     VERIFY_NO_ERROR;
 
     glLineWidth(1);
     VERIFY_NO_ERROR;
     glColor3f(1.0f, 0.0f, 0.0f);
     VERIFY_NO_ERROR;
-    // Don't check for errors until glEnd().
-    glBegin(GL_LINE_STRIP);
-    glVertex2i(left, top);
-    glVertex2i(right, top);
-    glVertex2i(right, bottom);
-    glVertex2i(left, bottom);
-    glVertex2i(left, top);
-    glEnd();
-    VERIFY_NO_ERROR;
+
+    for (ViewMap::const_iterator it = views_.begin(); it != views_.end();
+         ++it) {
+      const OsrView* view = it->second.get();
+      if (view->update_rect.IsEmpty())
+        continue;
+
+      int left = view->layout_rect.x + view->update_rect.x;
+      int right = left + view->update_rect.width;
+      int top = view->layout_rect.y + view->update_rect.y;
+      int bottom = top + view->update_rect.height;
+
+#if defined(OS_LINUX)
+      // Shrink the box so that top & right sides are drawn.
+      top += 1;
+      right -= 1;
+#else
+      // Shrink the box so that left & bottom sides are drawn.
+      left += 1;
+      bottom -= 1;
+#endif
+
+      // Don't check for errors until glEnd().
+      glBegin(GL_LINE_STRIP);
+      glVertex2i(left, top);
+      glVertex2i(right, top);
+      glVertex2i(right, bottom);
+      glVertex2i(left, bottom);
+      glVertex2i(left, top);
+      glEnd();
+      VERIFY_NO_ERROR;
+    }
 
     glPopMatrix();
     VERIFY_NO_ERROR;
     glPopAttrib();
     VERIFY_NO_ERROR;
   }
+
+  if (hud_visible_) {
+    UpdateHud();
+    RenderHud();
+  }
+}
+
+void SimpleHandler::ToggleHud() {
+  hud_visible_ = !hud_visible_;
+  damage_tracker_.Invalidate();
+}
+
+void SimpleHandler::UpdateHud() {
+  frame_metrics_.GetRecentFrameTimes(kHudFrames, &hud_frame_times_);
+
+  hud_rects_.clear();
+  hud_colors_.clear();
+
+  const int graph_height = kHudMaxMs * kHudPixelsPerMs;
+  const int bottom = layout_height_ - kHudMargin;
+
+  // Translucent backdrop. Opaque unless the window is transparent.
+  hud_rects_.push_back(CefRect(kHudMargin, bottom - graph_height,
+                               kHudFrames * kHudBarWidth, graph_height));
+  hud_colors_.push_back(CefColorSetARGB(160, 0, 0, 0));
+
+  // One bar per frame, red when over the budget.
+  for (size_t i = 0; i < hud_frame_times_.size(); ++i) {
+    const double ms = std::min<double>(hud_frame_times_[i], kHudMaxMs);
+    const int height =
+        std::max(1, static_cast<int>(ms * kHudPixelsPerMs + 0.5));
+    hud_rects_.push_back(CefRect(kHudMargin + static_cast<int>(i) * kHudBarWidth,
+                                 bottom - height, kHudBarWidth - 1, height));
+    hud_colors_.push_back(hud_frame_times_[i] > kHudBudgetMs
+                              ? CefColorSetARGB(255, 255, 64, 64)
+                              : CefColorSetARGB(255, 64, 255, 64));
+  }
+
+  // Frame budget line.
+  hud_rects_.push_back(CefRect(
+      kHudMargin,
+      bottom - static_cast<int>(kHudBudgetMs * kHudPixelsPerMs + 0.5),
+      kHudFrames * kHudBarWidth, 1));
+  hud_colors_.push_back(CefColorSetARGB(255, 255, 255, 0));
+}
+
+void SimpleHandler::RenderHud() {
+  glPushAttrib(GL_ALL_ATTRIB_BITS);
+  VERIFY_NO_ERROR;
+  glMatrixMode(GL_PROJECTION);
+  VERIFY_NO_ERROR;
+  glPushMatrix();
+  VERIFY_NO_ERROR;
+  glLoadIdentity();
+  VERIFY_NO_ERROR;
+  glOrtho(0, layout_width_, layout_height_, 0, 0, 1);
+  VERIFY_NO_ERROR;
+
+  if (IsTransparent()) {
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    VERIFY_NO_ERROR;
+    glEnable(GL_BLEND);
+    VERIFY_NO_ERROR;
+  }
+
+  // Don't check for errors until glEnd().
+  glBegin(GL_QUADS);
+  for (size_t i = 0; i < hud_rects_.size(); ++i) {
+    const CefRect& rect = hud_rects_[i];
+    const cef_color_t color = hud_colors_[i];
+    glColor4ub(CefColorGetR(color), CefColorGetG(color), CefColorGetB(color),
+               CefColorGetA(color));
+    glVertex2i(rect.x, rect.y);
+    glVertex2i(rect.x + rect.width, rect.y);
+    glVertex2i(rect.x + rect.width, rect.y + rect.height);
+    glVertex2i(rect.x, rect.y + rect.height);
+  }
+  glEnd();
+  VERIFY_NO_ERROR;
+
+  glPopMatrix();
+  VERIFY_NO_ERROR;
+  glPopAttrib();
+  VERIFY_NO_ERROR;
 }
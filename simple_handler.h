@@ -5,11 +5,33 @@
 #ifndef CEF_TESTS_CEFSIMPLE_SIMPLE_HANDLER_H_
 #define CEF_TESTS_CEFSIMPLE_SIMPLE_HANDLER_H_
 
+#include "include/base/cef_lock.h"
 #include "include/cef_client.h"
+#include "begin_frame_scheduler.h"
+#include "browser_pool.h"
+#include "browser_registry.h"
+#include "core_profile_renderer.h"
+#include "damage_tracker.h"
+#include "frame_metrics.h"
+#include "frame_sink_pipeline.h"
+#include "input_router.h"
+#include "osr_gl.h"
 #include "osr_renderer_settings.h"
+#include "osr_view.h"
+#include "paint_governor.h"
+#include "pbo_upload_ring.h"
+#include "rect_coalescer.h"
+#include "resize_throttle.h"
+#include "tile_damage_filter.h"
 
-#include <list>
-#include <GLFW/glfw3.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 using namespace client;
 
@@ -44,6 +66,13 @@ class SimpleHandler : public CefClient,
   virtual void OnBeforeClose(CefRefPtr<CefBrowser> browser) OVERRIDE;
 
   // CefLoadHandler methods:
+  virtual void OnLoadingStateChange(CefRefPtr<CefBrowser> browser,
+                                    bool isLoading,
+                                    bool canGoBack,
+                                    bool canGoForward) OVERRIDE;
+  virtual void OnLoadStart(CefRefPtr<CefBrowser> browser,
+                           CefRefPtr<CefFrame> frame,
+                           TransitionType transition_type) OVERRIDE;
   virtual void OnLoadError(CefRefPtr<CefBrowser> browser,
                            CefRefPtr<CefFrame> frame,
                            ErrorCode errorCode,
@@ -53,12 +82,25 @@ class SimpleHandler : public CefClient,
   // Request that all existing browser windows close.
   void CloseAllBrowsers(bool force_close);
 
+  // Open a windowless view of |url|. Hands out a parked browser if the pool
+  // has one ready and creates a browser otherwise. May be called from any
+  // thread.
+  void OpenBrowser(const std::string& url);
+
   bool IsClosing() const { return is_closing_; }
 
   CefRefPtr<CefRenderHandler> GetRenderHandler() override { return this; }
 
   virtual void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect) OVERRIDE;
 
+  virtual bool GetScreenInfo(CefRefPtr<CefBrowser> browser,
+                             CefScreenInfo& screen_info) OVERRIDE;
+
+  virtual void OnPopupShow(CefRefPtr<CefBrowser> browser, bool show) OVERRIDE;
+
+  virtual void OnPopupSize(CefRefPtr<CefBrowser> browser,
+                           const CefRect& rect) OVERRIDE;
+
   virtual void OnPaint(CefRefPtr<CefBrowser> browser,
                               PaintElementType type,
                               const RectList& dirtyRects,
@@ -69,43 +111,318 @@ class SimpleHandler : public CefClient,
   void Initialize();
   bool IsTransparent();
   void Render();
+  void Cleanup();
+
+  // Called for every input event forwarded to the browsers. Wakes idle
+  // browsers. Must be called on the CEF UI thread.
+  void OnInputEvent();
+
+  // Send the external BeginFrames that are due. Must be called on the CEF UI
+  // thread, once per message loop iteration.
+  void SendBeginFrames();
+
+  // Send the WasResized notifications deferred by Layout(). Must be called
+  // on the CEF UI thread, once per message loop iteration.
+  void FlushResizes();
+
+  // Microseconds until FlushResizes() will send the deferred notifications,
+  // or -1 if none are pending. Must be called on the CEF UI thread.
+  int64_t TimeUntilResizeFlushUs() const;
+
+  // Log how many size changes, notifications, resized paints and texture
+  // allocations resizing has caused.
+  void LogResizeStats();
+
+  // Refresh rate of the display the window is on, used as the BeginFrame
+  // rate unless settings.begin_frame_rate is set.
+  void SetDisplayRefreshRate(int refresh_rate);
+
+  // Per-frame timings. Render loops time Render(), the swap and
+  // CefDoMessageLoopWork and call EndFrame() on present. Headless, every
+  // view paint ends a frame.
+  FrameMetrics& frame_metrics() { return frame_metrics_; }
+
+  // Show or hide the frame time graph drawn over the views.
+  void ToggleHud();
+  bool hud_visible() const { return hud_visible_; }
+
+  // Paint and upload |scale| (0.25-1) of the view resolution and upscale it
+  // when drawing. View sizes and input coordinates are unaffected. May be
+  // called from any thread.
+  void SetRenderScale(double scale);
+  double render_scale() const { return render_scale_; }
+
+  const BeginFrameScheduler& begin_frame_scheduler() const {
+    return begin_frame_scheduler_;
+  }
+
+  // Sends input to the browser under the pointer or with focus. Follows
+  // Layout(). Only accessed on the CEF UI thread.
+  InputRouter& input_router() { return input_router_; }
+
+  // Used when settings.log_input_latency is true. The render loops report
+  // presents with OnFramePresented().
+  LatencyTracer& latency_tracer() { return latency_tracer_; }
+
+  const OsrRendererSettings& settings() const { return settings_; }
+
+  // Used when settings.browser_pool_size is positive. Also times the first
+  // paint of every view opened with OpenBrowser(). Only accessed on the CEF
+  // UI thread.
+  const BrowserPool& browser_pool() const { return browser_pool_; }
+
+  // Used when settings.paint_budget_ms is positive. Only accessed on the CEF
+  // UI thread.
+  const PaintGovernor& paint_governor() const { return paint_governor_; }
+
+  // The window was minimized or restored. Views of an occluded window are
+  // hidden by the paint governor. Must be called on the CEF UI thread.
+  void SetWindowOccluded(bool occluded);
+
+  // Tells the render loop whether anything changed since the last present.
+  DamageTracker& damage_tracker() { return damage_tracker_; }
 
  private:
   // Platform-specific implementation.
   void PlatformTitleChange(CefRefPtr<CefBrowser> browser,
                            const CefString& title);
 
+  // Read the renderer settings from the global command line.
+  void InitializeSettings();
+
+  // Register the frame sinks selected on the command line and start them.
+  void InitializeFrameSinks();
+
+  // Count a headless frame of |browser| in the frame metrics and close the
+  // browser once --frame-count frames were produced.
+  void CountHeadlessFrame(CefRefPtr<CefBrowser> browser);
+
+  // Record that the popup of |view| was painted at its current size.
+  void SetPopupPaintSize(OsrView* view);
+
+  // Give |browser| a view and start sending it frames.
+  void AddView(CefRefPtr<CefBrowser> browser);
+
+  // Quit once every view and parked browser has closed.
+  void QuitWhenAllClosed();
+
+  // Fill in the window info of the windowless browsers the handler creates.
+  void GetWindowInfo(CefWindowInfo* window_info) const;
+
+  // Create a parked browser if the pool is not full, one per
+  // kBrowserPoolRefillDelayMs.
+  void ScheduleBrowserPoolRefill();
+  void RefillBrowserPool();
+
+  // Close the parked browsers and stop refilling the pool.
+  void CloseBrowserPool(bool force_close);
+
+  // Evaluate the paint governor every PaintGovernor::kEvaluateIntervalUs
+  // while there are views, and apply its frame rates and visibility.
+  void SchedulePaintGovernor();
+  void EvaluatePaintGovernor();
+
+  // Returns the view of |browser|, or NULL if it has none.
+  OsrView* GetView(CefRefPtr<CefBrowser> browser);
+
+  // Tile the views in a grid covering the window. Browsers whose size
+  // changed are notified by the next FlushResizes().
+  void Layout();
+
+  // Create the texture |*texture_id| if needed and bind it. Must be called on
+  // the GL thread.
+  void BindTexture(unsigned int* texture_id);
+
+  // Grow the storage of the bound view texture to hold |width| x |height|.
+  // Must be called on the GL thread with no pixel-unpack buffer bound.
+  void ReserveTextureStorage(OsrView* view, int width, int height);
+
+  // Returns true if the layout or the texture coordinates of any view
+  // changed since the last call, i.e. the view quads must be rebuilt.
+  bool ConsumeQuadChanges();
+
+  // Sample |texture_id| with linear filtering if it is |scaled| and with
+  // nearest filtering otherwise. |*filter| caches the current filter. Must
+  // be called on the GL thread.
+  static void UpdateTextureFilter(unsigned int texture_id,
+                                  bool scaled,
+                                  int* filter);
+
+  // Upload the |dirtyRects| of a |width| x |height| |buffer| into the bound
+  // texture of |view|. Returns the number of bytes uploaded.
+  int64_t UploadView(OsrView* view,
+                  const RectList& dirtyRects,
+                  const void* buffer,
+                  int width,
+                  int height);
+
+  // Upload the |dirtyRects| of a |width| x |height| popup |buffer| into the
+  // popup texture of |view|. Returns the number of bytes uploaded.
+  int64_t UploadPopup(OsrView* view,
+                   const RectList& dirtyRects,
+                   const void* buffer,
+                   int width,
+                   int height);
+
+  // Upload the latest view and popup frames published through the mailboxes
+  // of |view|, if any.
+  void UploadMailboxFrame(OsrView* view);
+
+  // Draw the popup of each view over the views with the fixed-function
+  // pipeline. Must be called with |views_lock_| held.
+  void RenderPopups();
+
+  // Fill |hud_rects_| and |hud_colors_| with a bar per recent frame time.
+  void UpdateHud();
+
+  // Draw the HUD with the fixed-function pipeline.
+  void RenderHud();
+
+  // Delete the textures of |view|. Must be called on the GL thread.
+  static void DeleteViewTextures(OsrView* view);
+
+  // Rebuild the vertex buffer holding one quad per view.
+  void UpdateVertexBuffer();
+
+  // Draw the views with |core_renderer_|. Must be called with |views_lock_|
+  // held.
+  void RenderCoreProfile();
+
+  // Delete the textures of closed views. Must be called on the GL thread
+  // with |views_lock_| held.
+  void DeleteClosedViews();
+
+  // Copy the |dirtyRects| of |buffer| into the next pixel-unpack buffer. On
+  // success the buffer is left bound and the texture upload must source from
+  // offset 0.
+  bool CopyToUnpackBuffer(const RectList& dirtyRects,
+                          const void* buffer,
+                          int width,
+                          int height,
+                          bool full_update);
+
+  // Accumulate the bytes and time spent uploading one OnPaint.
+  void RecordUploadTime(int64_t bytes, double upload_ms);
+
+  // Log what the tile damage filter of a closing view saved.
+  static void LogDamageFilterStats(const TileDamageFilter::Stats& stats);
+
   // True if the application is using the Views framework.
   const bool use_views_;
 
-  // List of existing browser windows. Only accessed on the CEF UI thread.
-  typedef std::list<CefRefPtr<CefBrowser>> BrowserList;
-  BrowserList browser_list_;
+  // Existing browser windows.
+  BrowserRegistry browsers_;
 
   bool is_closing_;
 
 private:
   //const OsrRendererSettings settings_;
   bool initialized_;
-  unsigned int texture_id_;
-  int view_width_;
-  int view_height_;
-  CefRect popup_rect_;
-  CefRect original_popup_rect_;
   float spin_x_ = 0;
   float spin_y_ = 0;
-  CefRect update_rect_;
 
   OsrRendererSettings settings_ = {};
 
+  // Render state of each browser, keyed by browser identifier. The map and
+  // the layout are modified on the CEF UI thread and read by Render(), so
+  // both are guarded by |views_lock_|.
+  typedef std::map<int, std::unique_ptr<OsrView>> ViewMap;
+  ViewMap views_;
+  // Views of closed browsers whose textures still need to be deleted.
+  std::vector<std::unique_ptr<OsrView>> closed_views_;
+  // Window size the views were laid out for.
+  int layout_width_;
+  int layout_height_;
+  // True if the layout changed since the vertex buffer was built.
+  bool layout_dirty_;
+  base::Lock views_lock_;
+
+  DamageTracker damage_tracker_;
+
+  // Used when settings_.external_begin_frame_enabled is true. Only accessed
+  // on the CEF UI thread.
+  BeginFrameScheduler begin_frame_scheduler_;
+
+  InputRouter input_router_;
+  LatencyTracer latency_tracer_;
+
+  // One textured quad per view, in |views_| order.
+  unsigned int vertex_buffer_id_;
+
+  // Used when settings_.core_profile_enabled is true.
+  CoreProfileRenderer core_renderer_;
+  std::vector<CoreProfileRenderer::ViewQuad> view_quads_;
+  std::vector<CefRect> outline_rects_;
+  std::vector<GLuint> view_textures_;
+  std::vector<CefRect> popup_rects_;
+  std::vector<CefRect> popup_clip_rects_;
+  std::vector<GLuint> popup_textures_;
+
+  // Used when settings_.pbo_upload_enabled is true.
+  PboUploadRing pbo_ring_;
+
+  // Used when settings_.coalesce_dirty_rects is true.
+  RectCoalescer rect_coalescer_;
+  RectList upload_rects_;
+
+  // Output of OsrView::damage_filter. Only accessed by OnPaint.
+  RectList refined_damage_;
+
+  // Consumers of OnPaint output, such as the --output writer. Submit() is
+  // only called on the CEF UI thread.
+  FrameSinkPipeline sink_pipeline_;
+
+  // Frames produced by each browser in headless mode, and the limit after
+  // which it is closed. Only accessed on the CEF UI thread.
+  std::map<int, int64_t> headless_frames_;
+  int64_t headless_frame_limit_;
+
+  BrowserPool browser_pool_;
+  // True while RefillBrowserPool() creates a browser, so that OnAfterCreated
+  // leaves it to the pool.
+  bool creating_pooled_browser_;
+  bool browser_pool_refill_scheduled_;
+
+  PaintGovernor paint_governor_;
+  PaintGovernor::DecisionList governor_changes_;
+  bool paint_governor_scheduled_;
+  bool window_occluded_;
+
+  // Browsers whose WasResized notification is deferred. Only accessed on the
+  // CEF UI thread.
+  std::set<int> pending_resizes_;
+  ResizeThrottle resize_throttle_;
+
+  // Resize counters. The texture counters are updated on the GL thread.
+  int64_t layout_changes_;
+  int64_t resize_notifications_;
+  int64_t resize_paints_;
+  std::atomic<int64_t> texture_allocations_;
+  std::atomic<int64_t> texture_resizes_;
+
+  // Device scale factor reported by GetScreenInfo.
+  std::atomic<float> render_scale_;
+
+  FrameMetrics frame_metrics_;
+  std::atomic<bool> hud_visible_;
+  std::vector<float> hud_frame_times_;
+  std::vector<CefRect> hud_rects_;
+  std::vector<cef_color_t> hud_colors_;
+
+  // Upload timing since the last report.
+  int upload_frames_;
+  double upload_time_ms_;
+  double upload_time_max_ms_;
+
   // Include the default reference counting implementation.
   IMPLEMENT_REFCOUNTING(SimpleHandler);
 
 public:
-  BrowserList& getBrowserList() {return browser_list_;}
+  const BrowserRegistry& browsers() const { return browsers_; }
   void resize(int w, int h) {
     width = w;
     height = h;
+    Layout();
   }
 
 private:
@@ -0,0 +1,235 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// Renders into an EGL pbuffer with an OpenGL 3.2 core profile context, e.g.
+// Mesa llvmpipe. The tests are skipped where no such context can be made.
+
+#include "core_profile_renderer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+const int kWidth = 64;
+const int kHeight = 64;
+
+struct Pixel {
+  int r, g, b, a;
+};
+
+// Surfaceless Mesa needs neither a window system nor a GPU. Other EGL
+// implementations get their default display.
+EGLDisplay GetDisplay() {
+  const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display) {
+      return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                  EGL_DEFAULT_DISPLAY, NULL);
+    }
+  }
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+class CoreProfileRendererTest : public testing::Test {
+ protected:
+  CoreProfileRendererTest()
+      : display_(EGL_NO_DISPLAY),
+        surface_(EGL_NO_SURFACE),
+        context_(EGL_NO_CONTEXT) {}
+
+  void SetUp() OVERRIDE {
+    display_ = GetDisplay();
+    if (display_ == EGL_NO_DISPLAY ||
+        !eglInitialize(display_, NULL, NULL)) {
+      display_ = EGL_NO_DISPLAY;
+      return;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API))
+      return;
+
+    const EGLint config_attribs[] = {EGL_SURFACE_TYPE,
+                                     EGL_PBUFFER_BIT,
+                                     EGL_RENDERABLE_TYPE,
+                                     EGL_OPENGL_BIT,
+                                     EGL_RED_SIZE,
+                                     8,
+                                     EGL_GREEN_SIZE,
+                                     8,
+                                     EGL_BLUE_SIZE,
+                                     8,
+                                     EGL_ALPHA_SIZE,
+                                     8,
+                                     EGL_NONE};
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display_, config_attribs, &config, 1,
+                         &config_count) ||
+        config_count == 0) {
+      return;
+    }
+
+    const EGLint surface_attribs[] = {EGL_WIDTH, kWidth, EGL_HEIGHT, kHeight,
+                                      EGL_NONE};
+    surface_ = eglCreatePbufferSurface(display_, config, surface_attribs);
+    if (surface_ == EGL_NO_SURFACE)
+      return;
+
+    const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      2,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+    context_ =
+        eglCreateContext(display_, config, EGL_NO_CONTEXT, context_attribs);
+    if (context_ == EGL_NO_CONTEXT)
+      return;
+    if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+      eglDestroyContext(display_, context_);
+      context_ = EGL_NO_CONTEXT;
+    }
+  }
+
+  void TearDown() OVERRIDE {
+    renderer_.Cleanup();
+    for (size_t i = 0; i < textures_.size(); ++i)
+      glDeleteTextures(1, &textures_[i]);
+    if (display_ == EGL_NO_DISPLAY)
+      return;
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context_ != EGL_NO_CONTEXT)
+      eglDestroyContext(display_, context_);
+    if (surface_ != EGL_NO_SURFACE)
+      eglDestroySurface(display_, surface_);
+    eglTerminate(display_);
+  }
+
+  bool HasContext() const { return context_ != EGL_NO_CONTEXT; }
+
+  // A |width| x |height| texture filled with |pixel|, set up the way
+  // SimpleHandler sets up view textures.
+  GLuint CreateTexture(int width, int height, const Pixel& pixel) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < pixels.size(); i += 4) {
+      pixels[i] = static_cast<uint8_t>(pixel.r);
+      pixels[i + 1] = static_cast<uint8_t>(pixel.g);
+      pixels[i + 2] = static_cast<uint8_t>(pixel.b);
+      pixels[i + 3] = static_cast<uint8_t>(pixel.a);
+    }
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, &pixels[0]);
+    textures_.push_back(texture);
+    return texture;
+  }
+
+  // Pixel at |x|, |y| of the window, with a top-left origin.
+  static Pixel ReadPixel(int x, int y) {
+    uint8_t rgba[4] = {0};
+    glReadPixels(x, kHeight - 1 - y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    Pixel pixel = {rgba[0], rgba[1], rgba[2], rgba[3]};
+    return pixel;
+  }
+
+  CoreProfileRenderer renderer_;
+  std::vector<GLuint> textures_;
+
+ private:
+  EGLDisplay display_;
+  EGLSurface surface_;
+  EGLContext context_;
+};
+
+#define SKIP_IF_NO_CONTEXT()                                         \
+  if (!HasContext()) {                                               \
+    printf("No EGL OpenGL 3.2 core profile context, skipping\n");    \
+    return;                                                          \
+  }
+
+// The background is a gradient from blue at the top to red at the bottom,
+// and each view covers its rectangle with its texture.
+TEST_F(CoreProfileRendererTest, DrawsBackgroundAndViews) {
+  SKIP_IF_NO_CONTEXT();
+  printf("Renderer: %s\n", glGetString(GL_RENDERER));
+  ASSERT_TRUE(renderer_.Initialize(false));
+
+  std::vector<CoreProfileRenderer::ViewQuad> quads(1);
+  quads[0].rect = CefRect(16, 16, 32, 32);
+  quads[0].max_u = 1.0f;
+  quads[0].max_v = 1.0f;
+  renderer_.SetViewQuads(quads, kWidth, kHeight);
+  const Pixel green = {0, 255, 0, 255};
+  renderer_.Draw(std::vector<GLuint>(1, CreateTexture(8, 8, green)));
+  EXPECT_EQ(static_cast<GLenum>(GL_NO_ERROR), glGetError());
+
+  const Pixel top = ReadPixel(2, 1);
+  EXPECT_LT(top.r, 16);
+  EXPECT_GT(top.b, 240);
+  const Pixel bottom = ReadPixel(2, kHeight - 2);
+  EXPECT_GT(bottom.r, 240);
+  EXPECT_LT(bottom.b, 16);
+  EXPECT_EQ(0, bottom.g);
+
+  const Pixel view = ReadPixel(32, 32);
+  EXPECT_EQ(0, view.r);
+  EXPECT_EQ(255, view.g);
+  EXPECT_EQ(0, view.b);
+  // Just outside the view.
+  EXPECT_EQ(0, ReadPixel(15, 32).g);
+  EXPECT_EQ(0, ReadPixel(48, 32).g);
+}
+
+// A view without a texture shows the background.
+TEST_F(CoreProfileRendererTest, SkipsViewsWithoutTexture) {
+  SKIP_IF_NO_CONTEXT();
+  ASSERT_TRUE(renderer_.Initialize(false));
+
+  std::vector<CoreProfileRenderer::ViewQuad> quads(1);
+  quads[0].rect = CefRect(16, 16, 32, 32);
+  quads[0].max_u = 1.0f;
+  quads[0].max_v = 1.0f;
+  renderer_.SetViewQuads(quads, kWidth, kHeight);
+  renderer_.Draw(std::vector<GLuint>(1, 0));
+
+  const Pixel view = ReadPixel(32, 32);
+  EXPECT_EQ(0, view.g);
+  EXPECT_GT(view.r + view.b, 240);
+}
+
+// Transparent views blend their premultiplied texture over the background.
+TEST_F(CoreProfileRendererTest, BlendsTransparentViews) {
+  SKIP_IF_NO_CONTEXT();
+  ASSERT_TRUE(renderer_.Initialize(true));
+
+  std::vector<CoreProfileRenderer::ViewQuad> quads(1);
+  quads[0].rect = CefRect(0, 0, kWidth, kHeight);
+  quads[0].max_u = 1.0f;
+  quads[0].max_v = 1.0f;
+  renderer_.SetViewQuads(quads, kWidth, kHeight);
+  const Pixel half_green = {0, 128, 0, 128};
+  renderer_.Draw(std::vector<GLuint>(1, CreateTexture(8, 8, half_green)));
+
+  const Pixel bottom = ReadPixel(2, kHeight - 2);
+  EXPECT_NEAR(128, bottom.g, 1);
+  EXPECT_NEAR(127, bottom.r, 4);
+  EXPECT_LT(bottom.b, 8);
+}
+
+}  // namespace
@@ -0,0 +1,124 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_TESTS_DAMAGE_PATTERNS_H_
+#define CEF_TESTS_CEFSIMPLE_TESTS_DAMAGE_PATTERNS_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "include/internal/cef_types_wrappers.h"
+
+// OnPaint damage shapes shared by the RectCoalescer tests and benchmark.
+namespace damage_patterns {
+
+typedef std::vector<CefRect> RectList;
+
+const int kFrameWidth = 1920;
+const int kFrameHeight = 1080;
+
+enum Pattern {
+  // Small rectangles anywhere in the frame, e.g. unrelated animations.
+  PATTERN_SCATTERED,
+  // Groups of small rectangles, e.g. a caret, a spinner and a hover effect.
+  PATTERN_CLUSTERED,
+  // Full-width rows exposed by a scroll plus the scrollbar thumb.
+  PATTERN_SCROLLING_STRIP,
+  // The whole frame plus the rectangles it already contains.
+  PATTERN_FULL_FRAME,
+  PATTERN_COUNT,
+};
+
+inline const char* PatternName(Pattern pattern) {
+  switch (pattern) {
+    case PATTERN_SCATTERED:
+      return "scattered";
+    case PATTERN_CLUSTERED:
+      return "clustered";
+    case PATTERN_SCROLLING_STRIP:
+      return "scrolling-strip";
+    case PATTERN_FULL_FRAME:
+      return "full-frame";
+    default:
+      return "unknown";
+  }
+}
+
+inline int Uniform(std::mt19937* rng, int min, int max) {
+  return std::uniform_int_distribution<int>(min, max)(*rng);
+}
+
+// A |width| x |height| rectangle at |x|,|y| clipped to the frame.
+inline CefRect ClippedRect(int x, int y, int width, int height) {
+  const int right = std::min(x + width, kFrameWidth);
+  const int bottom = std::min(y + height, kFrameHeight);
+  x = std::max(x, 0);
+  y = std::max(y, 0);
+  return CefRect(x, y, std::max(right - x, 0), std::max(bottom - y, 0));
+}
+
+// Append |count| rectangles of |pattern| to |rects|.
+inline void Generate(Pattern pattern,
+                     int count,
+                     std::mt19937* rng,
+                     RectList* rects) {
+  switch (pattern) {
+    case PATTERN_SCATTERED:
+      for (int i = 0; i < count; ++i) {
+        rects->push_back(ClippedRect(Uniform(rng, 0, kFrameWidth - 1),
+                                     Uniform(rng, 0, kFrameHeight - 1),
+                                     Uniform(rng, 4, 64),
+                                     Uniform(rng, 4, 64)));
+      }
+      break;
+    case PATTERN_CLUSTERED: {
+      const int clusters = std::max(1, count / 8);
+      std::vector<CefRect> centers;
+      for (int i = 0; i < clusters; ++i) {
+        centers.push_back(CefRect(Uniform(rng, 0, kFrameWidth - 1),
+                                  Uniform(rng, 0, kFrameHeight - 1), 0, 0));
+      }
+      for (int i = 0; i < count; ++i) {
+        const CefRect& center = centers[i % clusters];
+        rects->push_back(ClippedRect(center.x + Uniform(rng, -48, 48),
+                                     center.y + Uniform(rng, -48, 48),
+                                     Uniform(rng, 2, 32),
+                                     Uniform(rng, 2, 32)));
+      }
+      break;
+    }
+    case PATTERN_SCROLLING_STRIP: {
+      // Text lines of the exposed strip, then the scrollbar thumb.
+      const int line_height = 18;
+      const int top = kFrameHeight - line_height * std::max(1, count - 1);
+      for (int i = 0; i + 1 < count; ++i) {
+        rects->push_back(ClippedRect(0, top + i * line_height,
+                                     kFrameWidth - 16, line_height));
+      }
+      rects->push_back(ClippedRect(kFrameWidth - 16,
+                                   Uniform(rng, 0, kFrameHeight - 100), 16,
+                                   100));
+      break;
+    }
+    case PATTERN_FULL_FRAME:
+      rects->push_back(CefRect(0, 0, kFrameWidth, kFrameHeight));
+      for (int i = 1; i < count; ++i) {
+        rects->push_back(ClippedRect(Uniform(rng, 0, kFrameWidth - 1),
+                                     Uniform(rng, 0, kFrameHeight - 1),
+                                     Uniform(rng, 16, 256),
+                                     Uniform(rng, 16, 256)));
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+}  // namespace damage_patterns
+
+#endif  // CEF_TESTS_CEFSIMPLE_TESTS_DAMAGE_PATTERNS_H_
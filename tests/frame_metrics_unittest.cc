@@ -0,0 +1,93 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "frame_metrics.h"
+
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void SleepMs(int ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+double LastFrameMs(FrameMetrics* metrics) {
+  std::vector<float> times;
+  metrics->GetRecentFrameTimes(1, &times);
+  return times.empty() ? -1 : times[0];
+}
+
+TEST(FrameMetricsTest, FrameTimeIsTimeSincePreviousPresent) {
+  FrameMetrics metrics;
+  metrics.EndFrame();
+  SleepMs(20);
+  metrics.RecordPaint(1, 100);
+  metrics.EndFrame();
+  EXPECT_EQ(2, metrics.frame_count());
+  EXPECT_GE(LastFrameMs(&metrics), 20);
+  EXPECT_EQ(1, metrics.Total(FrameMetrics::PAINT_COUNT));
+  EXPECT_EQ(100, metrics.Total(FrameMetrics::DIRTY_AREA));
+}
+
+TEST(FrameMetricsTest, IdleTimeIsNotFrameTime) {
+  FrameMetrics metrics;
+  metrics.EndFrame();
+  for (int i = 0; i < 10; ++i) {
+    metrics.OnFrameSkipped();
+    SleepMs(10);
+  }
+  metrics.RecordPaint(1, 100);
+  SleepMs(5);
+  metrics.EndFrame();
+  const double frame_ms = LastFrameMs(&metrics);
+  EXPECT_GE(frame_ms, 5);
+  EXPECT_LT(frame_ms, 50);
+
+  // Back to back frames are timed from the previous present again.
+  SleepMs(20);
+  metrics.EndFrame();
+  EXPECT_GE(LastFrameMs(&metrics), 20);
+}
+
+TEST(FrameMetricsTest, IdleFrameWithoutPaintIsTimedFromLastSkip) {
+  FrameMetrics metrics;
+  metrics.EndFrame();
+  metrics.OnFrameSkipped();
+  SleepMs(50);
+  metrics.OnFrameSkipped();
+  metrics.EndFrame();
+  EXPECT_LT(LastFrameMs(&metrics), 40);
+}
+
+TEST(FrameMetricsTest, PercentileSinceFrame) {
+  FrameMetrics metrics;
+  // Ten frames with three paints each, then ten with one.
+  for (int frame = 0; frame < 20; ++frame) {
+    for (int i = 0; i < (frame < 10 ? 3 : 1); ++i)
+      metrics.RecordPaint(1, 1);
+    metrics.EndFrame();
+  }
+  EXPECT_EQ(3, metrics.Percentile(FrameMetrics::PAINT_COUNT, 100));
+  EXPECT_EQ(1, metrics.Percentile(FrameMetrics::PAINT_COUNT, 100, 10));
+  EXPECT_EQ(3, metrics.Percentile(FrameMetrics::PAINT_COUNT, 100, 9));
+  EXPECT_EQ(0, metrics.Percentile(FrameMetrics::PAINT_COUNT, 50, 20));
+}
+
+TEST(FrameMetricsTest, PercentileSinceFrameAfterWrapAround) {
+  FrameMetrics metrics;
+  const int64_t frames = FrameMetrics::kCapacity + 100;
+  for (int64_t frame = 0; frame < frames; ++frame) {
+    if (frame >= frames - 50)
+      metrics.RecordPaint(1, 1);
+    metrics.EndFrame();
+  }
+  EXPECT_EQ(1, metrics.Percentile(FrameMetrics::PAINT_COUNT, 100, 0));
+  EXPECT_EQ(1, metrics.Percentile(FrameMetrics::PAINT_COUNT, 0, frames - 50));
+  EXPECT_EQ(0, metrics.Percentile(FrameMetrics::PAINT_COUNT, 0, frames - 51));
+}
+
+}  // namespace
@@ -0,0 +1,15 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// Stands in for the GLFW header in the EGL tests. The code under test only
+// needs the OpenGL declarations that GLFW pulls in with GLFW_INCLUDE_GLEXT.
+
+#ifndef CEF_TESTS_CEFSIMPLE_TESTS_GL_SHIM_GLFW_GLFW3_H_
+#define CEF_TESTS_CEFSIMPLE_TESTS_GL_SHIM_GLFW_GLFW3_H_
+#pragma once
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#endif  // CEF_TESTS_CEFSIMPLE_TESTS_GL_SHIM_GLFW_GLFW3_H_
@@ -0,0 +1,12 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// Stands in for the macOS core profile header in the EGL tests. GL/glext.h
+// already declares the core profile entry points.
+
+#ifndef CEF_TESTS_CEFSIMPLE_TESTS_GL_SHIM_OPENGL_GL3_H_
+#define CEF_TESTS_CEFSIMPLE_TESTS_GL_SHIM_OPENGL_GL3_H_
+#pragma once
+
+#endif  // CEF_TESTS_CEFSIMPLE_TESTS_GL_SHIM_OPENGL_GL3_H_
@@ -0,0 +1,58 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// The tests link the CEF logging implementation without libcef. These stand
+// in for the libcef exports it calls: messages go to stderr and fatal ones,
+// such as failed DCHECKs, abort.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "include/base/cef_logging.h"
+#include "include/internal/cef_logging_internal.h"
+#include "include/internal/cef_string_types.h"
+
+int cef_get_min_log_level() {
+  return cef::logging::LOG_INFO;
+}
+
+int cef_get_vlog_level(const char* file_start, size_t N) {
+  return 0;
+}
+
+void cef_log(const char* file, int line, int severity, const char* message) {
+  fprintf(stderr, "[%s:%d] %s\n", file, line, message);
+  if (severity >= cef::logging::LOG_FATAL)
+    abort();
+}
+
+void cef_string_utf8_clear(cef_string_utf8_t* str) {
+  if (str->dtor && str->str)
+    str->dtor(str->str);
+  str->str = NULL;
+  str->length = 0;
+  str->dtor = NULL;
+}
+
+namespace {
+
+void FreeString(char* str) {
+  free(str);
+}
+
+}  // namespace
+
+int cef_string_wide_to_utf8(const wchar_t* src,
+                            size_t src_len,
+                            cef_string_utf8_t* output) {
+  // Only ASCII is ever logged by the tests.
+  cef_string_utf8_clear(output);
+  output->str = static_cast<char*>(malloc(src_len + 1));
+  for (size_t i = 0; i < src_len; ++i)
+    output->str[i] = src[i] < 0x80 ? static_cast<char>(src[i]) : '?';
+  output->str[src_len] = '\0';
+  output->length = src_len;
+  output->dtor = FreeString;
+  return 1;
+}
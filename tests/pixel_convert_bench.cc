@@ -0,0 +1,146 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// Time every pixel_convert function on a full 1080p frame with each
+// implementation the CPU supports. Usage: pixel_convert_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "pixel_convert.h"
+
+namespace {
+
+const int kWidth = 1920;
+const int kHeight = 1080;
+const int kStride = kWidth * 4;
+
+enum Function {
+  FUNCTION_SWAP_RED_BLUE,
+  FUNCTION_PREMULTIPLY,
+  FUNCTION_UNPREMULTIPLY,
+  FUNCTION_BGRA_TO_I420,
+  FUNCTION_HASH_RECT,
+  FUNCTION_COUNT,
+};
+
+const char* FunctionName(Function function) {
+  switch (function) {
+    case FUNCTION_SWAP_RED_BLUE:
+      return "SwapRedBlue";
+    case FUNCTION_PREMULTIPLY:
+      return "Premultiply";
+    case FUNCTION_UNPREMULTIPLY:
+      return "Unpremultiply";
+    case FUNCTION_BGRA_TO_I420:
+      return "BgraToI420";
+    case FUNCTION_HASH_RECT:
+      return "HashRect";
+    case FUNCTION_COUNT:
+      break;
+  }
+  return "unknown";
+}
+
+struct Buffers {
+  Buffers()
+      : src(static_cast<size_t>(kStride) * kHeight),
+        dst(src.size()),
+        y(static_cast<size_t>(kWidth) * kHeight),
+        u(static_cast<size_t>(kWidth / 2) * (kHeight / 2)),
+        v(u.size()) {
+    // Premultiplied content, so that Unpremultiply takes its usual path.
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < src.size(); i += 4) {
+      const uint8_t alpha = static_cast<uint8_t>(rng() | 0x80);
+      for (int c = 0; c < 3; ++c)
+        src[i + c] = static_cast<uint8_t>(rng() % (alpha + 1));
+      src[i + 3] = alpha;
+    }
+  }
+
+  std::vector<uint8_t> src;
+  std::vector<uint8_t> dst;
+  std::vector<uint8_t> y;
+  std::vector<uint8_t> u;
+  std::vector<uint8_t> v;
+};
+
+uint64_t Run(Function function, Buffers* buffers) {
+  const CefRect frame(0, 0, kWidth, kHeight);
+  switch (function) {
+    case FUNCTION_SWAP_RED_BLUE:
+      pixel_convert::SwapRedBlue(&buffers->src[0], kStride, &buffers->dst[0],
+                                 kStride, frame);
+      break;
+    case FUNCTION_PREMULTIPLY:
+      pixel_convert::Premultiply(&buffers->src[0], kStride, &buffers->dst[0],
+                                 kStride, frame);
+      break;
+    case FUNCTION_UNPREMULTIPLY:
+      pixel_convert::Unpremultiply(&buffers->src[0], kStride,
+                                   &buffers->dst[0], kStride, frame);
+      break;
+    case FUNCTION_BGRA_TO_I420:
+      pixel_convert::BgraToI420(&buffers->src[0], kStride, &buffers->y[0],
+                                kWidth, &buffers->u[0], kWidth / 2,
+                                &buffers->v[0], kWidth / 2, kWidth, kHeight,
+                                frame);
+      break;
+    case FUNCTION_HASH_RECT:
+      return pixel_convert::HashRect(&buffers->src[0], kStride, frame);
+    case FUNCTION_COUNT:
+      break;
+  }
+  return buffers->dst[0] + buffers->y[0];
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 100;
+  const pixel_convert::Isa isas[] = {
+      pixel_convert::ISA_SCALAR, pixel_convert::ISA_SSE2,
+      pixel_convert::ISA_AVX2, pixel_convert::ISA_NEON};
+
+  Buffers buffers;
+  printf("%dx%d frame, %d iterations\n", kWidth, kHeight, iterations);
+  printf("%-14s %-7s %10s %10s %9s\n", "function", "isa", "ms/frame",
+         "MPixel/s", "speedup");
+
+  uint64_t sink = 0;
+  for (int f = 0; f < FUNCTION_COUNT; ++f) {
+    const Function function = static_cast<Function>(f);
+    double scalar_ms = 0;
+    for (pixel_convert::Isa isa : isas) {
+      if (!pixel_convert::SetIsa(isa))
+        continue;
+      // Warm up the caches and the page tables.
+      sink += Run(function, &buffers);
+
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      for (int n = 0; n < iterations; ++n)
+        sink += Run(function, &buffers);
+      const double ms = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count() /
+                        iterations;
+      if (isa == pixel_convert::ISA_SCALAR)
+        scalar_ms = ms;
+
+      printf("%-14s %-7s %10.3f %10.1f %8.2fx\n", FunctionName(function),
+             pixel_convert::GetIsaName(isa), ms,
+             static_cast<double>(kWidth) * kHeight / (ms * 1000.0),
+             scalar_ms / ms);
+    }
+  }
+  pixel_convert::SetIsa(pixel_convert::GetBestIsa());
+  return sink == 1 ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "pixel_convert.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+using pixel_convert::Isa;
+
+const int kRuns = 200;
+const int kMaxSize = 300;
+// Bytes written around every destination image to catch out-of-rect
+// writes.
+const uint8_t kCanary = 0xa5;
+
+int Uniform(std::mt19937* rng, int lo, int hi) {
+  return std::uniform_int_distribution<int>(lo, hi)(*rng);
+}
+
+// A BGRA image with random contents and row padding.
+struct Image {
+  Image(std::mt19937* rng, int width, int height)
+      : width(width),
+        height(height),
+        stride(width * 4 + Uniform(rng, 0, 3) * 4 + Uniform(rng, 0, 3)),
+        pixels(static_cast<size_t>(stride) * height) {
+    for (size_t i = 0; i < pixels.size(); ++i)
+      pixels[i] = static_cast<uint8_t>((*rng)());
+  }
+
+  int width;
+  int height;
+  int stride;
+  std::vector<uint8_t> pixels;
+};
+
+// Random |width| x |height| image whose pixels are valid premultiplied
+// BGRA, i.e. no color channel exceeds alpha. A few pixels are fully
+// transparent or opaque.
+Image PremultipliedImage(std::mt19937* rng, int width, int height) {
+  Image image(rng, width, height);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = &image.pixels[static_cast<size_t>(y) * image.stride];
+    for (int x = 0; x < width; ++x) {
+      uint8_t* p = row + x * 4;
+      const int kind = Uniform(rng, 0, 7);
+      const int alpha = kind == 0 ? 0 : kind == 1 ? 255 : p[3];
+      for (int c = 0; c < 3; ++c)
+        p[c] = static_cast<uint8_t>(p[c] % (alpha + 1));
+      p[3] = static_cast<uint8_t>(alpha);
+    }
+  }
+  return image;
+}
+
+CefRect RandomRect(std::mt19937* rng, int width, int height) {
+  const int x = Uniform(rng, 0, width - 1);
+  const int y = Uniform(rng, 0, height - 1);
+  return CefRect(x, y, Uniform(rng, 1, width - x), Uniform(rng, 1, height - y));
+}
+
+class PixelConvertIsaTest : public testing::TestWithParam<int> {
+ protected:
+  void SetUp() OVERRIDE {
+    isa_ = static_cast<Isa>(GetParam());
+    supported_ = pixel_convert::SetIsa(isa_);
+    pixel_convert::SetIsa(pixel_convert::ISA_SCALAR);
+  }
+
+  void TearDown() OVERRIDE {
+    pixel_convert::SetIsa(pixel_convert::GetBestIsa());
+  }
+
+  // Run |convert| with the scalar and the tested implementation on copies
+  // of |src|, both out of place and in place, and expect the same bytes.
+  template <typename Convert>
+  void ExpectSameAsScalar(const Image& src,
+                          const CefRect& rect,
+                          Convert convert) {
+    std::mt19937 rng(rect.x * 31 + rect.y);
+    const int dst_stride = src.width * 4 + Uniform(&rng, 0, 16);
+    std::vector<uint8_t> expected(static_cast<size_t>(dst_stride) *
+                                      src.height,
+                                  kCanary);
+    std::vector<uint8_t> actual(expected);
+    std::vector<uint8_t> expected_in_place(src.pixels);
+    std::vector<uint8_t> actual_in_place(src.pixels);
+
+    pixel_convert::SetIsa(pixel_convert::ISA_SCALAR);
+    convert(&src.pixels[0], src.stride, &expected[0], dst_stride, rect);
+    convert(&expected_in_place[0], src.stride, &expected_in_place[0],
+            src.stride, rect);
+    pixel_convert::SetIsa(isa_);
+    convert(&src.pixels[0], src.stride, &actual[0], dst_stride, rect);
+    convert(&actual_in_place[0], src.stride, &actual_in_place[0], src.stride,
+            rect);
+    pixel_convert::SetIsa(pixel_convert::ISA_SCALAR);
+
+    EXPECT_TRUE(expected == actual);
+    EXPECT_TRUE(expected_in_place == actual_in_place);
+    // Bytes outside |rect| are left alone.
+    for (int y = 0; y < src.height; ++y) {
+      for (int x = 0; x < dst_stride; ++x) {
+        if (y >= rect.y && y < rect.y + rect.height && x >= rect.x * 4 &&
+            x < (rect.x + rect.width) * 4) {
+          continue;
+        }
+        if (actual[static_cast<size_t>(y) * dst_stride + x] != kCanary) {
+          ADD_FAILURE() << "write outside the rect at " << x << "," << y;
+          return;
+        }
+      }
+    }
+  }
+
+  Isa isa_;
+  bool supported_;
+};
+
+#define SKIP_IF_UNSUPPORTED()                                          \
+  if (!supported_) {                                                   \
+    printf("%s is not supported here\n",                               \
+           pixel_convert::GetIsaName(isa_));                           \
+    return;                                                            \
+  }
+
+TEST_P(PixelConvertIsaTest, SwapRedBlue) {
+  SKIP_IF_UNSUPPORTED();
+  std::mt19937 rng(1);
+  for (int run = 0; run < kRuns; ++run) {
+    const Image src(&rng, Uniform(&rng, 1, kMaxSize),
+                    Uniform(&rng, 1, kMaxSize / 4));
+    const CefRect rect = RandomRect(&rng, src.width, src.height);
+    SCOPED_TRACE(testing::Message() << "run " << run);
+    ExpectSameAsScalar(src, rect, pixel_convert::SwapRedBlue);
+  }
+}
+
+TEST_P(PixelConvertIsaTest, Premultiply) {
+  SKIP_IF_UNSUPPORTED();
+  std::mt19937 rng(2);
+  for (int run = 0; run < kRuns; ++run) {
+    const Image src(&rng, Uniform(&rng, 1, kMaxSize),
+                    Uniform(&rng, 1, kMaxSize / 4));
+    const CefRect rect = RandomRect(&rng, src.width, src.height);
+    SCOPED_TRACE(testing::Message() << "run " << run);
+    ExpectSameAsScalar(src, rect, pixel_convert::Premultiply);
+  }
+}
+
+TEST_P(PixelConvertIsaTest, Unpremultiply) {
+  SKIP_IF_UNSUPPORTED();
+  std::mt19937 rng(3);
+  for (int run = 0; run < kRuns; ++run) {
+    const Image src = PremultipliedImage(&rng, Uniform(&rng, 1, kMaxSize),
+                                         Uniform(&rng, 1, kMaxSize / 4));
+    const CefRect rect = RandomRect(&rng, src.width, src.height);
+    SCOPED_TRACE(testing::Message() << "run " << run);
+    ExpectSameAsScalar(src, rect, pixel_convert::Unpremultiply);
+  }
+}
+
+TEST_P(PixelConvertIsaTest, BgraToI420) {
+  SKIP_IF_UNSUPPORTED();
+  std::mt19937 rng(4);
+  for (int run = 0; run < kRuns; ++run) {
+    const Image src(&rng, Uniform(&rng, 1, kMaxSize),
+                    Uniform(&rng, 1, kMaxSize / 4));
+    const CefRect rect = RandomRect(&rng, src.width, src.height);
+    const int y_stride = src.width + Uniform(&rng, 0, 7);
+    const int uv_stride = (src.width + 1) / 2 + Uniform(&rng, 0, 7);
+    const size_t y_size = static_cast<size_t>(y_stride) * src.height;
+    const size_t uv_size =
+        static_cast<size_t>(uv_stride) * ((src.height + 1) / 2);
+
+    std::vector<uint8_t> planes[2];
+    for (int i = 0; i < 2; ++i) {
+      planes[i].assign(y_size + uv_size * 2, kCanary);
+      pixel_convert::SetIsa(i == 0 ? pixel_convert::ISA_SCALAR : isa_);
+      uint8_t* y = &planes[i][0];
+      pixel_convert::BgraToI420(&src.pixels[0], src.stride, y, y_stride,
+                                y + y_size, uv_stride,
+                                y + y_size + uv_size, uv_stride, src.width,
+                                src.height, rect);
+    }
+    pixel_convert::SetIsa(pixel_convert::ISA_SCALAR);
+    EXPECT_TRUE(planes[0] == planes[1])
+        << "run " << run << ": " << src.width << "x" << src.height << " rect "
+        << rect.x << "," << rect.y << " " << rect.width << "x" << rect.height;
+  }
+}
+
+TEST_P(PixelConvertIsaTest, HashRect) {
+  SKIP_IF_UNSUPPORTED();
+  std::mt19937 rng(5);
+  for (int run = 0; run < kRuns; ++run) {
+    const Image src(&rng, Uniform(&rng, 1, kMaxSize),
+                    Uniform(&rng, 1, kMaxSize / 4));
+    const CefRect rect = RandomRect(&rng, src.width, src.height);
+    const uint64_t expected =
+        pixel_convert::HashRect(&src.pixels[0], src.stride, rect);
+    pixel_convert::SetIsa(isa_);
+    const uint64_t actual =
+        pixel_convert::HashRect(&src.pixels[0], src.stride, rect);
+    pixel_convert::SetIsa(pixel_convert::ISA_SCALAR);
+    EXPECT_EQ(expected, actual) << "run " << run;
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Isas,
+                        PixelConvertIsaTest,
+                        testing::Values(pixel_convert::ISA_SSE2,
+                                        pixel_convert::ISA_AVX2,
+                                        pixel_convert::ISA_NEON));
+
+TEST(PixelConvertTest, ScalarIsAlwaysAvailable) {
+  EXPECT_TRUE(pixel_convert::SetIsa(pixel_convert::ISA_SCALAR));
+  EXPECT_EQ(pixel_convert::ISA_SCALAR, pixel_convert::GetIsa());
+  EXPECT_TRUE(pixel_convert::SetIsa(pixel_convert::GetBestIsa()));
+}
+
+TEST(PixelConvertTest, HashDependsOnContentAndPosition) {
+  std::mt19937 rng(6);
+  Image src(&rng, 64, 64);
+  const CefRect rect(8, 8, 32, 32);
+  const uint64_t hash = pixel_convert::HashRect(&src.pixels[0], src.stride,
+                                                rect);
+  EXPECT_EQ(hash,
+            pixel_convert::HashRect(&src.pixels[0], src.stride, rect));
+  EXPECT_NE(hash, pixel_convert::HashRect(&src.pixels[0], src.stride,
+                                          CefRect(9, 8, 32, 32)));
+  src.pixels[static_cast<size_t>(20) * src.stride + 20 * 4] ^= 1;
+  EXPECT_NE(hash,
+            pixel_convert::HashRect(&src.pixels[0], src.stride, rect));
+}
+
+TEST(PixelConvertTest, PremultiplyRoundTripsOpaquePixels) {
+  std::mt19937 rng(7);
+  Image src(&rng, 37, 5);
+  for (size_t i = 3; i < src.pixels.size(); i += 4)
+    src.pixels[i] = 255;
+  const CefRect rect(0, 0, src.width, src.height);
+  std::vector<uint8_t> dst(src.pixels);
+  pixel_convert::Premultiply(&dst[0], src.stride, &dst[0], src.stride, rect);
+  pixel_convert::Unpremultiply(&dst[0], src.stride, &dst[0], src.stride,
+                               rect);
+  for (int y = 0; y < src.height; ++y) {
+    const size_t offset = static_cast<size_t>(y) * src.stride;
+    EXPECT_EQ(0, memcmp(&src.pixels[offset], &dst[offset], src.width * 4));
+  }
+}
+
+}  // namespace
@@ -0,0 +1,75 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// Time RectCoalescer::Coalesce() on typical OnPaint damage and report what
+// it saves. Usage: rect_coalescer_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "damage_patterns.h"
+#include "rect_coalescer.h"
+
+namespace {
+
+using damage_patterns::Pattern;
+
+// Inputs generated per pattern and size, so that one unlucky layout does
+// not decide the result.
+const int kInputs = 16;
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 200;
+  const int counts[] = {1, 4, 16, 32, 33, 64, 128, 256, 512};
+
+  printf("%-16s %5s %9s %11s %11s %8s %10s\n", "pattern", "rects",
+         "out rects", "in cost px", "out cost px", "saved", "us/call");
+
+  RectCoalescer coalescer;
+  std::mt19937 rng(1);
+  for (int p = 0; p < damage_patterns::PATTERN_COUNT; ++p) {
+    const Pattern pattern = static_cast<Pattern>(p);
+    for (int count : counts) {
+      std::vector<RectCoalescer::RectList> inputs(kInputs);
+      for (int i = 0; i < kInputs; ++i)
+        damage_patterns::Generate(pattern, count, &rng, &inputs[i]);
+
+      RectCoalescer::RectList out;
+      int64_t in_cost = 0, out_cost = 0, out_rects = 0;
+      for (int i = 0; i < kInputs; ++i) {
+        coalescer.Coalesce(inputs[i], &out);
+        in_cost += RectCoalescer::Cost(inputs[i],
+                                       coalescer.call_cost_pixels());
+        out_cost += RectCoalescer::Cost(out, coalescer.call_cost_pixels());
+        out_rects += out.size();
+      }
+
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      for (int n = 0; n < iterations; ++n) {
+        for (int i = 0; i < kInputs; ++i)
+          coalescer.Coalesce(inputs[i], &out);
+      }
+      const double us =
+          std::chrono::duration<double, std::micro>(
+              std::chrono::steady_clock::now() - start)
+              .count() /
+          (static_cast<double>(iterations) * kInputs);
+
+      printf("%-16s %5d %9.1f %11lld %11lld %7.1f%% %10.2f\n",
+             damage_patterns::PatternName(pattern), count,
+             static_cast<double>(out_rects) / kInputs,
+             static_cast<long long>(in_cost / kInputs),
+             static_cast<long long>(out_cost / kInputs),
+             100.0 * (in_cost - out_cost) / in_cost, us);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "rect_coalescer.h"
+
+#include <random>
+#include <vector>
+
+#include "damage_patterns.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using damage_patterns::Pattern;
+using damage_patterns::kFrameHeight;
+using damage_patterns::kFrameWidth;
+
+typedef RectCoalescer::RectList RectList;
+
+// Returns true if every pixel of |rects| is also covered by |cover|.
+bool Covers(const RectList& cover, const RectList& rects) {
+  std::vector<uint8_t> mask(static_cast<size_t>(kFrameWidth) * kFrameHeight);
+  for (size_t i = 0; i < cover.size(); ++i) {
+    const CefRect& rect = cover[i];
+    for (int y = rect.y; y < rect.y + rect.height; ++y) {
+      for (int x = rect.x; x < rect.x + rect.width; ++x)
+        mask[static_cast<size_t>(y) * kFrameWidth + x] = 1;
+    }
+  }
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const CefRect& rect = rects[i];
+    for (int y = rect.y; y < rect.y + rect.height; ++y) {
+      for (int x = rect.x; x < rect.x + rect.width; ++x) {
+        if (!mask[static_cast<size_t>(y) * kFrameWidth + x])
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+CefRect Bounds(const RectList& rects) {
+  int left = kFrameWidth, top = kFrameHeight, right = 0, bottom = 0;
+  for (size_t i = 0; i < rects.size(); ++i) {
+    if (rects[i].IsEmpty())
+      continue;
+    left = std::min(left, rects[i].x);
+    top = std::min(top, rects[i].y);
+    right = std::max(right, rects[i].x + rects[i].width);
+    bottom = std::max(bottom, rects[i].y + rects[i].height);
+  }
+  return CefRect(left, top, right - left, bottom - top);
+}
+
+class RectCoalescerPatternTest : public testing::TestWithParam<int> {};
+
+// Coalescing must never lose damage nor make the upload more expensive.
+TEST_P(RectCoalescerPatternTest, CoversInputAndNeverCostsMore) {
+  const Pattern pattern = static_cast<Pattern>(GetParam());
+  std::mt19937 rng(1234);
+  RectCoalescer coalescer;
+  const int counts[] = {1, 2, 5, 16, 32, 33, 64, 128, 256};
+  for (int count : counts) {
+    for (int run = 0; run < 10; ++run) {
+      RectList rects, out;
+      damage_patterns::Generate(pattern, count, &rng, &rects);
+      coalescer.Coalesce(rects, &out);
+
+      SCOPED_TRACE(testing::Message()
+                   << damage_patterns::PatternName(pattern) << " " << count
+                   << " rects, run " << run);
+      size_t non_empty = 0;
+      for (size_t i = 0; i < rects.size(); ++i)
+        non_empty += rects[i].IsEmpty() ? 0 : 1;
+      EXPECT_EQ(non_empty == 0, out.empty());
+      EXPECT_LE(out.size(), non_empty);
+      EXPECT_TRUE(Covers(out, rects));
+      EXPECT_LE(RectCoalescer::Cost(out, coalescer.call_cost_pixels()),
+                RectCoalescer::Cost(rects, coalescer.call_cost_pixels()));
+      for (size_t i = 0; i < out.size(); ++i)
+        EXPECT_FALSE(out[i].IsEmpty());
+
+      // Clusters of tiny rects merge however many of them there are.
+      if (pattern == damage_patterns::PATTERN_CLUSTERED && count > 32) {
+        EXPECT_LT(out.size(), non_empty / 2);
+        EXPECT_LT(RectCoalescer::Cost(out, coalescer.call_cost_pixels()) * 2,
+                  RectCoalescer::Cost(rects, coalescer.call_cost_pixels()));
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Patterns,
+                        RectCoalescerPatternTest,
+                        testing::Range(0,
+                                       static_cast<int>(
+                                           damage_patterns::PATTERN_COUNT)));
+
+TEST(RectCoalescerTest, EmptyInput) {
+  RectCoalescer coalescer;
+  RectList rects, out(1, CefRect(0, 0, 1, 1));
+  coalescer.Coalesce(rects, &out);
+  EXPECT_TRUE(out.empty());
+
+  rects.push_back(CefRect(10, 10, 0, 5));
+  rects.push_back(CefRect(10, 10, 5, 0));
+  coalescer.Coalesce(rects, &out);
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(RectCoalescerTest, MergesNeighbours) {
+  RectCoalescer coalescer;
+  RectList rects, out;
+  rects.push_back(CefRect(0, 0, 10, 10));
+  rects.push_back(CefRect(10, 0, 10, 10));
+  coalescer.Coalesce(rects, &out);
+  ASSERT_EQ(1u, out.size());
+  EXPECT_EQ(CefRect(0, 0, 20, 10), out[0]);
+}
+
+TEST(RectCoalescerTest, KeepsDistantLargeRects) {
+  RectCoalescer coalescer;
+  RectList rects, out;
+  rects.push_back(CefRect(0, 0, 200, 200));
+  rects.push_back(CefRect(1500, 800, 200, 200));
+  coalescer.Coalesce(rects, &out);
+  EXPECT_EQ(2u, out.size());
+}
+
+// A dense grid of small rects, far more than are merged pairwise, merges
+// into its bounding box.
+TEST(RectCoalescerTest, DenseGridCollapsesToBounds) {
+  RectCoalescer coalescer;
+  RectList rects, out;
+  for (int i = 0; i < 512; ++i)
+    rects.push_back(CefRect(i % 32 * 20, i / 32 * 20, 16, 16));
+  coalescer.Coalesce(rects, &out);
+  ASSERT_EQ(1u, out.size());
+  EXPECT_EQ(Bounds(rects), out[0]);
+}
+
+// Rects too far apart for any merge to pay off stay apart however many
+// there are.
+TEST(RectCoalescerTest, KeepsManyDistantRects) {
+  RectCoalescer coalescer;
+  RectList rects, out;
+  for (int i = 0; i < 64; ++i)
+    rects.push_back(CefRect(i % 8 * 240, i / 8 * 135, 80, 80));
+  coalescer.Coalesce(rects, &out);
+  EXPECT_EQ(rects.size(), out.size());
+  EXPECT_TRUE(Covers(out, rects));
+}
+
+// Identical rects at both ends of the frame merge with each other only.
+TEST(RectCoalescerTest, KeepsSparseDuplicatesApart) {
+  RectCoalescer coalescer;
+  RectList rects, out;
+  for (int i = 0; i < 100; ++i) {
+    rects.push_back(i % 2 ? CefRect(0, 0, 4, 4)
+                          : CefRect(kFrameWidth - 4, kFrameHeight - 4, 4, 4));
+  }
+  coalescer.Coalesce(rects, &out);
+  EXPECT_EQ(2u, out.size());
+  EXPECT_TRUE(Covers(out, rects));
+}
+
+TEST(RectCoalescerTest, SteadyStateDoesNotAllocate) {
+  std::mt19937 rng(42);
+  RectCoalescer coalescer;
+  for (int pattern = 0; pattern < damage_patterns::PATTERN_COUNT;
+       ++pattern) {
+    for (int count : {8, 32, 33, 256}) {
+      RectList rects, out;
+      damage_patterns::Generate(static_cast<Pattern>(pattern), count, &rng,
+                                &rects);
+      // The first call sizes the scratch storage and |out|.
+      coalescer.Coalesce(rects, &out);
+
+      const int64_t before = coalescer.scratch_allocations();
+      const CefRect* data = out.data();
+      for (int i = 0; i < 10; ++i)
+        coalescer.Coalesce(rects, &out);
+      EXPECT_EQ(before, coalescer.scratch_allocations())
+          << damage_patterns::PatternName(static_cast<Pattern>(pattern))
+          << " " << count << " rects";
+      EXPECT_EQ(data, out.data());
+    }
+  }
+}
+
+}  // namespace
@@ -0,0 +1,179 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+// Simulates window drag resizes through the render loop and compares the
+// WasResized notifications and texture allocations of ResizeThrottle with
+// notifying on every size change and allocating textures at the exact size.
+// Usage: resize_throttle_bench [input events per second] [refresh rate]
+//
+// The loop runs once per input event and once per present. A notified
+// browser paints its new size at the next present, once however many
+// notifications it got in between.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "resize_throttle.h"
+
+namespace {
+
+struct Size {
+  int width;
+  int height;
+};
+
+struct Drag {
+  const char* name;
+  Size from;
+  Size to;
+  int64_t duration_us;
+  // Back and forth swings instead of one steady move.
+  int swings;
+};
+
+const Drag kDrags[] = {
+    {"grow 1024x768 to 1600x1000", {1024, 768}, {1600, 1000}, 1000000, 0},
+    {"shrink 1600x1000 to 800x600", {1600, 1000}, {800, 600}, 1000000, 0},
+    {"wiggle around 1280x800", {1180, 740}, {1380, 860}, 2000000, 4},
+};
+
+struct Result {
+  int64_t size_changes;
+  int64_t notifications;
+  int64_t paints;
+  int64_t allocations;
+  double allocated_mb;
+  Size final_paint;
+  Size texture;
+};
+
+Size DragSize(const Drag& drag, int64_t t_us) {
+  double f = static_cast<double>(t_us) / drag.duration_us;
+  if (drag.swings > 0) {
+    f *= drag.swings;
+    f = f - static_cast<int>(f);
+    f = f < 0.5 ? f * 2 : (1 - f) * 2;
+  }
+  Size size;
+  size.width = drag.from.width +
+               static_cast<int>((drag.to.width - drag.from.width) * f);
+  size.height = drag.from.height +
+                static_cast<int>((drag.to.height - drag.from.height) * f);
+  return size;
+}
+
+Result Simulate(const Drag& drag,
+                bool throttled,
+                int events_per_second,
+                int refresh_rate) {
+  const int64_t event_interval_us = 1000000 / events_per_second;
+  const int64_t present_interval_us = 1000000 / refresh_rate;
+
+  Result result = {};
+  ResizeThrottle throttle;
+  Size layout = drag.from;
+  Size notified = drag.from;
+  Size texture = {0, 0};
+  bool pending = false;
+  bool notified_since_present = true;
+  int64_t next_event_us = 0;
+  int64_t next_present_us = 0;
+  // Keep presenting for a second after the drag ends so that the final
+  // size is painted.
+  const int64_t end_us = drag.duration_us + 1000000;
+
+  while (next_present_us <= end_us) {
+    const bool is_event = next_event_us <= drag.duration_us &&
+                          next_event_us <= next_present_us;
+    const int64_t now_us = is_event ? next_event_us : next_present_us;
+
+    if (is_event) {
+      next_event_us += event_interval_us;
+      const Size size = DragSize(drag, now_us);
+      if (size.width != layout.width || size.height != layout.height) {
+        layout = size;
+        result.size_changes++;
+        pending = true;
+      }
+    } else {
+      next_present_us += present_interval_us;
+      // The browser paints the last size it was told about.
+      if (notified_since_present) {
+        notified_since_present = false;
+        result.paints++;
+        result.final_paint = notified;
+        bool allocate;
+        if (throttled) {
+          allocate = ResizeThrottle::GrowTextureSize(
+              notified.width, notified.height, &texture.width,
+              &texture.height);
+        } else {
+          allocate = notified.width != texture.width ||
+                     notified.height != texture.height;
+          texture = notified;
+        }
+        if (allocate) {
+          result.allocations++;
+          result.allocated_mb +=
+              static_cast<double>(texture.width) * texture.height * 4 /
+              (1024 * 1024);
+        }
+      }
+    }
+
+    // FlushResizes() runs on every loop iteration.
+    if (pending &&
+        (!throttled ||
+         throttle.TimeUntilFlushUs(now_us, present_interval_us) == 0)) {
+      throttle.OnFlushed(now_us);
+      pending = false;
+      notified = layout;
+      notified_since_present = true;
+      result.notifications++;
+    }
+  }
+  result.texture = texture;
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int events_per_second = argc > 1 ? std::max(1, atoi(argv[1])) : 120;
+  const int refresh_rate = argc > 2 ? std::max(1, atoi(argv[2])) : 60;
+  printf("%d input events/s, %d Hz\n", events_per_second, refresh_rate);
+  printf("%-28s %-9s %7s %10s %7s %7s %10s %10s\n", "drag", "policy",
+         "changes", "WasResized", "paints", "allocs", "alloc MB", "texture");
+
+  int failures = 0;
+  for (const Drag& drag : kDrags) {
+    for (int throttled = 0; throttled < 2; ++throttled) {
+      const Result r =
+          Simulate(drag, throttled != 0, events_per_second, refresh_rate);
+      char texture[32];
+      snprintf(texture, sizeof(texture), "%dx%d", r.texture.width,
+               r.texture.height);
+      printf("%-28s %-9s %7lld %10lld %7lld %7lld %10.1f %10s\n", drag.name,
+             throttled ? "throttle" : "baseline",
+             static_cast<long long>(r.size_changes),
+             static_cast<long long>(r.notifications),
+             static_cast<long long>(r.paints),
+             static_cast<long long>(r.allocations), r.allocated_mb, texture);
+
+      // Whatever the policy, the last size of the drag must be painted.
+      const Size last = DragSize(drag, drag.duration_us -
+                                           drag.duration_us %
+                                               (1000000 / events_per_second));
+      if (r.final_paint.width != last.width ||
+          r.final_paint.height != last.height) {
+        printf("  final paint %dx%d, expected %dx%d\n", r.final_paint.width,
+               r.final_paint.height, last.width, last.height);
+        failures++;
+      }
+    }
+  }
+  return failures ? 1 : 0;
+}
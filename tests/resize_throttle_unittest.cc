@@ -0,0 +1,48 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "resize_throttle.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+const int64_t kIntervalUs = 16667;
+
+TEST(ResizeThrottleTest, FirstFlushIsImmediate) {
+  ResizeThrottle throttle;
+  EXPECT_EQ(0, throttle.TimeUntilFlushUs(1000000, kIntervalUs));
+}
+
+TEST(ResizeThrottleTest, FlushesAtMostOncePerInterval) {
+  ResizeThrottle throttle;
+  throttle.OnFlushed(1000000);
+  EXPECT_EQ(kIntervalUs, throttle.TimeUntilFlushUs(1000000, kIntervalUs));
+  EXPECT_EQ(6667, throttle.TimeUntilFlushUs(1010000, kIntervalUs));
+  EXPECT_EQ(0, throttle.TimeUntilFlushUs(1000000 + kIntervalUs, kIntervalUs));
+  EXPECT_EQ(0, throttle.TimeUntilFlushUs(2000000, kIntervalUs));
+}
+
+TEST(ResizeThrottleTest, TextureGrowsInSizeClasses) {
+  int width = 0, height = 0;
+  EXPECT_TRUE(ResizeThrottle::GrowTextureSize(1024, 768, &width, &height));
+  EXPECT_EQ(1024, width);
+  EXPECT_EQ(768, height);
+
+  EXPECT_TRUE(ResizeThrottle::GrowTextureSize(1025, 700, &width, &height));
+  EXPECT_EQ(1024 + ResizeThrottle::kTextureSizeClass, width);
+  EXPECT_EQ(768, height);
+
+  // Anything that fits reuses the storage.
+  EXPECT_FALSE(ResizeThrottle::GrowTextureSize(1200, 768, &width, &height));
+  EXPECT_FALSE(ResizeThrottle::GrowTextureSize(1, 1, &width, &height));
+  EXPECT_EQ(1280, width);
+  EXPECT_EQ(768, height);
+
+  EXPECT_TRUE(ResizeThrottle::GrowTextureSize(100, 769, &width, &height));
+  EXPECT_EQ(1280, width);
+  EXPECT_EQ(1024, height);
+}
+
+}  // namespace
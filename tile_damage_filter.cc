@@ -0,0 +1,169 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#include "tile_damage_filter.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "include/base/cef_logging.h"
+#include "pixel_convert.h"
+
+namespace {
+
+int64_t Bytes(const CefRect& rect) {
+  return static_cast<int64_t>(rect.width) * rect.height * 4;
+}
+
+CefRect Intersect(const CefRect& a, const CefRect& b) {
+  const int left = std::max(a.x, b.x);
+  const int top = std::max(a.y, b.y);
+  const int right = std::min(a.x + a.width, b.x + b.width);
+  const int bottom = std::min(a.y + a.height, b.y + b.height);
+  if (right <= left || bottom <= top)
+    return CefRect();
+  return CefRect(left, top, right - left, bottom - top);
+}
+
+CefRect Union(const CefRect& a, const CefRect& b) {
+  if (a.IsEmpty())
+    return b;
+  const int left = std::min(a.x, b.x);
+  const int top = std::min(a.y, b.y);
+  const int right = std::max(a.x + a.width, b.x + b.width);
+  const int bottom = std::max(a.y + a.height, b.y + b.height);
+  return CefRect(left, top, right - left, bottom - top);
+}
+
+}  // namespace
+
+TileDamageFilter::TileDamageFilter()
+    : tile_size_(kDefaultTileSize),
+      width_(0),
+      height_(0),
+      columns_(0),
+      rows_(0) {}
+
+void TileDamageFilter::set_tile_size(int tile_size) {
+  DCHECK_GT(tile_size, 0);
+  if (tile_size == tile_size_)
+    return;
+  tile_size_ = tile_size;
+  Resize(width_, height_);
+}
+
+void TileDamageFilter::Filter(const RectList& damage,
+                              const void* buffer,
+                              int width,
+                              int height,
+                              RectList* refined) {
+  DCHECK(buffer);
+  DCHECK(refined);
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  refined->clear();
+  if (width != width_ || height != height_)
+    Resize(width, height);
+
+  last_ = Stats();
+  last_.frames = 1;
+
+  // Find the damaged part of every tile.
+  const CefRect bounds(0, 0, width, height);
+  for (RectList::const_iterator it = damage.begin(); it != damage.end();
+       ++it) {
+    const CefRect rect = Intersect(*it, bounds);
+    if (rect.IsEmpty())
+      continue;
+    last_.reported_bytes += Bytes(rect);
+
+    const int first_column = rect.x / tile_size_;
+    const int last_column = (rect.x + rect.width - 1) / tile_size_;
+    const int first_row = rect.y / tile_size_;
+    const int last_row = (rect.y + rect.height - 1) / tile_size_;
+    for (int row = first_row; row <= last_row; ++row) {
+      for (int column = first_column; column <= last_column; ++column) {
+        const int index = row * columns_ + column;
+        const CefRect tile(column * tile_size_, row * tile_size_, tile_size_,
+                           tile_size_);
+        if (tile_damage_[index].IsEmpty())
+          touched_.push_back(index);
+        tile_damage_[index] =
+            Union(tile_damage_[index], Intersect(rect, tile));
+      }
+    }
+  }
+
+  // Hash the touched tiles and drop the unchanged ones.
+  const uint8_t* pixels = static_cast<const uint8_t*>(buffer);
+  for (size_t i = 0; i < touched_.size(); ++i) {
+    const int index = touched_[i];
+    const CefRect tile =
+        Intersect(CefRect((index % columns_) * tile_size_,
+                          (index / columns_) * tile_size_, tile_size_,
+                          tile_size_),
+                  bounds);
+    const uint64_t hash = pixel_convert::HashRect(pixels, width * 4, tile);
+    if (valid_[index] && hashes_[index] == hash) {
+      tile_damage_[index] = CefRect();
+    } else {
+      hashes_[index] = hash;
+      valid_[index] = true;
+    }
+  }
+
+  // Emit the changed tiles in row-major order, merging each run of adjacent
+  // changed tiles in a row into one rectangle.
+  std::sort(touched_.begin(), touched_.end());
+  CefRect run;
+  int run_end = -1;
+  for (size_t i = 0; i < touched_.size(); ++i) {
+    const int index = touched_[i];
+    const CefRect& changed = tile_damage_[index];
+    if (changed.IsEmpty())
+      continue;
+    if (index != run_end || index % columns_ == 0) {
+      if (!run.IsEmpty())
+        refined->push_back(run);
+      run = CefRect();
+    }
+    run = Union(run, changed);
+    run_end = index + 1;
+    tile_damage_[index] = CefRect();
+  }
+  if (!run.IsEmpty())
+    refined->push_back(run);
+  touched_.clear();
+
+  for (RectList::const_iterator it = refined->begin(); it != refined->end();
+       ++it) {
+    last_.refined_bytes += Bytes(*it);
+  }
+  last_.filter_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+  total_.frames += last_.frames;
+  total_.reported_bytes += last_.reported_bytes;
+  total_.refined_bytes += last_.refined_bytes;
+  total_.filter_ms += last_.filter_ms;
+}
+
+void TileDamageFilter::Reset() {
+  std::fill(valid_.begin(), valid_.end(), false);
+}
+
+void TileDamageFilter::Resize(int width, int height) {
+  width_ = width;
+  height_ = height;
+  columns_ = (width + tile_size_ - 1) / tile_size_;
+  rows_ = (height + tile_size_ - 1) / tile_size_;
+  const size_t tiles = static_cast<size_t>(columns_) * rows_;
+  hashes_.assign(tiles, 0);
+  valid_.assign(tiles, false);
+  tile_damage_.assign(tiles, CefRect());
+  touched_.clear();
+  touched_.reserve(tiles);
+}
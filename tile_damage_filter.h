@@ -0,0 +1,86 @@
+// Copyright (c) 2018 The Chromium Embedded Framework Authors. All rights
+// reserved. Use of this source code is governed by a BSD-style license that
+// can be found in the LICENSE file.
+
+#ifndef CEF_TESTS_CEFSIMPLE_TILE_DAMAGE_FILTER_H_
+#define CEF_TESTS_CEFSIMPLE_TILE_DAMAGE_FILTER_H_
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "include/base/cef_macros.h"
+#include "include/internal/cef_types_wrappers.h"
+
+// Shrinks OnPaint damage to the pixels that actually changed. Chromium often
+// reports much more than changed, e.g. a full-width strip for a blinking
+// caret or the whole view after WasResized(). The frame is divided into
+// square tiles. Each tile touched by the damage is hashed and compared with
+// its hash from the previous frame, and only changed tiles are kept.
+//
+// Tiles outside the damage keep their hashes, which stay valid because their
+// pixels cannot have changed. Not thread safe.
+class TileDamageFilter {
+ public:
+  typedef std::vector<CefRect> RectList;
+
+  static const int kDefaultTileSize = 64;
+
+  struct Stats {
+    Stats() : frames(0), reported_bytes(0), refined_bytes(0), filter_ms(0) {}
+
+    int64_t frames;
+    // BGRA bytes covered by the damage before and after filtering.
+    int64_t reported_bytes;
+    int64_t refined_bytes;
+    double filter_ms;
+  };
+
+  TileDamageFilter();
+
+  // Changing the tile size forgets all hashes.
+  void set_tile_size(int tile_size);
+  int tile_size() const { return tile_size_; }
+
+  // Write the parts of |damage| that changed since the previous call to
+  // |refined|. |buffer| is the complete |width| x |height| BGRA frame. After
+  // a size change every damaged tile counts as changed. Each refined
+  // rectangle lies within the bounding box of |damage|.
+  void Filter(const RectList& damage,
+              const void* buffer,
+              int width,
+              int height,
+              RectList* refined);
+
+  // Forget all hashes so that the next frame keeps all of its damage.
+  void Reset();
+
+  // Values for the most recent Filter() call, and totals over all calls.
+  const Stats& last() const { return last_; }
+  const Stats& total() const { return total_; }
+
+ private:
+  void Resize(int width, int height);
+
+  int tile_size_;
+  int width_;
+  int height_;
+  int columns_;
+  int rows_;
+
+  std::vector<uint64_t> hashes_;
+  std::vector<bool> valid_;
+
+  // Per-call state. |tile_damage_| is the part of each tile covered by the
+  // damage and is empty for all other tiles.
+  std::vector<CefRect> tile_damage_;
+  std::vector<int> touched_;
+
+  Stats last_;
+  Stats total_;
+
+  DISALLOW_COPY_AND_ASSIGN(TileDamageFilter);
+};
+
+#endif  // CEF_TESTS_CEFSIMPLE_TILE_DAMAGE_FILTER_H_
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Compares input latency with and without --render-thread by replaying the
+# same recorded input session in both modes against the latency echo page.
+#
+# Usage: compare_render_thread_latency.sh <cefsimple> <input log> [runs]
+#
+# Record the session once with
+#   cefsimple --latency-echo --record-input=session.input
+# and run this script on the machine whose numbers are wanted, with nothing
+# else running. Each report is written to latency-<mode>-<run>.json in the
+# current directory and its input_latency_ms field is printed.
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "usage: $0 <cefsimple> <input log> [runs]" >&2
+    exit 2
+fi
+
+binary=$1
+session=$2
+runs=${3:-3}
+
+run=1
+while [ "$run" -le "$runs" ]; do
+    for mode in inline render-thread; do
+        extra=
+        if [ "$mode" = render-thread ]; then
+            extra=--render-thread
+        fi
+        report=latency-$mode-$run.json
+        "$binary" --latency-echo --log-input-latency \
+            --replay-input="$session" --replay-report="$report" $extra \
+            >/dev/null 2>&1
+        printf '%-13s run %d: ' "$mode" "$run"
+        sed -n 's/.*"input_latency_ms": "\([^"]*\)".*/\1/p' "$report"
+    done
+    run=$((run + 1))
+done